@@ -45,6 +45,11 @@ extern byte amModeCycle;
 
 static angle_t am_viewangle;
 
+#define AM_MAXLINEVERTS     2048
+
+static vtx_t am_lines[AM_MAXLINEVERTS];
+static int am_numlineverts = 0;
+
 CVAR_EXTERNAL(am_fulldraw);
 CVAR_EXTERNAL(am_ssect);
 CVAR_EXTERNAL(r_texturecombiner);
@@ -88,6 +93,8 @@ void AM_BeginDraw(angle_t view, fixed_t x, fixed_t y) {
 //
 
 void AM_EndDraw(void) {
+	AM_FlushLines();
+
 	dglPopMatrix();
 	dglDepthRange(0.0f, 1.0f);
 
@@ -272,30 +279,47 @@ void AM_DrawLeafs(float scale) {
 	DL_ProcessDrawList(DLT_AMAP, DL_ProcessAutomap);
 }
 
+//
+// AM_FlushLines
+// Draws the lines queued up by AM_DrawLine
+//
+
+void AM_FlushLines(void) {
+	if (!am_numlineverts) {
+		return;
+	}
+
+	dglDisable(GL_TEXTURE_2D);
+	dglDrawLines(am_numlineverts, am_lines);
+	dglEnable(GL_TEXTURE_2D);
+
+	am_numlineverts = 0;
+}
+
 //
 // AM_DrawLine
 //
 
 void AM_DrawLine(int x1, int x2, int y1, int y2, float scale, rcolor c) {
-	vtx_t v[2];
+	vtx_t* v;
+
+	if (am_numlineverts + 2 > AM_MAXLINEVERTS) {
+		AM_FlushLines();
+	}
+
+	v = &am_lines[am_numlineverts];
+	am_numlineverts += 2;
 
 	v[0].x = F2D3D(x1);
-	v[0].z = F2D3D(y1);
+	v[0].y = F2D3D(y1);
 	v[1].x = F2D3D(x2);
-	v[1].z = F2D3D(y2);
+	v[1].y = F2D3D(y2);
 
-	v[0].y = v[1].y = (scale * 2);
+	v[0].z = v[1].z = -(scale * 2);
+	v[0].tu = v[1].tu = 0.0f;
+	v[0].tv = v[1].tv = 0.0f;
 
 	dglSetVertexColor(v, c, 2);
-
-	dglDisable(GL_TEXTURE_2D);
-	dglBegin(GL_LINES);
-	dglColor4ub(v[0].r, v[0].g, v[0].b, v[0].a);
-	dglVertex3f(v[0].x, v[0].z, -v[0].y);
-	dglColor4ub(v[1].r, v[1].g, v[1].b, v[1].a);
-	dglVertex3f(v[1].x, v[1].z, -v[1].y);
-	dglEnd();
-	dglEnable(GL_TEXTURE_2D);
 }
 
 //
@@ -308,6 +332,8 @@ void AM_DrawTriangle(mobj_t* mobj, float scale, boolean solid, byte r, byte g, b
 	fixed_t y;
 	angle_t angle;
 
+	AM_FlushLines();
+
 	if (mobj->flags & (MF_NOSECTOR | MF_RENDERLASER)) {
 		return;
 	}
@@ -387,6 +413,8 @@ void AM_DrawSprite(mobj_t* thing, float scale) {
 	float sin;
 	vtx_t vtx[4];
 
+	AM_FlushLines();
+
 	if (thing->flags & (MF_NOSECTOR | MF_RENDERLASER)) {
 		return;
 	}
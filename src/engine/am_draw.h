@@ -28,6 +28,7 @@ void AM_BeginDraw(angle_t view, fixed_t x, fixed_t y);
 void AM_EndDraw(void);
 void AM_DrawLeafs(float scale);
 void AM_DrawLine(int x1, int x2, int y1, int y2, float scale, rcolor c);
+void AM_FlushLines(void);
 void AM_DrawTriangle(mobj_t* mobj, float scale, boolean solid, byte r, byte g, byte b);
 void AM_DrawSprite(mobj_t* thing, float scale);
 
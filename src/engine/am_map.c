@@ -1023,6 +1023,8 @@ void AM_Drawer(void) {
 		AM_drawThings();
 	}
 
+	AM_FlushLines();
+
 	if (plr->artifacts) {
 		int x = 280;
 
@@ -35,6 +35,7 @@
 #include "r_main.h"
 #include "i_system.h"
 #include "gl_texture.h"
+#include "gl_batch.h"
 
 #define SDL_MAIN_HANDLED
 #ifdef __OpenBSD__
@@ -469,11 +470,14 @@ extern float display_scale; // set in i_video.c
 
 #define CONFONT_YPAD    (16 * CONFONT_SCALE)
 
+static const word rectindices[6] = { 0, 1, 2, 0, 2, 3 };
+
 void CON_Draw(void) {
 	int     line;
 	float   y = 0;
 	float   x = 0;
 	float   inputlen;
+	vtx_t   vtx[4];
 
 	if (!console_initialized) {
 		return;
@@ -483,22 +487,28 @@ void CON_Draw(void) {
 		return;
 	}
 
-	GL_SetOrtho(1);
-	GL_SetState(GLSTATE_BLEND, 1);
+	dmemset(vtx, 0, sizeof(vtx));
 
-	dglDisable(GL_TEXTURE_2D);
-	dglColor4ub(0, 0, 0, 128);
-	dglRectf(SCREENWIDTH, CONSOLE_Y + CONFONT_YPAD, 0, 0);
+	// same corners and winding as glRectf
+	vtx[0].x = vtx[3].x = SCREENWIDTH;
+	vtx[1].x = vtx[2].x = 0;
+	vtx[0].y = vtx[1].y = CONSOLE_Y + CONFONT_YPAD;
+	vtx[2].y = vtx[3].y = 0;
+	dglSetVertexColor(vtx, D_RGBA(0, 0, 0, 128), 4);
+
+	GL_BatchGeometry(0, true, vtx, 4, rectindices, 6);
 
+	GL_SetOrtho(1);
 	GL_SetState(GLSTATE_BLEND, 0);
+	dglDisable(GL_TEXTURE_2D);
+
+	vtx[0].x = vtx[2].x = 0;
+	vtx[1].x = vtx[3].x = SCREENWIDTH;
+	vtx[0].y = vtx[1].y = CONSOLE_Y - 1;
+	vtx[2].y = vtx[3].y = CONSOLE_Y + CONFONT_YPAD;
+	dglSetVertexColor(vtx, D_RGBA(0, 0xff, 0, 0xff), 4);
 
-	dglColor4f(0, 1, 0, 1);
-	dglBegin(GL_LINES);
-	dglVertex2f(0, CONSOLE_Y - 1);
-	dglVertex2f(SCREENWIDTH, CONSOLE_Y - 1);
-	dglVertex2f(0, CONSOLE_Y + CONFONT_YPAD);
-	dglVertex2f(SCREENWIDTH, CONSOLE_Y + CONFONT_YPAD);
-	dglEnd();
+	dglDrawLines(4, vtx);
 	dglEnable(GL_TEXTURE_2D);
 
 	line = console_head;
@@ -183,6 +183,7 @@ void CON_CvarInit(void) {
 	M_RegisterCvars();
 	P_RegisterCvars();
 	G_RegisterCvars();
+	NET_SIM_RegisterCvars();
 
 	G_AddCommand("listcvars", CMD_ListCvars, 0);
 }
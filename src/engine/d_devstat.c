@@ -33,9 +33,12 @@
 #include "r_local.h"
 #include "z_zone.h"
 #include "gl_draw.h"
+#include "gl_batch.h"
 #include "s_sound.h"
 #include "d_englsh.h"
 #include "r_drawlist.h"
+#include "r_pvs.h"
+#include "r_occlude.h"
 #include "i_video.h"
 #include "i_sdlinput.h"
 static boolean showstats = true;
@@ -175,17 +178,56 @@ void D_DeveloperDisplay(void) {
 	Draw_Text(0, y, WHITE, 0.35f, false, "Draw Indices: %i", statindice);
 	y += 16;
 
+	sevclr = lastbatchstats.draws >= 10 ? YELLOW : WHITE;
+	Draw_Text(0, y, sevclr, 0.35f, false, "2D Draw Calls: %i (%i quads, %i flushes)",
+		lastbatchstats.draws, lastbatchstats.quads, lastbatchstats.flushes);
+	y += 16;
+
 	if (gamestate == GS_LEVEL && !automapactive) {
 		Draw_Text(0, y, WHITE, 0.35f, false, "PlayerView Render Time: %ims", renderTic);
 		y += 16;
 
 		Draw_Text(0, y, WHITE, 0.35f, false, "Sprite Render Time: %ims", spriteRenderTic);
 		y += 16;
+
+		Draw_Text(0, y, WHITE, 0.35f, false, "BSP Traversal: %ius, Geometry: %ius",
+			bspTraverseTime, geometryTime);
+		y += 16;
+
+		Draw_Text(0, y, WHITE, 0.35f, false, "Sprite Setup: %ius, World Submit: %ius",
+			spriteSetupTime, worldSubmitTime);
+		y += 16;
+
+		Draw_Text(0, y, WHITE, 0.35f, false, "Subsectors: %i traversed, %i drawn, %i pvs culled",
+			pvsstats.traversed, pvsstats.drawn, pvsstats.culled);
+		y += 16;
+
+		Draw_Text(0, y, WHITE, 0.35f, false, "Sprites: %i set up, %i drawn, %i occluded, %i queries",
+			occlusionstats.sprites, occlusionstats.drawn, occlusionstats.occluded, occlusionstats.queries);
+		y += 16;
 	}
 
 	Draw_Text(0, y, WHITE, 0.35f, false, "Active Sounds: %i", S_GetActiveSounds());
 	y += 16;
 
+	/*NETGAME PREDICTION*/
+
+	if (D_PredictionActive()) {
+		Draw_Text(0, y, WHITE, 0.35f, false, "Predicted Tics: %i (%i confirmed)",
+			netpredictstats.predictedtics, netpredictstats.confirmedtics);
+		y += 16;
+
+		sevclr = netpredictstats.lastcost >= 5000 ? YELLOW : WHITE;
+		Draw_Text(0, y, sevclr, 0.35f, false, "Rollbacks: %i, Re-run Tics: %i, Last: %ius",
+			netpredictstats.corrections, netpredictstats.resimtics, netpredictstats.lastcost);
+		y += 16;
+
+		Draw_Text(0, y, WHITE, 0.35f, false, "Snapshot Size: %i kb, Avg Save: %ius",
+			netpredictstats.snapshotsize >> 10, netpredictstats.snapshots ?
+			(int)(netpredictstats.snapshottime / netpredictstats.snapshots) : 0);
+		y += 16;
+	}
+
 	Draw_Text(0, y, WHITE, 0.35f, false, "Mouse Cursor: %i, %i", mouse_x, mouse_y);
 	y += 16;
 
@@ -65,6 +65,7 @@
 #include "g_demo.h"
 #include "p_saveg.h"
 #include "gl_draw.h"
+#include "gl_texres.h"
 #include "deh_main.h"
 #include "net_client.h"
 
@@ -214,7 +215,9 @@ static void D_FinishDraw(void) {
 	NetUpdate();
 
 	// normal update
-	I_FinishUpdate();
+	GL_SwapBuffers();
+
+	GL_EndTextureFrame();
 
 	if (i_interpolateframes.value) {
 		I_EndDisplay();
@@ -229,6 +232,8 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 		start();
 	}
 
+	D_ResetPrediction();
+
 	while (!action) {
 		int i = 0;
 		int lowtic = 0;
@@ -264,6 +269,21 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 		// get available ticks
 
 		NetUpdate();
+
+		// with prediction, run ahead instead of waiting for the other players
+		if (D_PredictionActive()) {
+			int starttic = gametic;
+
+			action = D_RunPredictedTics(tick);
+
+			// nothing could be run yet, so don't spin
+			if (!action && gametic == starttic) {
+				I_Sleep(1);
+			}
+
+			goto drawframe;
+		}
+
 		lowtic = GetLowTic();
 
 		availabletics = lowtic - gametic / ticdup;
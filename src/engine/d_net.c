@@ -37,6 +37,8 @@
 #include "tables.h"
 #include "m_misc.h"
 #include "con_console.h"
+#include "p_saveg.h"
+#include "g_demo.h"
 
 #ifdef __OpenBSD__
 #include <SDL.h>
@@ -196,6 +198,334 @@ void NetUpdate(void) {
 	}
 }
 
+//
+// CLIENT-SIDE PREDICTION
+//
+// With net_predict set the console player no longer waits on the
+// ticcmds of the other players. A tic is run as soon as our own ticcmd
+// exists, guessing that everyone else keeps doing whatever they did in
+// their last known tic. The play state is snapshotted before every
+// guessed tic, so when the real ticcmds arrive and disagree with the
+// guess the world is rolled back and run forward again.
+//
+
+CVAR(net_predict, 0);
+CVAR_EXTERNAL(i_interpolateframes);
+
+#define PREDICTIONTICS  8   // same limit NetUpdate puts on maketic
+#define NUMSNAPSHOTS    16
+
+typedef struct {
+	int         tic;
+	int         size;
+	int         alloced;
+	byte*       data;
+	ticcmd_t    cmds[MAXPLAYERS];   // ticcmds the tic was run with
+} snapshot_t;
+
+static snapshot_t snapshots[NUMSNAPSHOTS];
+
+static int oldesttic = -1;  // first tic not yet checked against the real ticcmds
+static int holdtic = -1;    // don't run this tic until it is confirmed
+
+boolean netpredicting = false;
+boolean netrollback = false;
+
+netpredictstats_t netpredictstats;
+
+int GetLowTic(void);
+boolean PlayersInGame(void);
+
+//
+// D_ResetPrediction
+//
+
+void D_ResetPrediction(void) {
+	oldesttic = -1;
+	holdtic = -1;
+}
+
+//
+// D_PredictionActive
+//
+
+boolean D_PredictionActive(void) {
+	return (net_predict.value && netgame && !demoplayback && !demorecording
+		&& !netdemo && ticdup == 1 && gamestate == GS_LEVEL);
+}
+
+//
+// D_GuessTiccmd
+// Repeat the last ticcmd received from a player
+//
+
+static void D_GuessTiccmd(int player, ticcmd_t* cmd) {
+	if (nettics[player] > 0) {
+		*cmd = netcmds[player][(nettics[player] - 1) % BACKUPTICS];
+	}
+	else {
+		dmemset(cmd, 0, sizeof(ticcmd_t));
+	}
+
+	// never guess one-shot events
+	cmd->chatchar = 0;
+
+	if (cmd->buttons & BT_SPECIAL) {
+		cmd->buttons = 0;
+	}
+}
+
+//
+// D_TiccmdsMatch
+//
+
+static boolean D_TiccmdsMatch(ticcmd_t* a, ticcmd_t* b) {
+	return (a->forwardmove == b->forwardmove
+		&& a->sidemove == b->sidemove
+		&& a->angleturn == b->angleturn
+		&& a->pitch == b->pitch
+		&& a->buttons == b->buttons
+		&& a->buttons2 == b->buttons2
+		&& a->chatchar == b->chatchar);
+}
+
+//
+// D_SaveTic
+// Snapshot the world and fill in guesses for the
+// players we have not heard from yet
+//
+
+static void D_SaveTic(void) {
+	snapshot_t* snap;
+	uint64_t start;
+	int buf;
+	int i;
+
+	start = I_GetTimeUS();
+
+	snap = &snapshots[gametic % NUMSNAPSHOTS];
+	snap->tic = gametic;
+	snap->size = P_WriteSnapshot(&snap->data, &snap->alloced);
+
+	buf = gametic % BACKUPTICS;
+
+	for (i = 0; i < MAXPLAYERS; i++) {
+		if (!playeringame[i] || i == consoleplayer) {
+			continue;
+		}
+
+		if (nettics[i] <= gametic) {
+			D_GuessTiccmd(i, &netcmds[i][buf]);
+		}
+
+		snap->cmds[i] = netcmds[i][buf];
+	}
+
+	netpredictstats.snapshotsize = snap->size;
+	netpredictstats.snapshottime += I_GetTimeUS() - start;
+	netpredictstats.snapshots++;
+}
+
+//
+// D_RestoreTic
+//
+
+static void D_RestoreTic(int tic) {
+	snapshot_t* snap;
+
+	snap = &snapshots[tic % NUMSNAPSHOTS];
+
+	if (snap->tic != tic) {
+		I_Error("D_RestoreTic: no snapshot for tic %i", tic);
+	}
+
+	P_ReadSnapshot(snap->data);
+	gametic = tic;
+
+	if (oldesttic >= gametic) {
+		oldesttic = -1;
+	}
+}
+
+//
+// D_CanRunTic
+//
+
+static boolean D_CanRunTic(int lowtic) {
+	if (gametic < lowtic) {
+		return true;
+	}
+
+	if (gametic >= maketic || gametic - lowtic >= PREDICTIONTICS) {
+		return false;
+	}
+
+	if (holdtic >= 0 && gametic >= holdtic) {
+		return false;
+	}
+
+	return true;
+}
+
+//
+// D_RunTic
+// Runs a single tic, guessing the missing ticcmds when the tic is
+// ahead of lowtic. Returns the resulting gameaction, if any
+//
+
+static int D_RunTic(int lowtic, int (*tick)(void)) {
+	boolean guessed;
+	int action = 0;
+
+	guessed = (gametic >= lowtic);
+
+	if (guessed) {
+		if (oldesttic < 0) {
+			oldesttic = gametic;
+		}
+
+		D_SaveTic();
+		netpredicting = true;
+		netpredictstats.predictedtics++;
+	}
+
+	if (i_interpolateframes.value) {
+		I_GetTime_SaveMS();
+	}
+
+	G_Ticker();
+
+	if (tick) {
+		action = tick();
+	}
+
+	if (gameaction != ga_nothing) {
+		action = gameaction;
+	}
+
+	gametic++;
+	netpredicting = false;
+
+	if (action && guessed) {
+		// don't leave the level on a guess; take the tic
+		// back and wait until it can be run for real
+		D_RestoreTic(gametic - 1);
+		holdtic = gametic;
+		gameaction = ga_nothing;
+		action = 0;
+	}
+
+	return action;
+}
+
+//
+// D_Rollback
+// Restore the world to how it was before tic and run it forward
+// again with whatever real ticcmds have arrived since
+//
+
+static int D_Rollback(int tic, int lowtic, int (*tick)(void)) {
+	int endtic;
+	int action = 0;
+	uint64_t start;
+
+	start = I_GetTimeUS();
+	endtic = gametic;
+
+	D_RestoreTic(tic);
+	oldesttic = -1;
+
+	netrollback = true;
+
+	while (gametic < endtic && D_CanRunTic(lowtic)) {
+		action = D_RunTic(lowtic, tick);
+		netpredictstats.resimtics++;
+
+		if (action || holdtic == gametic) {
+			break;
+		}
+	}
+
+	netrollback = false;
+
+	netpredictstats.corrections++;
+	netpredictstats.lastcost = (int)(I_GetTimeUS() - start);
+	netpredictstats.totalcost += netpredictstats.lastcost;
+
+	return action;
+}
+
+//
+// D_CheckPrediction
+// Compare the guessed ticcmds against the real ones
+// and roll back on the first mismatch
+//
+
+static int D_CheckPrediction(int lowtic, int (*tick)(void)) {
+	snapshot_t* snap;
+	int endtic;
+	int tic;
+	int i;
+
+	if (oldesttic < 0) {
+		return 0;
+	}
+
+	endtic = MIN(lowtic, gametic);
+
+	for (tic = oldesttic; tic < endtic; tic++) {
+		snap = &snapshots[tic % NUMSNAPSHOTS];
+
+		for (i = 0; i < MAXPLAYERS; i++) {
+			if (!playeringame[i] || i == consoleplayer) {
+				continue;
+			}
+
+			if (!D_TiccmdsMatch(&snap->cmds[i], &netcmds[i][tic % BACKUPTICS])) {
+				return D_Rollback(tic, lowtic, tick);
+			}
+		}
+
+		netpredictstats.confirmedtics++;
+	}
+
+	oldesttic = (endtic < gametic ? endtic : -1);
+
+	return 0;
+}
+
+//
+// D_RunPredictedTics
+// Replaces the lockstep wait in D_MiniLoop when prediction is active
+//
+
+int D_RunPredictedTics(int (*tick)(void)) {
+	int lowtic;
+	int action;
+
+	if (!PlayersInGame()) {
+		return 0;
+	}
+
+	lowtic = GetLowTic();
+
+	if (holdtic >= 0 && lowtic > holdtic) {
+		holdtic = -1;
+	}
+
+	action = D_CheckPrediction(lowtic, tick);
+
+	while (!action && D_CanRunTic(lowtic)) {
+		action = D_RunTic(lowtic, tick);
+
+		if (holdtic == gametic) {
+			break;
+		}
+	}
+
+	return action;
+}
+
 //
 // D_StartGameLoop
 //
@@ -324,11 +654,14 @@ void D_CheckNetGame(void) {
 		//
 
 		if (M_CheckParm("-server") > 0) {
+			net_module_t* client_module;
+
 			NET_SV_Init();
-			NET_SV_AddModule(&net_loop_server_module);
+			NET_SV_AddModule(NET_SIM_WrapServer(&net_loop_server_module));
 
-			net_loop_client_module.InitClient();
-			addr = net_loop_client_module.ResolveAddress(NULL);
+			client_module = NET_SIM_WrapClient(&net_loop_client_module);
+			client_module->InitClient();
+			addr = client_module->ResolveAddress(NULL);
 		}
 		else {
 			//!
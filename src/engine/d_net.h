@@ -32,6 +32,7 @@
 #include "net_query.h"
 #include "net_server.h"
 #include "net_loop.h"
+#include "net_sim.h"
 
 #ifdef __GNUG__
 #pragma interface
@@ -52,5 +53,29 @@ extern boolean ShowGun;
 extern boolean drone;
 extern boolean    net_cl_new_sync;
 
+//
+// Client-side prediction
+//
+
+typedef struct {
+	int         predictedtics;  // tics run on guessed ticcmds
+	int         confirmedtics;  // guessed tics that turned out right
+	int         corrections;    // rollbacks
+	int         resimtics;      // tics run again by rollbacks
+	int         lastcost;       // usecs spent in the last rollback
+	uint64_t    totalcost;      // usecs spent in all rollbacks
+	int         snapshots;
+	int         snapshotsize;   // bytes
+	uint64_t    snapshottime;   // usecs spent writing snapshots
+} netpredictstats_t;
+
+extern boolean netpredicting;   // current tic runs on guessed ticcmds
+extern boolean netrollback;     // re-running tics after a misprediction
+extern netpredictstats_t netpredictstats;
+
+void D_ResetPrediction(void);
+boolean D_PredictionActive(void);
+int D_RunPredictedTics(int (*tick)(void));
+
 #endif
 
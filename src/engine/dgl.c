@@ -22,6 +22,13 @@
 //
 // DESCRIPTION: Inlined OpenGL-exclusive functions
 //
+// Geometry handed to dglDrawGeometry and dglDrawLines is copied
+// into a streaming buffer before it's drawn. Where the driver has
+// buffer storage the buffer stays mapped and is cut into segments,
+// each fenced once the GPU has been given its last draw, so writes
+// only wait if the GPU falls a few frames behind. Otherwise the
+// buffer is orphaned whenever it fills up and at the end of a frame.
+//
 //-----------------------------------------------------------------------------
 
 #ifdef __OpenBSD__
@@ -30,6 +37,8 @@
 #include <SDL3/SDL_opengl.h>
 #endif
 
+#include <stddef.h>
+
 #ifdef __APPLE__
 #include <math.h>
 #endif
@@ -38,16 +47,33 @@
 #include "doomstat.h"
 #include "gl_main.h"
 #include "gl_texture.h"
+#include "gl_batch.h"
 #include "con_console.h"
 #include "i_system.h"
 
 #define MAXINDICES  0x10000
 
+#define DGL_RINGSEGMENTS    3           // frames the GPU may be behind before writes wait
+#define DGL_RINGSEGSIZE     0x400000
+#define DGL_RINGALIGN       16
+
 word statindice = 0;
 
 static word indicecnt = 0;
+static word indicemax = 0;
 static word drawIndices[MAXINDICES];
 
+static rbuffer ringbuffer = 0;
+static byte* ringmap = NULL;    // NULL when orphaning
+static GLsync ringfences[DGL_RINGSEGMENTS];
+static int ringsegments = 0;
+static int ringsegment = 0;
+static int ringpos = 0;
+
+static vtx_t* dgl_prevptr = NULL;
+
+CVAR(r_streambuffer, 1);
+
 //
 // dglLogError
 //
@@ -92,8 +118,6 @@ void dglLogError(const char* message, const char* file, int line) {
 // dglSetVertex
 //
 
-static vtx_t* dgl_prevptr = NULL;
-
 void dglSetVertex(vtx_t* vtx) {
 #ifdef LOG_GLFUNC_CALLS
 	I_Printf("dglSetVertex(vtx=0x%p)\n", vtx);
@@ -127,6 +151,167 @@ void dglTriangle(int v0, int v1, int v2) {
 	drawIndices[indicecnt++] = v0;
 	drawIndices[indicecnt++] = v1;
 	drawIndices[indicecnt++] = v2;
+
+	indicemax = MAX(indicemax, MAX(v0, MAX(v1, v2)));
+}
+
+//
+// dglCreateRing
+//
+
+static boolean dglCreateRing(void) {
+	GLbitfield flags;
+
+	if (ringbuffer) {
+		return true;
+	}
+
+	if (!has_GL_ARB_vertex_buffer_object) {
+		return false;
+	}
+
+	dglGenBuffersARB(1, &ringbuffer);
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, ringbuffer);
+
+	if (has_GL_ARB_buffer_storage && has_GL_ARB_map_buffer_range && has_GL_ARB_sync) {
+		flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		dglBufferStorage(GL_ARRAY_BUFFER_ARB, DGL_RINGSEGMENTS * DGL_RINGSEGSIZE, NULL, flags);
+		ringmap = (byte*)dglMapBufferRange(GL_ARRAY_BUFFER_ARB, 0, DGL_RINGSEGMENTS * DGL_RINGSEGSIZE, flags);
+
+		if (ringmap == NULL) {
+			// storage can't be respecified, so start over with a new buffer
+			dglDeleteBuffersARB(1, &ringbuffer);
+			dglGenBuffersARB(1, &ringbuffer);
+			dglBindBufferARB(GL_ARRAY_BUFFER_ARB, ringbuffer);
+		}
+	}
+
+	if (ringmap) {
+		ringsegments = DGL_RINGSEGMENTS;
+	}
+	else {
+		ringsegments = 1;
+		dglBufferDataARB(GL_ARRAY_BUFFER_ARB, DGL_RINGSEGSIZE, NULL, GL_STREAM_DRAW_ARB);
+	}
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+	dmemset(ringfences, 0, sizeof(ringfences));
+	ringsegment = 0;
+	ringpos = 0;
+
+	CON_DPrintf("dglCreateRing: %s\n", ringmap ? "persistently mapped" : "orphaned");
+
+	return true;
+}
+
+//
+// dglNextRingSegment
+// Fences the segment being written and moves on to the next one,
+// waiting for the GPU if it's still reading from it
+//
+
+static void dglNextRingSegment(void) {
+	GLsync fence;
+
+	ringpos = 0;
+
+	if (!ringmap) {
+		dglBufferDataARB(GL_ARRAY_BUFFER_ARB, DGL_RINGSEGSIZE, NULL, GL_STREAM_DRAW_ARB);
+		return;
+	}
+
+	ringfences[ringsegment] = dglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	ringsegment = (ringsegment + 1) % ringsegments;
+
+	if ((fence = ringfences[ringsegment]) != NULL) {
+		while (dglClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+
+		dglDeleteSync(fence);
+		ringfences[ringsegment] = NULL;
+	}
+}
+
+//
+// dglRingWrite
+// Returns the offset of the data in the ring. The ring must
+// already be bound to GL_ARRAY_BUFFER_ARB
+//
+
+static int dglRingWrite(void* data, int size) {
+	int offset;
+
+	if (ringpos + size > DGL_RINGSEGSIZE) {
+		dglNextRingSegment();
+	}
+
+	offset = ringsegment * DGL_RINGSEGSIZE + ringpos;
+	ringpos += (size + (DGL_RINGALIGN - 1)) & ~(DGL_RINGALIGN - 1);
+
+	if (ringmap) {
+		dmemcpy(ringmap + offset, data, size);
+	}
+	else {
+		dglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, offset, size, data);
+	}
+
+	return offset;
+}
+
+//
+// dglRingDraw
+// Draws out of the ring, or returns false if the caller has to
+// fall back to client arrays
+//
+
+static boolean dglRingDraw(GLenum mode, vtx_t* vtx, int numverts, word* indices, int numindices) {
+	int vsize;
+	int isize;
+	intptr_t voffset;
+	intptr_t ioffset = 0;
+
+	vsize = numverts * sizeof(vtx_t);
+	isize = numindices * sizeof(word);
+
+	if (r_streambuffer.value <= 0 || !dglCreateRing()) {
+		return false;
+	}
+
+	if (vsize + isize + DGL_RINGALIGN > DGL_RINGSEGSIZE) {
+		return false;
+	}
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, ringbuffer);
+
+	// both have to land in the same segment, ahead of its fence
+	if (ringpos + vsize + isize + DGL_RINGALIGN > DGL_RINGSEGSIZE) {
+		dglNextRingSegment();
+	}
+
+	voffset = dglRingWrite(vtx, vsize);
+
+	dglTexCoordPointer(2, GL_FLOAT, sizeof(vtx_t), (void*)(voffset + offsetof(vtx_t, tu)));
+	dglVertexPointer(3, GL_FLOAT, sizeof(vtx_t), (void*)voffset);
+	dglColorPointer(4, GL_UNSIGNED_BYTE, sizeof(vtx_t), (void*)(voffset + offsetof(vtx_t, r)));
+
+	if (indices) {
+		ioffset = dglRingWrite(indices, isize);
+
+		dglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, ringbuffer);
+		dglDrawElements(mode, numindices, GL_UNSIGNED_SHORT, (void*)ioffset);
+		dglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	}
+	else {
+		dglDrawArrays(mode, 0, numverts);
+	}
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+	// the array pointers now point into the ring
+	dgl_prevptr = NULL;
+
+	return true;
 }
 
 //
@@ -138,13 +323,103 @@ void dglDrawGeometry(int count, vtx_t* vtx) {
 	I_Printf("dglDrawGeometry(count=0x%x, vtx=0x%p)\n", count, vtx);
 #endif
 
-	dglDrawElements(GL_TRIANGLES, indicecnt, GL_UNSIGNED_SHORT, drawIndices);
+	if (!indicecnt) {
+		return;
+	}
+
+	// batched 2D goes first so everything lands in the order it was drawn
+	GL_FlushBatch();
+
+	if (!dglRingDraw(GL_TRIANGLES, vtx, indicemax + 1, drawIndices, indicecnt)) {
+		dglSetVertex(vtx);
+		dglDrawElements(GL_TRIANGLES, indicecnt, GL_UNSIGNED_SHORT, drawIndices);
+	}
 
 	if (devparm) {
 		statindice += indicecnt;
 	}
 
 	indicecnt = 0;
+	indicemax = 0;
+}
+
+//
+// dglDrawIndexed
+// Like dglDrawGeometry, but with indices of its own, so it leaves
+// alone any triangles still being added
+//
+
+void dglDrawIndexed(int numverts, vtx_t* vtx, word* indices, int numindices) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("dglDrawIndexed(numverts=0x%x, vtx=0x%p, numindices=0x%x)\n", numverts, vtx, numindices);
+#endif
+
+	if (!numindices) {
+		return;
+	}
+
+	if (!dglRingDraw(GL_TRIANGLES, vtx, numverts, indices, numindices)) {
+		dglSetVertex(vtx);
+		dglDrawElements(GL_TRIANGLES, numindices, GL_UNSIGNED_SHORT, indices);
+	}
+
+	if (devparm) {
+		statindice += numindices;
+	}
+}
+
+//
+// dglDrawLines
+// Draws count vertices as separate lines
+//
+
+void dglDrawLines(int count, vtx_t* vtx) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("dglDrawLines(count=0x%x, vtx=0x%p)\n", count, vtx);
+#endif
+
+	if (count < 2) {
+		return;
+	}
+
+	GL_FlushBatch();
+
+	if (!dglRingDraw(GL_LINES, vtx, count, NULL, 0)) {
+		dglSetVertex(vtx);
+		dglDrawArrays(GL_LINES, 0, count);
+	}
+
+	batchstats.draws++;
+}
+
+//
+// dglEndFrame
+// Moves the ring on so the next frame doesn't write over
+// anything the GPU may still be drawing
+//
+
+void dglEndFrame(void) {
+	if (!ringbuffer || !ringpos) {
+		return;
+	}
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, ringbuffer);
+	dglNextRingSegment();
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+}
+
+//
+// dglInitRing
+// The ring belongs to the old context after a video reset
+//
+
+void dglInitRing(void) {
+	ringbuffer = 0;
+	ringmap = NULL;
+	ringpos = 0;
+	indicecnt = 0;
+	indicemax = 0;
+	dgl_prevptr = NULL;
 }
 
 //
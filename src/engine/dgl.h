@@ -50,6 +50,10 @@ void dglLogError(const char* message, const char* file, int line);
 void dglSetVertex(vtx_t* vtx);
 void dglTriangle(int v0, int v1, int v2);
 void dglDrawGeometry(int count, vtx_t* vtx);
+void dglDrawIndexed(int numverts, vtx_t* vtx, word* indices, int numindices);
+void dglDrawLines(int count, vtx_t* vtx);
+void dglEndFrame(void);
+void dglInitRing(void);
 void dglViewFrustum(int width, int height, rfloat fovy, rfloat znear);
 void dglSetVertexColor(vtx_t* v, rcolor c, word count);
 void dglGetColorf(rcolor color, float* argb);
@@ -4248,4 +4252,729 @@ boolean has_GL_EXT_texture_filter_anisotropic = false;
 #define GL_EXT_texture_filter_anisotropic_Init() \
 has_GL_EXT_texture_filter_anisotropic = GL_CheckExtension("GL_EXT_texture_filter_anisotropic");
 
+//
+// GL_ARB_texture_compression
+//
+extern boolean has_GL_ARB_texture_compression;
+
+extern PFNGLCOMPRESSEDTEXIMAGE2DARBPROC _glCompressedTexImage2DARB;
+extern PFNGLGETCOMPRESSEDTEXIMAGEARBPROC _glGetCompressedTexImageARB;
+
+#define GL_ARB_texture_compression_Define() \
+boolean has_GL_ARB_texture_compression = false; \
+PFNGLCOMPRESSEDTEXIMAGE2DARBPROC _glCompressedTexImage2DARB = NULL; \
+PFNGLGETCOMPRESSEDTEXIMAGEARBPROC _glGetCompressedTexImageARB = NULL
+
+#define GL_ARB_texture_compression_Init() \
+has_GL_ARB_texture_compression = GL_CheckExtension("GL_ARB_texture_compression"); \
+_glCompressedTexImage2DARB = GL_RegisterProc("glCompressedTexImage2DARB"); \
+_glGetCompressedTexImageARB = GL_RegisterProc("glGetCompressedTexImageARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglCompressedTexImage2DARB(target, level, internalformat, width, height, border, imageSize, data) _glCompressedTexImage2DARB(target, level, internalformat, width, height, border, imageSize, data)
+#define dglGetCompressedTexImageARB(target, level, img) _glGetCompressedTexImageARB(target, level, img)
+
+#else
+
+d_inline static void glCompressedTexImage2DARB_DEBUG(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glCompressedTexImage2DARB(target=0x%x, level=%i, internalformat=0x%x, width=%i, height=%i, border=%i, imageSize=%i, data=%p)\n", file, line, target, level, internalformat, width, height, border, imageSize, data);
+#endif
+	_glCompressedTexImage2DARB(target, level, internalformat, width, height, border, imageSize, data);
+	dglLogError("glCompressedTexImage2DARB", file, line);
+}
+
+d_inline static void glGetCompressedTexImageARB_DEBUG(GLenum target, GLint level, GLvoid* img, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGetCompressedTexImageARB(target=0x%x, level=%i, img=%p)\n", file, line, target, level, img);
+#endif
+	_glGetCompressedTexImageARB(target, level, img);
+	dglLogError("glGetCompressedTexImageARB", file, line);
+}
+
+#define dglCompressedTexImage2DARB(target, level, internalformat, width, height, border, imageSize, data) glCompressedTexImage2DARB_DEBUG(target, level, internalformat, width, height, border, imageSize, data, __FILE__, __LINE__)
+#define dglGetCompressedTexImageARB(target, level, img) glGetCompressedTexImageARB_DEBUG(target, level, img, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_EXT_texture_compression_s3tc
+//
+extern boolean has_GL_EXT_texture_compression_s3tc;
+
+#define GL_EXT_texture_compression_s3tc_Define() \
+boolean has_GL_EXT_texture_compression_s3tc = false;
+
+#define GL_EXT_texture_compression_s3tc_Init() \
+has_GL_EXT_texture_compression_s3tc = GL_CheckExtension("GL_EXT_texture_compression_s3tc");
+
+//
+// GL_ARB_texture_compression_bptc
+//
+extern boolean has_GL_ARB_texture_compression_bptc;
+
+#define GL_ARB_texture_compression_bptc_Define() \
+boolean has_GL_ARB_texture_compression_bptc = false;
+
+#define GL_ARB_texture_compression_bptc_Init() \
+has_GL_ARB_texture_compression_bptc = GL_CheckExtension("GL_ARB_texture_compression_bptc");
+
+//
+// GL_EXT_framebuffer_object
+// Only glGenerateMipmapEXT is used
+//
+extern boolean has_GL_EXT_framebuffer_object;
+
+extern PFNGLGENERATEMIPMAPEXTPROC _glGenerateMipmapEXT;
+
+#define GL_EXT_framebuffer_object_Define() \
+boolean has_GL_EXT_framebuffer_object = false; \
+PFNGLGENERATEMIPMAPEXTPROC _glGenerateMipmapEXT = NULL
+
+#define GL_EXT_framebuffer_object_Init() \
+has_GL_EXT_framebuffer_object = GL_CheckExtension("GL_EXT_framebuffer_object"); \
+_glGenerateMipmapEXT = GL_RegisterProc("glGenerateMipmapEXT")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglGenerateMipmapEXT(target) _glGenerateMipmapEXT(target)
+
+#else
+
+d_inline static void glGenerateMipmapEXT_DEBUG(GLenum target, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGenerateMipmapEXT(target=0x%x)\n", file, line, target);
+#endif
+	_glGenerateMipmapEXT(target);
+	dglLogError("glGenerateMipmapEXT", file, line);
+}
+
+#define dglGenerateMipmapEXT(target) glGenerateMipmapEXT_DEBUG(target, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_occlusion_query
+//
+extern boolean has_GL_ARB_occlusion_query;
+
+extern PFNGLGENQUERIESARBPROC _glGenQueriesARB;
+extern PFNGLDELETEQUERIESARBPROC _glDeleteQueriesARB;
+extern PFNGLBEGINQUERYARBPROC _glBeginQueryARB;
+extern PFNGLENDQUERYARBPROC _glEndQueryARB;
+extern PFNGLGETQUERYOBJECTUIVARBPROC _glGetQueryObjectuivARB;
+
+#define GL_ARB_occlusion_query_Define() \
+boolean has_GL_ARB_occlusion_query = false; \
+PFNGLGENQUERIESARBPROC _glGenQueriesARB = NULL; \
+PFNGLDELETEQUERIESARBPROC _glDeleteQueriesARB = NULL; \
+PFNGLBEGINQUERYARBPROC _glBeginQueryARB = NULL; \
+PFNGLENDQUERYARBPROC _glEndQueryARB = NULL; \
+PFNGLGETQUERYOBJECTUIVARBPROC _glGetQueryObjectuivARB = NULL
+
+#define GL_ARB_occlusion_query_Init() \
+has_GL_ARB_occlusion_query = GL_CheckExtension("GL_ARB_occlusion_query"); \
+_glGenQueriesARB = GL_RegisterProc("glGenQueriesARB"); \
+_glDeleteQueriesARB = GL_RegisterProc("glDeleteQueriesARB"); \
+_glBeginQueryARB = GL_RegisterProc("glBeginQueryARB"); \
+_glEndQueryARB = GL_RegisterProc("glEndQueryARB"); \
+_glGetQueryObjectuivARB = GL_RegisterProc("glGetQueryObjectuivARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglGenQueriesARB(n, ids) _glGenQueriesARB(n, ids)
+#define dglDeleteQueriesARB(n, ids) _glDeleteQueriesARB(n, ids)
+#define dglBeginQueryARB(target, id) _glBeginQueryARB(target, id)
+#define dglEndQueryARB(target) _glEndQueryARB(target)
+#define dglGetQueryObjectuivARB(id, pname, params) _glGetQueryObjectuivARB(id, pname, params)
+
+#else
+
+d_inline static void glGenQueriesARB_DEBUG(GLsizei n, GLuint* ids, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGenQueriesARB(n=%i, ids=%p)\n", file, line, n, ids);
+#endif
+	_glGenQueriesARB(n, ids);
+	dglLogError("glGenQueriesARB", file, line);
+}
+
+d_inline static void glDeleteQueriesARB_DEBUG(GLsizei n, const GLuint* ids, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDeleteQueriesARB(n=%i, ids=%p)\n", file, line, n, ids);
+#endif
+	_glDeleteQueriesARB(n, ids);
+	dglLogError("glDeleteQueriesARB", file, line);
+}
+
+d_inline static void glBeginQueryARB_DEBUG(GLenum target, GLuint id, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glBeginQueryARB(target=0x%x, id=%u)\n", file, line, target, id);
+#endif
+	_glBeginQueryARB(target, id);
+	dglLogError("glBeginQueryARB", file, line);
+}
+
+d_inline static void glEndQueryARB_DEBUG(GLenum target, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glEndQueryARB(target=0x%x)\n", file, line, target);
+#endif
+	_glEndQueryARB(target);
+	dglLogError("glEndQueryARB", file, line);
+}
+
+d_inline static void glGetQueryObjectuivARB_DEBUG(GLuint id, GLenum pname, GLuint* params, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGetQueryObjectuivARB(id=%u, pname=0x%x, params=%p)\n", file, line, id, pname, params);
+#endif
+	_glGetQueryObjectuivARB(id, pname, params);
+	dglLogError("glGetQueryObjectuivARB", file, line);
+}
+
+#define dglGenQueriesARB(n, ids) glGenQueriesARB_DEBUG(n, ids, __FILE__, __LINE__)
+#define dglDeleteQueriesARB(n, ids) glDeleteQueriesARB_DEBUG(n, ids, __FILE__, __LINE__)
+#define dglBeginQueryARB(target, id) glBeginQueryARB_DEBUG(target, id, __FILE__, __LINE__)
+#define dglEndQueryARB(target) glEndQueryARB_DEBUG(target, __FILE__, __LINE__)
+#define dglGetQueryObjectuivARB(id, pname, params) glGetQueryObjectuivARB_DEBUG(id, pname, params, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_shader_objects
+//
+extern boolean has_GL_ARB_shader_objects;
+
+extern PFNGLCREATESHADEROBJECTARBPROC _glCreateShaderObjectARB;
+extern PFNGLSHADERSOURCEARBPROC _glShaderSourceARB;
+extern PFNGLCOMPILESHADERARBPROC _glCompileShaderARB;
+extern PFNGLCREATEPROGRAMOBJECTARBPROC _glCreateProgramObjectARB;
+extern PFNGLATTACHOBJECTARBPROC _glAttachObjectARB;
+extern PFNGLLINKPROGRAMARBPROC _glLinkProgramARB;
+extern PFNGLUSEPROGRAMOBJECTARBPROC _glUseProgramObjectARB;
+extern PFNGLDELETEOBJECTARBPROC _glDeleteObjectARB;
+extern PFNGLGETOBJECTPARAMETERIVARBPROC _glGetObjectParameterivARB;
+extern PFNGLGETINFOLOGARBPROC _glGetInfoLogARB;
+extern PFNGLGETUNIFORMLOCATIONARBPROC _glGetUniformLocationARB;
+extern PFNGLUNIFORM1IARBPROC _glUniform1iARB;
+extern PFNGLUNIFORM1FARBPROC _glUniform1fARB;
+extern PFNGLUNIFORM2FARBPROC _glUniform2fARB;
+extern PFNGLUNIFORM3FARBPROC _glUniform3fARB;
+extern PFNGLUNIFORM4FARBPROC _glUniform4fARB;
+
+#define GL_ARB_shader_objects_Define() \
+boolean has_GL_ARB_shader_objects = false; \
+PFNGLCREATESHADEROBJECTARBPROC _glCreateShaderObjectARB = NULL; \
+PFNGLSHADERSOURCEARBPROC _glShaderSourceARB = NULL; \
+PFNGLCOMPILESHADERARBPROC _glCompileShaderARB = NULL; \
+PFNGLCREATEPROGRAMOBJECTARBPROC _glCreateProgramObjectARB = NULL; \
+PFNGLATTACHOBJECTARBPROC _glAttachObjectARB = NULL; \
+PFNGLLINKPROGRAMARBPROC _glLinkProgramARB = NULL; \
+PFNGLUSEPROGRAMOBJECTARBPROC _glUseProgramObjectARB = NULL; \
+PFNGLDELETEOBJECTARBPROC _glDeleteObjectARB = NULL; \
+PFNGLGETOBJECTPARAMETERIVARBPROC _glGetObjectParameterivARB = NULL; \
+PFNGLGETINFOLOGARBPROC _glGetInfoLogARB = NULL; \
+PFNGLGETUNIFORMLOCATIONARBPROC _glGetUniformLocationARB = NULL; \
+PFNGLUNIFORM1IARBPROC _glUniform1iARB = NULL; \
+PFNGLUNIFORM1FARBPROC _glUniform1fARB = NULL; \
+PFNGLUNIFORM2FARBPROC _glUniform2fARB = NULL; \
+PFNGLUNIFORM3FARBPROC _glUniform3fARB = NULL; \
+PFNGLUNIFORM4FARBPROC _glUniform4fARB = NULL
+
+#define GL_ARB_shader_objects_Init() \
+has_GL_ARB_shader_objects = GL_CheckExtension("GL_ARB_shader_objects"); \
+_glCreateShaderObjectARB = GL_RegisterProc("glCreateShaderObjectARB"); \
+_glShaderSourceARB = GL_RegisterProc("glShaderSourceARB"); \
+_glCompileShaderARB = GL_RegisterProc("glCompileShaderARB"); \
+_glCreateProgramObjectARB = GL_RegisterProc("glCreateProgramObjectARB"); \
+_glAttachObjectARB = GL_RegisterProc("glAttachObjectARB"); \
+_glLinkProgramARB = GL_RegisterProc("glLinkProgramARB"); \
+_glUseProgramObjectARB = GL_RegisterProc("glUseProgramObjectARB"); \
+_glDeleteObjectARB = GL_RegisterProc("glDeleteObjectARB"); \
+_glGetObjectParameterivARB = GL_RegisterProc("glGetObjectParameterivARB"); \
+_glGetInfoLogARB = GL_RegisterProc("glGetInfoLogARB"); \
+_glGetUniformLocationARB = GL_RegisterProc("glGetUniformLocationARB"); \
+_glUniform1iARB = GL_RegisterProc("glUniform1iARB"); \
+_glUniform1fARB = GL_RegisterProc("glUniform1fARB"); \
+_glUniform2fARB = GL_RegisterProc("glUniform2fARB"); \
+_glUniform3fARB = GL_RegisterProc("glUniform3fARB"); \
+_glUniform4fARB = GL_RegisterProc("glUniform4fARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglCreateShaderObjectARB(shaderType) _glCreateShaderObjectARB(shaderType)
+#define dglShaderSourceARB(shaderObj, count, string, length) _glShaderSourceARB(shaderObj, count, string, length)
+#define dglCompileShaderARB(shaderObj) _glCompileShaderARB(shaderObj)
+#define dglCreateProgramObjectARB() _glCreateProgramObjectARB()
+#define dglAttachObjectARB(containerObj, obj) _glAttachObjectARB(containerObj, obj)
+#define dglLinkProgramARB(programObj) _glLinkProgramARB(programObj)
+#define dglUseProgramObjectARB(programObj) _glUseProgramObjectARB(programObj)
+#define dglDeleteObjectARB(obj) _glDeleteObjectARB(obj)
+#define dglGetObjectParameterivARB(obj, pname, params) _glGetObjectParameterivARB(obj, pname, params)
+#define dglGetInfoLogARB(obj, maxLength, length, infoLog) _glGetInfoLogARB(obj, maxLength, length, infoLog)
+#define dglGetUniformLocationARB(programObj, name) _glGetUniformLocationARB(programObj, name)
+#define dglUniform1iARB(location, v0) _glUniform1iARB(location, v0)
+#define dglUniform1fARB(location, v0) _glUniform1fARB(location, v0)
+#define dglUniform2fARB(location, v0, v1) _glUniform2fARB(location, v0, v1)
+#define dglUniform3fARB(location, v0, v1, v2) _glUniform3fARB(location, v0, v1, v2)
+#define dglUniform4fARB(location, v0, v1, v2, v3) _glUniform4fARB(location, v0, v1, v2, v3)
+
+#else
+
+d_inline static GLhandleARB glCreateShaderObjectARB_DEBUG(GLenum shaderType, const char* file, int line) {
+	GLhandleARB ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glCreateShaderObjectARB(shaderType=0x%x)\n", file, line, shaderType);
+#endif
+	ret = _glCreateShaderObjectARB(shaderType);
+	dglLogError("glCreateShaderObjectARB", file, line);
+	return ret;
+}
+
+d_inline static void glShaderSourceARB_DEBUG(GLhandleARB shaderObj, GLsizei count, const GLcharARB** string, const GLint* length, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glShaderSourceARB(shaderObj=%u, count=%i, string=%p, length=%p)\n", file, line, (unsigned int)(uintptr_t)shaderObj, count, string, length);
+#endif
+	_glShaderSourceARB(shaderObj, count, string, length);
+	dglLogError("glShaderSourceARB", file, line);
+}
+
+d_inline static void glCompileShaderARB_DEBUG(GLhandleARB shaderObj, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glCompileShaderARB(shaderObj=%u)\n", file, line, (unsigned int)(uintptr_t)shaderObj);
+#endif
+	_glCompileShaderARB(shaderObj);
+	dglLogError("glCompileShaderARB", file, line);
+}
+
+d_inline static GLhandleARB glCreateProgramObjectARB_DEBUG(const char* file, int line) {
+	GLhandleARB ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glCreateProgramObjectARB()\n", file, line);
+#endif
+	ret = _glCreateProgramObjectARB();
+	dglLogError("glCreateProgramObjectARB", file, line);
+	return ret;
+}
+
+d_inline static void glAttachObjectARB_DEBUG(GLhandleARB containerObj, GLhandleARB obj, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glAttachObjectARB(containerObj=%u, obj=%u)\n", file, line, (unsigned int)(uintptr_t)containerObj, (unsigned int)(uintptr_t)obj);
+#endif
+	_glAttachObjectARB(containerObj, obj);
+	dglLogError("glAttachObjectARB", file, line);
+}
+
+d_inline static void glLinkProgramARB_DEBUG(GLhandleARB programObj, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glLinkProgramARB(programObj=%u)\n", file, line, (unsigned int)(uintptr_t)programObj);
+#endif
+	_glLinkProgramARB(programObj);
+	dglLogError("glLinkProgramARB", file, line);
+}
+
+d_inline static void glUseProgramObjectARB_DEBUG(GLhandleARB programObj, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUseProgramObjectARB(programObj=%u)\n", file, line, (unsigned int)(uintptr_t)programObj);
+#endif
+	_glUseProgramObjectARB(programObj);
+	dglLogError("glUseProgramObjectARB", file, line);
+}
+
+d_inline static void glDeleteObjectARB_DEBUG(GLhandleARB obj, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDeleteObjectARB(obj=%u)\n", file, line, (unsigned int)(uintptr_t)obj);
+#endif
+	_glDeleteObjectARB(obj);
+	dglLogError("glDeleteObjectARB", file, line);
+}
+
+d_inline static void glGetObjectParameterivARB_DEBUG(GLhandleARB obj, GLenum pname, GLint* params, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGetObjectParameterivARB(obj=%u, pname=0x%x, params=%p)\n", file, line, (unsigned int)(uintptr_t)obj, pname, params);
+#endif
+	_glGetObjectParameterivARB(obj, pname, params);
+	dglLogError("glGetObjectParameterivARB", file, line);
+}
+
+d_inline static void glGetInfoLogARB_DEBUG(GLhandleARB obj, GLsizei maxLength, GLsizei* length, GLcharARB* infoLog, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGetInfoLogARB(obj=%u, maxLength=%i, length=%p, infoLog=%p)\n", file, line, (unsigned int)(uintptr_t)obj, maxLength, length, infoLog);
+#endif
+	_glGetInfoLogARB(obj, maxLength, length, infoLog);
+	dglLogError("glGetInfoLogARB", file, line);
+}
+
+d_inline static GLint glGetUniformLocationARB_DEBUG(GLhandleARB programObj, const GLcharARB* name, const char* file, int line) {
+	GLint ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glGetUniformLocationARB(programObj=%u, name=%s)\n", file, line, (unsigned int)(uintptr_t)programObj, name);
+#endif
+	ret = _glGetUniformLocationARB(programObj, name);
+	dglLogError("glGetUniformLocationARB", file, line);
+	return ret;
+}
+
+d_inline static void glUniform1iARB_DEBUG(GLint location, GLint v0, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUniform1iARB(location=%i, v0=%i)\n", file, line, location, v0);
+#endif
+	_glUniform1iARB(location, v0);
+	dglLogError("glUniform1iARB", file, line);
+}
+
+d_inline static void glUniform1fARB_DEBUG(GLint location, GLfloat v0, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUniform1fARB(location=%i, v0=%f)\n", file, line, location, v0);
+#endif
+	_glUniform1fARB(location, v0);
+	dglLogError("glUniform1fARB", file, line);
+}
+
+d_inline static void glUniform2fARB_DEBUG(GLint location, GLfloat v0, GLfloat v1, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUniform2fARB(location=%i, v0=%f, v1=%f)\n", file, line, location, v0, v1);
+#endif
+	_glUniform2fARB(location, v0, v1);
+	dglLogError("glUniform2fARB", file, line);
+}
+
+d_inline static void glUniform3fARB_DEBUG(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUniform3fARB(location=%i, v0=%f, v1=%f, v2=%f)\n", file, line, location, v0, v1, v2);
+#endif
+	_glUniform3fARB(location, v0, v1, v2);
+	dglLogError("glUniform3fARB", file, line);
+}
+
+d_inline static void glUniform4fARB_DEBUG(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glUniform4fARB(location=%i, v0=%f, v1=%f, v2=%f, v3=%f)\n", file, line, location, v0, v1, v2, v3);
+#endif
+	_glUniform4fARB(location, v0, v1, v2, v3);
+	dglLogError("glUniform4fARB", file, line);
+}
+
+#define dglCreateShaderObjectARB(shaderType) glCreateShaderObjectARB_DEBUG(shaderType, __FILE__, __LINE__)
+#define dglShaderSourceARB(shaderObj, count, string, length) glShaderSourceARB_DEBUG(shaderObj, count, string, length, __FILE__, __LINE__)
+#define dglCompileShaderARB(shaderObj) glCompileShaderARB_DEBUG(shaderObj, __FILE__, __LINE__)
+#define dglCreateProgramObjectARB() glCreateProgramObjectARB_DEBUG(__FILE__, __LINE__)
+#define dglAttachObjectARB(containerObj, obj) glAttachObjectARB_DEBUG(containerObj, obj, __FILE__, __LINE__)
+#define dglLinkProgramARB(programObj) glLinkProgramARB_DEBUG(programObj, __FILE__, __LINE__)
+#define dglUseProgramObjectARB(programObj) glUseProgramObjectARB_DEBUG(programObj, __FILE__, __LINE__)
+#define dglDeleteObjectARB(obj) glDeleteObjectARB_DEBUG(obj, __FILE__, __LINE__)
+#define dglGetObjectParameterivARB(obj, pname, params) glGetObjectParameterivARB_DEBUG(obj, pname, params, __FILE__, __LINE__)
+#define dglGetInfoLogARB(obj, maxLength, length, infoLog) glGetInfoLogARB_DEBUG(obj, maxLength, length, infoLog, __FILE__, __LINE__)
+#define dglGetUniformLocationARB(programObj, name) glGetUniformLocationARB_DEBUG(programObj, name, __FILE__, __LINE__)
+#define dglUniform1iARB(location, v0) glUniform1iARB_DEBUG(location, v0, __FILE__, __LINE__)
+#define dglUniform1fARB(location, v0) glUniform1fARB_DEBUG(location, v0, __FILE__, __LINE__)
+#define dglUniform2fARB(location, v0, v1) glUniform2fARB_DEBUG(location, v0, v1, __FILE__, __LINE__)
+#define dglUniform3fARB(location, v0, v1, v2) glUniform3fARB_DEBUG(location, v0, v1, v2, __FILE__, __LINE__)
+#define dglUniform4fARB(location, v0, v1, v2, v3) glUniform4fARB_DEBUG(location, v0, v1, v2, v3, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_vertex_shader
+//
+extern boolean has_GL_ARB_vertex_shader;
+
+extern PFNGLBINDATTRIBLOCATIONARBPROC _glBindAttribLocationARB;
+extern PFNGLVERTEXATTRIBPOINTERARBPROC _glVertexAttribPointerARB;
+extern PFNGLENABLEVERTEXATTRIBARRAYARBPROC _glEnableVertexAttribArrayARB;
+extern PFNGLDISABLEVERTEXATTRIBARRAYARBPROC _glDisableVertexAttribArrayARB;
+
+#define GL_ARB_vertex_shader_Define() \
+boolean has_GL_ARB_vertex_shader = false; \
+PFNGLBINDATTRIBLOCATIONARBPROC _glBindAttribLocationARB = NULL; \
+PFNGLVERTEXATTRIBPOINTERARBPROC _glVertexAttribPointerARB = NULL; \
+PFNGLENABLEVERTEXATTRIBARRAYARBPROC _glEnableVertexAttribArrayARB = NULL; \
+PFNGLDISABLEVERTEXATTRIBARRAYARBPROC _glDisableVertexAttribArrayARB = NULL
+
+#define GL_ARB_vertex_shader_Init() \
+has_GL_ARB_vertex_shader = GL_CheckExtension("GL_ARB_vertex_shader"); \
+_glBindAttribLocationARB = GL_RegisterProc("glBindAttribLocationARB"); \
+_glVertexAttribPointerARB = GL_RegisterProc("glVertexAttribPointerARB"); \
+_glEnableVertexAttribArrayARB = GL_RegisterProc("glEnableVertexAttribArrayARB"); \
+_glDisableVertexAttribArrayARB = GL_RegisterProc("glDisableVertexAttribArrayARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglBindAttribLocationARB(programObj, index, name) _glBindAttribLocationARB(programObj, index, name)
+#define dglVertexAttribPointerARB(index, size, type, normalized, stride, pointer) _glVertexAttribPointerARB(index, size, type, normalized, stride, pointer)
+#define dglEnableVertexAttribArrayARB(index) _glEnableVertexAttribArrayARB(index)
+#define dglDisableVertexAttribArrayARB(index) _glDisableVertexAttribArrayARB(index)
+
+#else
+
+d_inline static void glBindAttribLocationARB_DEBUG(GLhandleARB programObj, GLuint index, const GLcharARB* name, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glBindAttribLocationARB(programObj=%u, index=%u, name=%s)\n", file, line, (unsigned int)(uintptr_t)programObj, index, name);
+#endif
+	_glBindAttribLocationARB(programObj, index, name);
+	dglLogError("glBindAttribLocationARB", file, line);
+}
+
+d_inline static void glVertexAttribPointerARB_DEBUG(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glVertexAttribPointerARB(index=%u, size=%i, type=0x%x, normalized=%i, stride=%i, pointer=%p)\n", file, line, index, size, type, normalized, stride, pointer);
+#endif
+	_glVertexAttribPointerARB(index, size, type, normalized, stride, pointer);
+	dglLogError("glVertexAttribPointerARB", file, line);
+}
+
+d_inline static void glEnableVertexAttribArrayARB_DEBUG(GLuint index, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glEnableVertexAttribArrayARB(index=%u)\n", file, line, index);
+#endif
+	_glEnableVertexAttribArrayARB(index);
+	dglLogError("glEnableVertexAttribArrayARB", file, line);
+}
+
+d_inline static void glDisableVertexAttribArrayARB_DEBUG(GLuint index, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDisableVertexAttribArrayARB(index=%u)\n", file, line, index);
+#endif
+	_glDisableVertexAttribArrayARB(index);
+	dglLogError("glDisableVertexAttribArrayARB", file, line);
+}
+
+#define dglBindAttribLocationARB(programObj, index, name) glBindAttribLocationARB_DEBUG(programObj, index, name, __FILE__, __LINE__)
+#define dglVertexAttribPointerARB(index, size, type, normalized, stride, pointer) glVertexAttribPointerARB_DEBUG(index, size, type, normalized, stride, pointer, __FILE__, __LINE__)
+#define dglEnableVertexAttribArrayARB(index) glEnableVertexAttribArrayARB_DEBUG(index, __FILE__, __LINE__)
+#define dglDisableVertexAttribArrayARB(index) glDisableVertexAttribArrayARB_DEBUG(index, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_fragment_shader
+//
+extern boolean has_GL_ARB_fragment_shader;
+
+#define GL_ARB_fragment_shader_Define() \
+boolean has_GL_ARB_fragment_shader = false;
+
+#define GL_ARB_fragment_shader_Init() \
+has_GL_ARB_fragment_shader = GL_CheckExtension("GL_ARB_fragment_shader");
+
+//
+// GL_ARB_shading_language_100
+//
+extern boolean has_GL_ARB_shading_language_100;
+
+#define GL_ARB_shading_language_100_Define() \
+boolean has_GL_ARB_shading_language_100 = false;
+
+#define GL_ARB_shading_language_100_Init() \
+has_GL_ARB_shading_language_100 = GL_CheckExtension("GL_ARB_shading_language_100");
+
+//
+// GL_ARB_instanced_arrays
+//
+extern boolean has_GL_ARB_instanced_arrays;
+
+extern PFNGLVERTEXATTRIBDIVISORARBPROC _glVertexAttribDivisorARB;
+
+#define GL_ARB_instanced_arrays_Define() \
+boolean has_GL_ARB_instanced_arrays = false; \
+PFNGLVERTEXATTRIBDIVISORARBPROC _glVertexAttribDivisorARB = NULL
+
+#define GL_ARB_instanced_arrays_Init() \
+has_GL_ARB_instanced_arrays = GL_CheckExtension("GL_ARB_instanced_arrays"); \
+_glVertexAttribDivisorARB = GL_RegisterProc("glVertexAttribDivisorARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglVertexAttribDivisorARB(index, divisor) _glVertexAttribDivisorARB(index, divisor)
+
+#else
+
+d_inline static void glVertexAttribDivisorARB_DEBUG(GLuint index, GLuint divisor, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glVertexAttribDivisorARB(index=%u, divisor=%u)\n", file, line, index, divisor);
+#endif
+	_glVertexAttribDivisorARB(index, divisor);
+	dglLogError("glVertexAttribDivisorARB", file, line);
+}
+
+#define dglVertexAttribDivisorARB(index, divisor) glVertexAttribDivisorARB_DEBUG(index, divisor, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_draw_instanced
+//
+extern boolean has_GL_ARB_draw_instanced;
+
+extern PFNGLDRAWARRAYSINSTANCEDARBPROC _glDrawArraysInstancedARB;
+
+#define GL_ARB_draw_instanced_Define() \
+boolean has_GL_ARB_draw_instanced = false; \
+PFNGLDRAWARRAYSINSTANCEDARBPROC _glDrawArraysInstancedARB = NULL
+
+#define GL_ARB_draw_instanced_Init() \
+has_GL_ARB_draw_instanced = GL_CheckExtension("GL_ARB_draw_instanced"); \
+_glDrawArraysInstancedARB = GL_RegisterProc("glDrawArraysInstancedARB")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglDrawArraysInstancedARB(mode, first, count, primcount) _glDrawArraysInstancedARB(mode, first, count, primcount)
+
+#else
+
+d_inline static void glDrawArraysInstancedARB_DEBUG(GLenum mode, GLint first, GLsizei count, GLsizei primcount, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDrawArraysInstancedARB(mode=0x%x, first=%i, count=%i, primcount=%i)\n", file, line, mode, first, count, primcount);
+#endif
+	_glDrawArraysInstancedARB(mode, first, count, primcount);
+	dglLogError("glDrawArraysInstancedARB", file, line);
+}
+
+#define dglDrawArraysInstancedARB(mode, first, count, primcount) glDrawArraysInstancedARB_DEBUG(mode, first, count, primcount, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_map_buffer_range
+//
+extern boolean has_GL_ARB_map_buffer_range;
+
+extern PFNGLMAPBUFFERRANGEPROC _glMapBufferRange;
+extern PFNGLFLUSHMAPPEDBUFFERRANGEPROC _glFlushMappedBufferRange;
+
+#define GL_ARB_map_buffer_range_Define() \
+boolean has_GL_ARB_map_buffer_range = false; \
+PFNGLMAPBUFFERRANGEPROC _glMapBufferRange = NULL; \
+PFNGLFLUSHMAPPEDBUFFERRANGEPROC _glFlushMappedBufferRange = NULL
+
+#define GL_ARB_map_buffer_range_Init() \
+has_GL_ARB_map_buffer_range = GL_CheckExtension("GL_ARB_map_buffer_range"); \
+_glMapBufferRange = GL_RegisterProc("glMapBufferRange"); \
+_glFlushMappedBufferRange = GL_RegisterProc("glFlushMappedBufferRange")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglMapBufferRange(target, offset, length, access) _glMapBufferRange(target, offset, length, access)
+#define dglFlushMappedBufferRange(target, offset, length) _glFlushMappedBufferRange(target, offset, length)
+
+#else
+
+d_inline static void* glMapBufferRange_DEBUG(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, const char* file, int line) {
+	void* ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glMapBufferRange(target=0x%x, offset=%li, length=%li, access=0x%x)\n", file, line, target, (long)offset, (long)length, access);
+#endif
+	ret = _glMapBufferRange(target, offset, length, access);
+	dglLogError("glMapBufferRange", file, line);
+	return ret;
+}
+
+d_inline static void glFlushMappedBufferRange_DEBUG(GLenum target, GLintptr offset, GLsizeiptr length, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glFlushMappedBufferRange(target=0x%x, offset=%li, length=%li)\n", file, line, target, (long)offset, (long)length);
+#endif
+	_glFlushMappedBufferRange(target, offset, length);
+	dglLogError("glFlushMappedBufferRange", file, line);
+}
+
+#define dglMapBufferRange(target, offset, length, access) glMapBufferRange_DEBUG(target, offset, length, access, __FILE__, __LINE__)
+#define dglFlushMappedBufferRange(target, offset, length) glFlushMappedBufferRange_DEBUG(target, offset, length, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_buffer_storage
+//
+extern boolean has_GL_ARB_buffer_storage;
+
+extern PFNGLBUFFERSTORAGEPROC _glBufferStorage;
+
+#define GL_ARB_buffer_storage_Define() \
+boolean has_GL_ARB_buffer_storage = false; \
+PFNGLBUFFERSTORAGEPROC _glBufferStorage = NULL
+
+#define GL_ARB_buffer_storage_Init() \
+has_GL_ARB_buffer_storage = GL_CheckExtension("GL_ARB_buffer_storage"); \
+_glBufferStorage = GL_RegisterProc("glBufferStorage")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglBufferStorage(target, size, data, flags) _glBufferStorage(target, size, data, flags)
+
+#else
+
+d_inline static void glBufferStorage_DEBUG(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glBufferStorage(target=0x%x, size=%li, data=%p, flags=0x%x)\n", file, line, target, (long)size, data, flags);
+#endif
+	_glBufferStorage(target, size, data, flags);
+	dglLogError("glBufferStorage", file, line);
+}
+
+#define dglBufferStorage(target, size, data, flags) glBufferStorage_DEBUG(target, size, data, flags, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
+//
+// GL_ARB_sync
+//
+extern boolean has_GL_ARB_sync;
+
+extern PFNGLFENCESYNCPROC _glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC _glClientWaitSync;
+extern PFNGLDELETESYNCPROC _glDeleteSync;
+
+#define GL_ARB_sync_Define() \
+boolean has_GL_ARB_sync = false; \
+PFNGLFENCESYNCPROC _glFenceSync = NULL; \
+PFNGLCLIENTWAITSYNCPROC _glClientWaitSync = NULL; \
+PFNGLDELETESYNCPROC _glDeleteSync = NULL
+
+#define GL_ARB_sync_Init() \
+has_GL_ARB_sync = GL_CheckExtension("GL_ARB_sync"); \
+_glFenceSync = GL_RegisterProc("glFenceSync"); \
+_glClientWaitSync = GL_RegisterProc("glClientWaitSync"); \
+_glDeleteSync = GL_RegisterProc("glDeleteSync")
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglFenceSync(condition, flags) _glFenceSync(condition, flags)
+#define dglClientWaitSync(sync, flags, timeout) _glClientWaitSync(sync, flags, timeout)
+#define dglDeleteSync(sync) _glDeleteSync(sync)
+
+#else
+
+d_inline static GLsync glFenceSync_DEBUG(GLenum condition, GLbitfield flags, const char* file, int line) {
+	GLsync ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glFenceSync(condition=0x%x, flags=0x%x)\n", file, line, condition, flags);
+#endif
+	ret = _glFenceSync(condition, flags);
+	dglLogError("glFenceSync", file, line);
+	return ret;
+}
+
+d_inline static GLenum glClientWaitSync_DEBUG(GLsync sync, GLbitfield flags, GLuint64 timeout, const char* file, int line) {
+	GLenum ret;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glClientWaitSync(sync=%p, flags=0x%x, timeout=%llu)\n", file, line, sync, flags, (unsigned long long)timeout);
+#endif
+	ret = _glClientWaitSync(sync, flags, timeout);
+	dglLogError("glClientWaitSync", file, line);
+	return ret;
+}
+
+d_inline static void glDeleteSync_DEBUG(GLsync sync, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDeleteSync(sync=%p)\n", file, line, sync);
+#endif
+	_glDeleteSync(sync);
+	dglLogError("glDeleteSync", file, line);
+}
+
+#define dglFenceSync(condition, flags) glFenceSync_DEBUG(condition, flags, __FILE__, __LINE__)
+#define dglClientWaitSync(sync, flags, timeout) glClientWaitSync_DEBUG(sync, flags, timeout, __FILE__, __LINE__)
+#define dglDeleteSync(sync) glDeleteSync_DEBUG(sync, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
 #endif // __DGL_H__
@@ -242,6 +242,9 @@ extern  boolean    precache;
 
 #define MAXSENSITIVITY    32
 
+#define BODYQUESIZE 32
+
+extern  mobj_t*     bodyque[BODYQUESIZE];
 extern  int         bodyqueslot;
 
 // Netgame stuff (buffers and pointers, i.e. indices).
@@ -256,6 +259,7 @@ extern  int         maketic;
 extern  int         nettics[MAXNETNODES];
 
 extern ticcmd_t     netcmds[MAXPLAYERS][BACKUPTICS];
+extern  byte        consistency[MAXPLAYERS][BACKUPTICS];
 extern  int         ticdup;
 extern  int         extratics;
 
@@ -131,8 +131,6 @@ char        savedescription[32];
 
 playercontrols_t    Controls;
 
-#define BODYQUESIZE 32
-
 mobj_t* bodyque[BODYQUESIZE];
 int         bodyqueslot;
 
@@ -177,6 +175,7 @@ CVAR_EXTERNAL(p_disable_monster_infighting);
 CVAR_EXTERNAL(m_complexdoom64);
 CVAR_EXTERNAL(m_cacodemonalternative);
 CVAR_EXTERNAL(m_nobuzzsound);
+CVAR_EXTERNAL(net_predict);
 
 CVAR(m_keepartifacts, 0);
 
@@ -207,6 +206,7 @@ void G_RegisterCvars(void) {
 	CON_CvarRegister(&m_keepartifacts);
 	CON_CvarRegister(&m_cacodemonalternative);
 	CON_CvarRegister(&m_nobuzzsound);
+	CON_CvarRegister(&net_predict);
 }
 
 //
@@ -1088,8 +1088,11 @@ void G_Ticker(void) {
 	int         buf;
 	ticcmd_t* cmd;
 
-	G_ActionTicker();
-	CON_Ticker();
+	// a rollback only runs the play simulation again
+	if (!netrollback) {
+		G_ActionTicker();
+		CON_Ticker();
+	}
 
 	if (savenow) {
 		G_DoSaveGame();
@@ -1132,7 +1135,8 @@ void G_Ticker(void) {
 				}
 
 				if (netgame && !netdemo && !(gametic % ticdup)) {
-					if (gametic > BACKUPTICS
+					// guessed ticcmds carry a stale consistency value
+					if (gametic > BACKUPTICS && !netpredicting
 						&& consistency[i][buf] != cmd->consistency) {
 						I_Error("consistency failure (%i should be %i)",
 							cmd->consistency, consistency[i][buf], consoleplayer);
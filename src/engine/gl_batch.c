@@ -0,0 +1,351 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Batched 2D drawing
+//
+// Text, the status bar and the console hand their quads over here
+// instead of drawing them straight away. Vertices are moved into
+// the full view at a scale of 1 as they come in, so one projection
+// covers everything, and quads that follow each other on the same
+// texture are put into one run. Runs keep the order they were added
+// in, since later 2D has to land on top of earlier 2D.
+//
+// The batch is drawn blended and modulated on the first texture
+// unit, without fog or depth testing, once anything else is about
+// to be drawn or the frame is finished.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "gl_main.h"
+#include "gl_batch.h"
+#include "dgl.h"
+#include "r_main.h"
+#include "i_system.h"
+
+#define MAXBATCHVERTS       0x4000
+#define MAXBATCHINDICES     0x6000
+#define MAXBATCHRUNS        256
+#define BATCH_MAXUNITS      4       // as many as GL_SetTextureUnit uses
+
+typedef struct {
+	dtexture texture;   // 0 for untextured
+	int firstvert;
+	int numverts;
+	int firstindex;
+	int numindices;
+} batchrun_t;
+
+typedef struct {
+	GLint viewport[4];
+	GLint matrixmode;
+	GLint activeunit;
+	int numunits;
+	boolean unittextured[BATCH_MAXUNITS];
+	GLint bound;
+	GLint envmode;
+	GLint blendsrc;
+	GLint blenddst;
+	GLfloat depthrange[2];
+	boolean textured;
+	boolean blend;
+	boolean alphatest;
+	boolean fog;
+	boolean depthtest;
+	boolean cull;
+} batchstate_t;
+
+static vtx_t batchverts[MAXBATCHVERTS];
+static word batchindices[MAXBATCHINDICES];
+static batchrun_t batchruns[MAXBATCHRUNS];
+
+static int numbatchverts = 0;
+static int numbatchindices = 0;
+static int numbatchruns = 0;
+
+static boolean flushing = false;
+
+batchstats_t batchstats;
+batchstats_t lastbatchstats;
+
+//
+// GL_BatchGeometry
+// Vertices are laid out for GL_SetOrtho(stretch) at the current
+// ortho scale, and indices count from the first of them
+//
+
+void GL_BatchGeometry(dtexture texture, boolean stretch, vtx_t* vtx, int numverts,
+	const word* indices, int numindices) {
+	batchrun_t* run;
+	int base;
+	int i;
+
+	if (numverts <= 0 || numindices <= 0) {
+		return;
+	}
+
+	if (numverts > MAXBATCHVERTS || numindices > MAXBATCHINDICES) {
+		I_Error("GL_BatchGeometry: %i vertices and %i indices won't fit", numverts, numindices);
+	}
+
+	if (numbatchverts + numverts > MAXBATCHVERTS ||
+		numbatchindices + numindices > MAXBATCHINDICES) {
+		GL_FlushBatch();
+	}
+
+	run = numbatchruns ? &batchruns[numbatchruns - 1] : NULL;
+
+	if (!run || run->texture != texture) {
+		if (numbatchruns == MAXBATCHRUNS) {
+			GL_FlushBatch();
+		}
+
+		run = &batchruns[numbatchruns++];
+		run->texture = texture;
+		run->firstvert = numbatchverts;
+		run->numverts = 0;
+		run->firstindex = numbatchindices;
+		run->numindices = 0;
+	}
+
+	base = run->numverts;
+
+	dmemcpy(&batchverts[numbatchverts], vtx, numverts * sizeof(vtx_t));
+	GL_Map2DVertices(&batchverts[numbatchverts], numverts, stretch);
+
+	for (i = 0; i < numindices; i++) {
+		batchindices[numbatchindices + i] = base + indices[i];
+	}
+
+	numbatchverts += numverts;
+	numbatchindices += numindices;
+	run->numverts += numverts;
+	run->numindices += numindices;
+
+	batchstats.quads += numindices / 6;
+}
+
+//
+// GL_SetCap
+//
+
+static void GL_SetCap(GLenum cap, boolean enable) {
+	if (enable) {
+		dglEnable(cap);
+	}
+	else {
+		dglDisable(cap);
+	}
+}
+
+//
+// GL_Begin2DState
+// The batch can be flushed in the middle of the automap or the
+// world, so it sets up plain blended 2D of its own instead of
+// drawing with whatever combiner, fog or depth range is current.
+// Everything it changes is saved to be put back afterwards
+//
+
+static void GL_Begin2DState(batchstate_t* state) {
+	int i;
+
+	dglGetIntegerv(GL_VIEWPORT, state->viewport);
+	dglGetIntegerv(GL_MATRIX_MODE, &state->matrixmode);
+
+	state->activeunit = GL_TEXTURE0_ARB;
+	state->numunits = 1;
+
+	if (has_GL_ARB_multitexture) {
+		dglGetIntegerv(GL_ACTIVE_TEXTURE_ARB, &state->activeunit);
+		state->numunits = MAX(1, MIN(gl_max_texture_units, BATCH_MAXUNITS));
+
+		// only the first unit is used
+		for (i = 1; i < state->numunits; i++) {
+			dglActiveTextureARB(GL_TEXTURE0_ARB + i);
+			state->unittextured[i] = dglIsEnabled(GL_TEXTURE_2D);
+
+			if (state->unittextured[i]) {
+				dglDisable(GL_TEXTURE_2D);
+			}
+		}
+
+		dglActiveTextureARB(GL_TEXTURE0_ARB);
+	}
+
+	dglGetIntegerv(GL_TEXTURE_BINDING_2D, &state->bound);
+	dglGetTexEnviv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &state->envmode);
+	dglGetIntegerv(GL_BLEND_SRC, &state->blendsrc);
+	dglGetIntegerv(GL_BLEND_DST, &state->blenddst);
+	dglGetFloatv(GL_DEPTH_RANGE, state->depthrange);
+
+	state->textured = dglIsEnabled(GL_TEXTURE_2D);
+	state->blend = dglIsEnabled(GL_BLEND);
+	state->alphatest = dglIsEnabled(GL_ALPHA_TEST);
+	state->fog = dglIsEnabled(GL_FOG);
+	state->depthtest = dglIsEnabled(GL_DEPTH_TEST);
+	state->cull = dglIsEnabled(GL_CULL_FACE);
+
+	dglMatrixMode(GL_PROJECTION);
+	dglPushMatrix();
+	dglLoadIdentity();
+	dglOrtho(0, SCREENWIDTH, SCREENHEIGHT, 0, -1, 1);
+	dglMatrixMode(GL_MODELVIEW);
+	dglPushMatrix();
+	dglLoadIdentity();
+
+	dglViewport(ViewWindowX, ViewWindowY, ViewWidth, ViewHeight);
+
+	dglTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	dglBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	dglDepthRange(0.0f, 1.0f);
+
+	GL_SetCap(GL_BLEND, true);
+	GL_SetCap(GL_ALPHA_TEST, false);
+	GL_SetCap(GL_FOG, false);
+	GL_SetCap(GL_DEPTH_TEST, false);
+	GL_SetCap(GL_CULL_FACE, false);
+}
+
+//
+// GL_End2DState
+// Goes straight to GL rather than through GL_SetState and the
+// texture env setters, so their caches stay right
+//
+
+static void GL_End2DState(batchstate_t* state) {
+	int i;
+
+	GL_SetCap(GL_TEXTURE_2D, state->textured);
+	GL_SetCap(GL_BLEND, state->blend);
+	GL_SetCap(GL_ALPHA_TEST, state->alphatest);
+	GL_SetCap(GL_FOG, state->fog);
+	GL_SetCap(GL_DEPTH_TEST, state->depthtest);
+	GL_SetCap(GL_CULL_FACE, state->cull);
+
+	dglBindTexture(GL_TEXTURE_2D, state->bound);
+	dglTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, state->envmode);
+	dglBlendFunc(state->blendsrc, state->blenddst);
+	dglDepthRange(state->depthrange[0], state->depthrange[1]);
+
+	if (has_GL_ARB_multitexture) {
+		for (i = 1; i < state->numunits; i++) {
+			if (state->unittextured[i]) {
+				dglActiveTextureARB(GL_TEXTURE0_ARB + i);
+				dglEnable(GL_TEXTURE_2D);
+			}
+		}
+
+		dglActiveTextureARB(state->activeunit);
+	}
+
+	dglViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+
+	dglMatrixMode(GL_MODELVIEW);
+	dglPopMatrix();
+	dglMatrixMode(GL_PROJECTION);
+	dglPopMatrix();
+	dglMatrixMode(state->matrixmode);
+}
+
+//
+// GL_FlushBatch
+// Can be called in the middle of drawing anything else, so all
+// the state it touches is put back the way it was found
+//
+
+void GL_FlushBatch(void) {
+	batchstate_t state;
+	boolean texturing;
+	batchrun_t* run;
+	int i;
+
+	if (!numbatchruns || flushing) {
+		return;
+	}
+
+	flushing = true;
+
+	GL_Begin2DState(&state);
+
+	texturing = state.textured;
+
+	for (i = 0; i < numbatchruns; i++) {
+		run = &batchruns[i];
+
+		if (!run->texture) {
+			if (texturing) {
+				dglDisable(GL_TEXTURE_2D);
+				texturing = false;
+			}
+		}
+		else {
+			// wireframe leaves texturing off
+			if (r_fillmode.value > 0 && !texturing) {
+				dglEnable(GL_TEXTURE_2D);
+				texturing = true;
+			}
+
+			dglBindTexture(GL_TEXTURE_2D, run->texture);
+
+			if (devparm) {
+				glBindCalls++;
+			}
+		}
+
+		dglDrawIndexed(run->numverts, &batchverts[run->firstvert],
+			&batchindices[run->firstindex], run->numindices);
+	}
+
+	GL_End2DState(&state);
+
+	batchstats.draws += numbatchruns;
+	batchstats.flushes++;
+
+	numbatchverts = 0;
+	numbatchindices = 0;
+	numbatchruns = 0;
+
+	flushing = false;
+}
+
+//
+// GL_EndBatchFrame
+//
+
+void GL_EndBatchFrame(void) {
+	GL_FlushBatch();
+
+	lastbatchstats = batchstats;
+	dmemset(&batchstats, 0, sizeof(batchstats_t));
+}
+
+//
+// GL_InitBatch
+// Anything left in the batch belongs to the old context after a
+// video reset
+//
+
+void GL_InitBatch(void) {
+	numbatchverts = 0;
+	numbatchindices = 0;
+	numbatchruns = 0;
+	flushing = false;
+}
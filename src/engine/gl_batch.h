@@ -0,0 +1,41 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __GL_BATCH_H__
+#define __GL_BATCH_H__
+
+#include "gl_main.h"
+
+typedef struct {
+	int draws;      // batch runs, unbatched 2D quads and line draws
+	int quads;
+	int flushes;
+} batchstats_t;
+
+extern batchstats_t batchstats;        // frame being drawn
+extern batchstats_t lastbatchstats;    // last finished frame
+
+void GL_BatchGeometry(dtexture texture, boolean stretch, vtx_t* vtx, int numverts,
+	const word* indices, int numindices);
+void GL_FlushBatch(void);
+void GL_EndBatchFrame(void);
+void GL_InitBatch(void);
+
+#endif
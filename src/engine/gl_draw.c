@@ -39,9 +39,29 @@
 #include "dgl.h"
 #include "r_things.h"
 #include "gl_texture.h"
+#include "gl_batch.h"
 #include "gl_draw.h"
 #include "r_main.h"
 
+//
+// Draw_BatchQuad
+// Adds a quad laid out for GL_SetOrtho(0) to the 2D batch
+//
+
+static const word quadindices[6] = { 0, 1, 2, 3, 2, 1 };
+
+void Draw_BatchQuad(dtexture texture, float x, float y, int width, int height,
+	float u1, float u2, float v1, float v2, rcolor c) {
+	vtx_t v[4];
+
+	GL_Set2DQuad(v, x, y, width, height, u1, u2, v1, v2, c);
+	GL_BatchGeometry(texture, false, v, 4, quadindices, 6);
+
+	if (devparm) {
+		vertCount += 4;
+	}
+}
+
 //
 // Draw_GfxImage
 //
@@ -52,11 +72,8 @@ void Draw_GfxImage(int x, int y, const char* name, rcolor color, boolean alpha)
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetupAndDraw2DQuad((float)x, (float)y,
-		gfxwidth[gfxIdx], gfxheight[gfxIdx], 0, 1.0f, 0, 1.0f, color, 0);
-
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchQuad(gfxptr[gfxIdx], (float)x, (float)y,
+		gfxwidth[gfxIdx], gfxheight[gfxIdx], 0, 1.0f, 0, 1.0f, color);
 }
 
 void Draw_GfxImageInter(int x, int y, const char* name, rcolor color, boolean alpha) {
@@ -73,11 +90,8 @@ void Draw_GfxImageInter(int x, int y, const char* name, rcolor color, boolean al
 	float offset_width = 5.0f;
 	float offset_height = 5.0f;
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetupAndDraw2DQuad((float)x - offset_width, (float)y - offset_height,
-		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color, 0);
-
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchQuad(gfxptr[gfxIdx], (float)x - offset_width, (float)y - offset_height,
+		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color);
 }
 
 void Draw_GfxImageLegal(int x, int y, const char* name, rcolor color, boolean alpha) {
@@ -94,11 +108,8 @@ void Draw_GfxImageLegal(int x, int y, const char* name, rcolor color, boolean al
 	float offset_width = 30.0f;
 	float offset_height = 40.0f;
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetupAndDraw2DQuad((float)x - offset_width, (float)y - offset_height,
-		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color, 0);
-
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchQuad(gfxptr[gfxIdx], (float)x - offset_width, (float)y - offset_height,
+		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color);
 }
 
 void Draw_GfxImageTitle(int x, int y, const char* name, rcolor color, boolean alpha) {
@@ -115,11 +126,8 @@ void Draw_GfxImageTitle(int x, int y, const char* name, rcolor color, boolean al
 	float offset_width = 60.0f;
 	float offset_height = 30.0f;
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetupAndDraw2DQuad((float)x - offset_width, (float)y - offset_height,
-		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color, 0);
-
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchQuad(gfxptr[gfxIdx], (float)x - offset_width, (float)y - offset_height,
+		imgWidth * scale, imgHeight * scale, 0, 1.0f, 0, 1.0f, color);
 }
 
 //
@@ -135,16 +143,20 @@ void Draw_Sprite2D(int type, int rot, int frame, int x, int y,
 	int h;
 	int offsetx = 0;
 	int offsety = 0;
-
-	GL_SetState(GLSTATE_BLEND, 1);
+	int lump;
+	dtexture texture;
 
 	sprdef = &spriteinfo[type];
 	sprframe = &sprdef->spriteframes[frame];
+	lump = sprframe->lump[rot];
 
-	GL_BindSpriteTexture(sprframe->lump[rot], pal);
+	GL_BindSpriteTexture(lump, pal);
 
-	w = spritewidth[sprframe->lump[rot]];
-	h = spriteheight[sprframe->lump[rot]];
+	// wireframe doesn't bind sprites at all
+	texture = (cursprite == lump) ? spriteptr[lump][curtrans] : 0;
+
+	w = spritewidth[lump];
+	h = spriteheight[lump];
 
 	if (scale <= 1.0f) {
 		if (sprframe->flip[rot]) {
@@ -154,22 +166,20 @@ void Draw_Sprite2D(int type, int rot, int frame, int x, int y,
 			flip = 0.0f;
 		}
 
-		offsetx = (int)spriteoffset[sprframe->lump[rot]];
-		offsety = (int)spritetopoffset[sprframe->lump[rot]];
+		offsetx = (int)spriteoffset[lump];
+		offsety = (int)spritetopoffset[lump];
 	}
 
 	GL_SetOrthoScale(scale);
 
-	GL_SetupAndDraw2DQuad(flip ? (float)(x + offsetx) - w :
+	Draw_BatchQuad(texture, flip ? (float)(x + offsetx) - w :
 		(float)x - offsetx, (float)y - offsety, w, h,
-		flip, 1.0f - flip, 0, 1.0f, c, 0);
+		flip, 1.0f - flip, 0, 1.0f, c);
 
 	GL_SetOrthoScale(1.0f);
 
 	cursprite = -1;
 	curgfx = -1;
-
-	GL_SetState(GLSTATE_BLEND, 0);
 }
 
 //
@@ -178,7 +188,71 @@ void Draw_Sprite2D(int type, int rot, int frame, int x, int y,
 //
 //
 
+#define MAXSTRINGQUADS  (MAX_MESSAGE_SIZE / 4)
+
 static vtx_t vtxstring[MAX_MESSAGE_SIZE];
+static word idxstring[MAXSTRINGQUADS * 6];
+
+static const word textwinding[6] = { 0, 1, 2, 0, 2, 3 };
+static const word symbolwinding[6] = { 2, 1, 0, 3, 2, 0 };
+
+//
+// Glyph metrics
+// Texture coordinates for every glyph of a font, worked out
+// the first time it's drawn instead of for every character
+//
+
+typedef struct {
+	float tu1;
+	float tu2;
+	float tv1;
+	float tv2;
+} glyphuv_t;
+
+static glyphuv_t sfontuv[ST_FONTSIZE];
+static boolean sfontready = false;
+
+//
+// Draw_SetGlyphs
+//
+
+static void Draw_SetGlyphs(glyphuv_t* uv, const symboldata_t* map, int count, int gfx) {
+	float width = (float)gfxwidth[gfx];
+	float height = (float)gfxheight[gfx];
+	int i;
+
+	for (i = 0; i < count; i++) {
+		uv[i].tu1 = (float)map[i].x / width;
+		uv[i].tu2 = (float)(map[i].x + map[i].w) / width;
+		uv[i].tv1 = (float)map[i].y / height;
+		uv[i].tv2 = (float)(map[i].y + map[i].h) / height;
+	}
+}
+
+//
+// Draw_StringQuad
+// Adds the triangles for the next quad in vtxstring
+//
+
+static void Draw_StringQuad(int quad, const word* winding) {
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		idxstring[quad * 6 + i] = quad * 4 + winding[i];
+	}
+}
+
+//
+// Draw_BatchString
+//
+
+static void Draw_BatchString(dtexture texture, int quads) {
+	GL_BatchGeometry(texture, false, vtxstring, quads * 4, idxstring, quads * 6);
+
+	if (devparm) {
+		vertCount += quads * 4;
+	}
+}
 
 //
 // Draw_Text
@@ -188,21 +262,35 @@ int Draw_Text(int x, int y, rcolor color, float scale,
 	boolean wrap, const char* string, ...) {
 	int c;
 	int i;
-	int vi = 0;
-	int    col;
+	int q = 0;
+	int len;
+	int pic;
 	const float size = 0.03125f;
-	float fcol, frow;
 	int start = 0;
 	char msg[MAX_MESSAGE_SIZE];
 	va_list    va;
 	const int ix = x;
 	boolean fill = false;
+	const glyphuv_t* uv;
+	vtx_t* v;
 
 	va_start(va, string);
 	vsprintf(msg, string, va);
 	va_end(va);
 
-	GL_SetState(GLSTATE_BLEND, 1);
+	if (!sfontready) {
+		for (i = 0; i < ST_FONTSIZE; i++) {
+			float fcol = (i & (ST_FONTNUMSET - 1)) * size;
+			float frow = (i >= ST_FONTNUMSET) ? 0.5f : 0.0f;
+
+			sfontuv[i].tu1 = fcol + 0.0015f;
+			sfontuv[i].tu2 = (fcol + size) - 0.0015f;
+			sfontuv[i].tv1 = frow + size;
+			sfontuv[i].tv2 = frow + 0.5f;
+		}
+
+		sfontready = true;
+	}
 
 	if (!r_fillmode.value) {
 		dglEnable(GL_TEXTURE_2D);
@@ -211,17 +299,16 @@ int Draw_Text(int x, int y, rcolor color, float scale,
 		fill = true;
 	}
 
-	GL_BindGfxTexture("SFONT", true);
+	pic = GL_BindGfxTexture("SFONT", true);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
 	GL_SetOrthoScale(scale);
-	GL_SetOrtho(0);
 
-	dglSetVertex(vtxstring);
+	len = dstrlen(msg);
 
-	for (i = 0, vi = 0; i < dstrlen(msg); i++, vi += 4) {
+	for (i = 0; i < len && q < MAXSTRINGQUADS; i++) {
 		c = toupper(msg[i]);
 		if (c == '\t') {
 			while (x % 64) {
@@ -245,53 +332,46 @@ int Draw_Text(int x, int y, rcolor color, float scale,
 		}
 		else {
 			start = (c - ST_FONTSTART);
-			col = start & (ST_FONTNUMSET - 1);
-
-			fcol = (col * size);
-			frow = (start >= ST_FONTNUMSET) ? 0.5f : 0.0f;
-
-			vtxstring[vi + 0].x = (float)x;
-			vtxstring[vi + 0].y = (float)y;
-			vtxstring[vi + 0].tu = fcol + 0.0015f;
-			vtxstring[vi + 0].tv = frow + size;
-			vtxstring[vi + 1].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 1].y = (float)y;
-			vtxstring[vi + 1].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 1].tv = frow + size;
-			vtxstring[vi + 2].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 2].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 2].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 2].tv = frow + 0.5f;
-			vtxstring[vi + 3].x = (float)x;
-			vtxstring[vi + 3].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 3].tu = fcol + 0.0015f;
-			vtxstring[vi + 3].tv = frow + 0.5f;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 0, vi + 1, vi + 2);
-			dglTriangle(vi + 0, vi + 2, vi + 3);
-
-			if (devparm) {
-				vertCount += 4;
+
+			if (start >= 0 && start < ST_FONTSIZE) {
+				uv = &sfontuv[start];
+				v = &vtxstring[q * 4];
+
+				v[0].x = (float)x;
+				v[0].y = (float)y;
+				v[0].tu = uv->tu1;
+				v[0].tv = uv->tv1;
+				v[1].x = (float)x + ST_FONTWHSIZE;
+				v[1].y = (float)y;
+				v[1].tu = uv->tu2;
+				v[1].tv = uv->tv1;
+				v[2].x = (float)x + ST_FONTWHSIZE;
+				v[2].y = (float)y + ST_FONTWHSIZE;
+				v[2].tu = uv->tu2;
+				v[2].tv = uv->tv2;
+				v[3].x = (float)x;
+				v[3].y = (float)y + ST_FONTWHSIZE;
+				v[3].tu = uv->tu1;
+				v[3].tv = uv->tv2;
+
+				dglSetVertexColor(v, color, 4);
+				Draw_StringQuad(q++, textwinding);
 			}
 		}
 		x += ST_FONTWHSIZE;
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
+	Draw_BatchString(gfxptr[pic], q);
 
 	if (fill) {
+		// has to be drawn before texturing goes back off
+		GL_FlushBatch();
+
 		dglDisable(GL_TEXTURE_2D);
 		dglPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		r_fillmode.value = 0.0f;
 	}
 
-	GL_SetState(GLSTATE_BLEND, 0);
 	GL_SetOrthoScale(1.0f);
 
 	return x;
@@ -398,14 +478,111 @@ const symboldata_t symboldata[] = {  //0x5B9BC
 	{ -1, -1, -1, -1 }
 };
 
+#define NUMSYMBOLS  ((int)(sizeof(symboldata) / sizeof(symboldata_t)) - 1)
+
+static glyphuv_t symboluv[NUMSYMBOLS];
+static int symbolgfx = -1;
+
+static short symbolindex[128];
+static boolean symbolsready = false;
+
+//
+// Draw_SymbolIndex
+// Which symbol a character of a string is drawn with, or -1
+//
+
+static int Draw_SymbolIndex(int c) {
+	int i;
+
+	if (!symbolsready) {
+		for (i = 0; i < 128; i++) {
+			symbolindex[i] = -1;
+		}
+
+		for (i = 0; i < 10; i++) {
+			symbolindex['0' + i] = SM_NUMBERS + i;
+		}
+
+		for (i = 0; i < 26; i++) {
+			symbolindex['A' + i] = SM_FONT1 + i;
+			symbolindex['a' + i] = SM_FONT2 + i;
+		}
+
+		symbolindex['-'] = SM_MISCFONT;
+		symbolindex['%'] = SM_MISCFONT + 1;
+		symbolindex['!'] = SM_MISCFONT + 2;
+		symbolindex['.'] = SM_MISCFONT + 3;
+		symbolindex['?'] = SM_MISCFONT + 4;
+		symbolindex[':'] = SM_MISCFONT + 5;
+
+		symbolsready = true;
+	}
+
+	if (c < 0 || c >= 128) {
+		return -1;
+	}
+
+	return symbolindex[c];
+}
+
+//
+// Draw_SpecialSymbol
+// [kex] use 'printf' style formating for special symbols
+//
+
+static int Draw_SpecialSymbol(int c) {
+	switch (c) {
+		// up arrow
+	case 'u':
+		return SM_MICONS + 17;
+		// down arrow
+	case 'd':
+		return SM_MICONS + 16;
+		// right arrow
+	case 'r':
+		return SM_MICONS + 18;
+		// left arrow
+	case 'l':
+		return SM_MICONS;
+		// cursor box
+	case 'b':
+		return SM_MICONS + 1;
+		// thermbar
+	case 't':
+		return SM_THERMO;
+		// thermcursor
+	case 's':
+		return SM_THERMO + 1;
+	default:
+		return -1;
+	}
+}
+
+//
+// Draw_BindSymbols
+//
+
+static int Draw_BindSymbols(void) {
+	int pic = GL_BindGfxTexture("SYMBOLS", true);
+
+	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
+	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
+
+	if (pic != symbolgfx) {
+		Draw_SetGlyphs(symboluv, symboldata, NUMSYMBOLS, pic);
+		symbolgfx = pic;
+	}
+
+	return pic;
+}
+
 //
 // Center_Text
 //
 
 int Center_Text(const char* string) {
 	int width = 0;
-	char t = 0;
-	int id = 0;
+	int index = 0;
 	int len = 0;
 	int i = 0;
 	float scale;
@@ -413,44 +590,15 @@ int Center_Text(const char* string) {
 	len = dstrlen(string);
 
 	for (i = 0; i < len; i++) {
-		t = string[i];
-
-		switch (t) {
-		case 0x20:
+		if (string[i] == 0x20) {
 			width += 6;
-			break;
-		case '-':
-			width += symboldata[SM_MISCFONT].w;
-			break;
-		case '%':
-			width += symboldata[SM_MISCFONT + 1].w;
-			break;
-		case '!':
-			width += symboldata[SM_MISCFONT + 2].w;
-			break;
-		case '.':
-			width += symboldata[SM_MISCFONT + 3].w;
-			break;
-		case '?':
-			width += symboldata[SM_MISCFONT + 4].w;
-			break;
-		case ':':
-			width += symboldata[SM_MISCFONT + 5].w;
-			break;
-		default:
-			if (t >= 'A' && t <= 'Z') {
-				id = t - 'A';
-				width += symboldata[SM_FONT1 + id].w;
-			}
-			if (t >= 'a' && t <= 'z') {
-				id = t - 'a';
-				width += symboldata[SM_FONT2 + id].w;
-			}
-			if (t >= '0' && t <= '9') {
-				id = t - '0';
-				width += symboldata[SM_NUMBERS + id].w;
-			}
-			break;
+			continue;
+		}
+
+		index = Draw_SymbolIndex(string[i]);
+
+		if (index >= 0) {
+			width += symboldata[index].w;
 		}
 	}
 
@@ -471,7 +619,8 @@ int Center_Text(const char* string) {
 int Draw_BigText(int x, int y, rcolor color, const char* string) {
 	int c = 0;
 	int i = 0;
-	int vi = 0;
+	int q = 0;
+	int len;
 	int index = 0;
 	float vx1 = 0.0f;
 	float vy1 = 0.0f;
@@ -479,11 +628,9 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 	float vy2 = 0.0f;
 	float tx1 = 0.0f;
 	float tx2 = 0.0f;
-	float ty1 = 0.0f;
-	float ty2 = 0.0f;
-	float smbwidth;
-	float smbheight;
 	int pic;
+	const glyphuv_t* uv;
+	vtx_t* v;
 
 	if (x <= -1) {
 		x = Center_Text(string);
@@ -491,20 +638,10 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 
 	y += 14;
 
-	pic = GL_BindGfxTexture("SYMBOLS", true);
-
-	smbwidth = (float)gfxwidth[pic];
-	smbheight = (float)gfxheight[pic];
-
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
-
-	dglSetVertex(vtxstring);
-
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
+	pic = Draw_BindSymbols();
+	len = dstrlen(string);
 
-	for (i = 0, vi = 0; i < dstrlen(string); i++, vi += 4) {
+	for (i = 0; i < len && q < MAXSTRINGQUADS; i++) {
 		vx1 = (float)x;
 		vy1 = (float)y;
 
@@ -517,117 +654,51 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 			continue;
 		}
 		else {
-			if (c >= '0' && c <= '9') {
-				index = (c - '0') + SM_NUMBERS;
-			}
-			if (c >= 'A' && c <= 'Z') {
-				index = (c - 'A') + SM_FONT1;
-			}
-			if (c >= 'a' && c <= 'z') {
-				index = (c - 'a') + SM_FONT2;
-			}
-			if (c == '-') {
-				index = SM_MISCFONT;
-			}
-			if (c == '%') {
-				index = SM_MISCFONT + 1;
-			}
-			if (c == '!') {
-				index = SM_MISCFONT + 2;
-			}
-			if (c == '.') {
-				index = SM_MISCFONT + 3;
-			}
-			if (c == '?') {
-				index = SM_MISCFONT + 4;
-			}
-			if (c == ':') {
-				index = SM_MISCFONT + 5;
-			}
-
-			// [kex] use 'printf' style formating for special symbols
 			if (c == '/') {
-				c = string[++i];
-
-				switch (c) {
-					// up arrow
-				case 'u':
-					index = SM_MICONS + 17;
-					break;
-					// down arrow
-				case 'd':
-					index = SM_MICONS + 16;
-					break;
-					// right arrow
-				case 'r':
-					index = SM_MICONS + 18;
-					break;
-					// left arrow
-				case 'l':
-					index = SM_MICONS;
-					break;
-					// cursor box
-				case 'b':
-					index = SM_MICONS + 1;
-					break;
-					// thermbar
-				case 't':
-					index = SM_THERMO;
-					break;
-					// thermcursor
-				case 's':
-					index = SM_THERMO + 1;
-					break;
-				default:
+				index = Draw_SpecialSymbol(string[++i]);
+
+				if (index < 0) {
 					return 0;
 				}
 			}
+			else if ((index = Draw_SymbolIndex(c)) < 0) {
+				continue;
+			}
 
 			vx2 = vx1 + symboldata[index].w;
 			vy2 = vy1 - symboldata[index].h;
 
-			tx1 = ((float)symboldata[index].x / smbwidth) + 0.001f;
-			tx2 = (tx1 + (float)symboldata[index].w / smbwidth) - 0.002f;
-
-			ty1 = ((float)symboldata[index].y / smbheight);
-			ty2 = ty1 + (((float)symboldata[index].h / smbheight));
-
-			vtxstring[vi + 0].x = vx1;
-			vtxstring[vi + 0].y = vy1;
-			vtxstring[vi + 0].tu = tx1;
-			vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2;
-			vtxstring[vi + 1].y = vy1;
-			vtxstring[vi + 1].tu = tx2;
-			vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2;
-			vtxstring[vi + 2].y = vy2;
-			vtxstring[vi + 2].tu = tx2;
-			vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1;
-			vtxstring[vi + 3].y = vy2;
-			vtxstring[vi + 3].tu = tx1;
-			vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+			uv = &symboluv[index];
+			tx1 = uv->tu1 + 0.001f;
+			tx2 = uv->tu2 - 0.001f;
+
+			v = &vtxstring[q * 4];
+
+			v[0].x = vx1;
+			v[0].y = vy1;
+			v[0].tu = tx1;
+			v[0].tv = uv->tv2;
+			v[1].x = vx2;
+			v[1].y = vy1;
+			v[1].tu = tx2;
+			v[1].tv = uv->tv2;
+			v[2].x = vx2;
+			v[2].y = vy2;
+			v[2].tu = tx2;
+			v[2].tv = uv->tv1;
+			v[3].x = vx1;
+			v[3].y = vy2;
+			v[3].tu = tx1;
+			v[3].tv = uv->tv1;
+
+			dglSetVertexColor(v, color, 4);
+			Draw_StringQuad(q++, symbolwinding);
 
 			x += symboldata[index].w;
 		}
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchString(gfxptr[pic], q);
 
 	return x;
 }
@@ -639,19 +710,16 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 int Draw_SmallText(int x, int y, rcolor color, const char* string) {
 	int c = 0;
 	int i = 0;
-	int vi = 0;
+	int q = 0;
+	int len;
 	int index = 0;
 	float vx1 = 0.0f;
 	float vy1 = 0.0f;
 	float vx2 = 0.0f;
 	float vy2 = 0.0f;
-	float tx1 = 0.0f;
-	float tx2 = 0.0f;
-	float ty1 = 0.0f;
-	float ty2 = 0.0f;
-	float smbwidth;
-	float smbheight;
 	int pic;
+	const glyphuv_t* uv;
+	vtx_t* v;
 
 	// Scale factor for symbols
 	float scale_factor = 0.7f;
@@ -662,20 +730,10 @@ int Draw_SmallText(int x, int y, rcolor color, const char* string) {
 
 	y += 14; // Adjust for smaller text
 
-	pic = GL_BindGfxTexture("SYMBOLS", true);
-
-	smbwidth = (float)gfxwidth[pic];
-	smbheight = (float)gfxheight[pic];
-
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
-
-	dglSetVertex(vtxstring);
-
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
+	pic = Draw_BindSymbols();
+	len = dstrlen(string);
 
-	for (i = 0, vi = 0; i < dstrlen(string); i++, vi += 4) {
+	for (i = 0; i < len && q < MAXSTRINGQUADS; i++) {
 		vx1 = (float)x + 30;
 		vy1 = (float)y;
 
@@ -688,118 +746,49 @@ int Draw_SmallText(int x, int y, rcolor color, const char* string) {
 			continue;
 		}
 		else {
-			if (c >= '0' && c <= '9') {
-				index = (c - '0') + SM_NUMBERS;
-			}
-			if (c >= 'A' && c <= 'Z') {
-				index = (c - 'A') + SM_FONT1;
-			}
-			if (c >= 'a' && c <= 'z') {
-				index = (c - 'a') + SM_FONT2;
-			}
-			if (c == '-') {
-				index = SM_MISCFONT;
-			}
-			if (c == '%') {
-				index = SM_MISCFONT + 1;
-			}
-			if (c == '!') {
-				index = SM_MISCFONT + 2;
-			}
-			if (c == '.') {
-				index = SM_MISCFONT + 3;
-			}
-			if (c == '?') {
-				index = SM_MISCFONT + 4;
-			}
-			if (c == ':') {
-				index = SM_MISCFONT + 5;
-			}
-
-			// [kex] use 'printf' style formatting for special symbols
 			if (c == '/') {
-				c = string[++i];
-
-				switch (c) {
-					// up arrow
-				case 'u':
-					index = SM_MICONS + 17;
-					break;
-					// down arrow
-				case 'd':
-					index = SM_MICONS + 16;
-					break;
-					// right arrow
-				case 'r':
-					index = SM_MICONS + 18;
-					break;
-					// left arrow
-				case 'l':
-					index = SM_MICONS;
-					break;
-					// cursor box
-				case 'b':
-					index = SM_MICONS + 1;
-					break;
-					// thermbar
-				case 't':
-					index = SM_THERMO;
-					break;
-					// thermcursor
-				case 's':
-					index = SM_THERMO + 1;
-					break;
-				default:
+				index = Draw_SpecialSymbol(string[++i]);
+
+				if (index < 0) {
 					return 0;
 				}
 			}
+			else if ((index = Draw_SymbolIndex(c)) < 0) {
+				continue;
+			}
 
 			// Scale the symbol dimensions
 			vx2 = vx1 + symboldata[index].w * scale_factor;
 			vy2 = vy1 - symboldata[index].h * scale_factor;
 
-			// Adjust texture coordinates for scaling
-			tx1 = (float)symboldata[index].x / smbwidth;
-			tx2 = (float)(symboldata[index].x + symboldata[index].w) / smbwidth;
-			ty1 = (float)symboldata[index].y / smbheight;
-			ty2 = (float)(symboldata[index].y + symboldata[index].h) / smbheight;
-
-			vtxstring[vi + 0].x = vx1;
-			vtxstring[vi + 0].y = vy1;
-			vtxstring[vi + 0].tu = tx1;
-			vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2;
-			vtxstring[vi + 1].y = vy1;
-			vtxstring[vi + 1].tu = tx2;
-			vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2;
-			vtxstring[vi + 2].y = vy2;
-			vtxstring[vi + 2].tu = tx2;
-			vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1;
-			vtxstring[vi + 3].y = vy2;
-			vtxstring[vi + 3].tu = tx1;
-			vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+			uv = &symboluv[index];
+			v = &vtxstring[q * 4];
+
+			v[0].x = vx1;
+			v[0].y = vy1;
+			v[0].tu = uv->tu1;
+			v[0].tv = uv->tv2;
+			v[1].x = vx2;
+			v[1].y = vy1;
+			v[1].tu = uv->tu2;
+			v[1].tv = uv->tv2;
+			v[2].x = vx2;
+			v[2].y = vy2;
+			v[2].tu = uv->tu2;
+			v[2].tv = uv->tv1;
+			v[3].x = vx1;
+			v[3].y = vy2;
+			v[3].tu = uv->tu1;
+			v[3].tv = uv->tv1;
+
+			dglSetVertexColor(v, color, 4);
+			Draw_StringQuad(q++, symbolwinding);
 
 			x += symboldata[index].w * scale_factor;
 		}
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchString(gfxptr[pic], q);
 
 	return x;
 }
@@ -1124,6 +1113,9 @@ static const symboldata_t confontmap[256] = {
 	{ 100, 171, 8, 16 }
 };
 
+static glyphuv_t confontuv[256];
+static int confontgfx = -1;
+
 //
 // Draw_ConsoleText
 //
@@ -1132,20 +1124,19 @@ float Draw_ConsoleText(float x, float y, rcolor color,
 	float scale, const char* string, ...) {
 	int c = 0;
 	int i = 0;
-	int vi = 0;
+	int q = 0;
+	int len;
 	float vx1 = 0.0f;
 	float vy1 = 0.0f;
 	float vx2 = 0.0f;
 	float vy2 = 0.0f;
 	float tx1 = 0.0f;
 	float tx2 = 0.0f;
-	float ty1 = 0.0f;
-	float ty2 = 0.0f;
 	char msg[MAX_MESSAGE_SIZE];
 	va_list    va;
-	float width;
-	float height;
 	int pic;
+	const glyphuv_t* uv;
+	vtx_t* v;
 
 	va_start(va, string);
 	vsprintf(msg, string, va);
@@ -1153,24 +1144,23 @@ float Draw_ConsoleText(float x, float y, rcolor color,
 
 	pic = GL_BindGfxTexture("CONFONT", true);
 
-	width = (float)gfxwidth[pic];
-	height = (float)gfxheight[pic];
-
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-	dglSetVertex(vtxstring);
+	if (pic != confontgfx) {
+		Draw_SetGlyphs(confontuv, confontmap, 256, pic);
+		confontgfx = pic;
+	}
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
+	len = dstrlen(msg);
 
-	for (i = 0, vi = 0; i < dstrlen(msg); i++, vi += 4) {
+	for (i = 0; i < len && q < MAXSTRINGQUADS; i++) {
 		vx1 = x;
 		vy1 = y;
 
-		c = msg[i];
+		c = (byte)msg[i];
 		if (c == '\n' || c == '\t') {
 			continue;    // villsa: safety check
 		}
@@ -1178,48 +1168,37 @@ float Draw_ConsoleText(float x, float y, rcolor color,
 			vx2 = vx1 + ((float)confontmap[c].w * scale);
 			vy2 = vy1 - ((float)confontmap[c].h * scale);
 
-			tx1 = ((float)confontmap[c].x / width) + 0.001f;
-			tx2 = (tx1 + (float)confontmap[c].w / width) - 0.002f;
-
-			ty1 = ((float)confontmap[c].y / height);
-			ty2 = ty1 + (((float)confontmap[c].h / height));
-
-			vtxstring[vi + 0].x = vx1;
-			vtxstring[vi + 0].y = vy1;
-			vtxstring[vi + 0].tu = tx1;
-			vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2;
-			vtxstring[vi + 1].y = vy1;
-			vtxstring[vi + 1].tu = tx2;
-			vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2;
-			vtxstring[vi + 2].y = vy2;
-			vtxstring[vi + 2].tu = tx2;
-			vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1;
-			vtxstring[vi + 3].y = vy2;
-			vtxstring[vi + 3].tu = tx1;
-			vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+			uv = &confontuv[c];
+			tx1 = uv->tu1 + 0.001f;
+			tx2 = uv->tu2 - 0.001f;
+
+			v = &vtxstring[q * 4];
+
+			v[0].x = vx1;
+			v[0].y = vy1;
+			v[0].tu = tx1;
+			v[0].tv = uv->tv2;
+			v[1].x = vx2;
+			v[1].y = vy1;
+			v[1].tu = tx2;
+			v[1].tv = uv->tv2;
+			v[2].x = vx2;
+			v[2].y = vy2;
+			v[2].tu = tx2;
+			v[2].tv = uv->tv1;
+			v[3].x = vx1;
+			v[3].y = vy2;
+			v[3].tu = tx1;
+			v[3].tv = uv->tv1;
+
+			dglSetVertexColor(v, color, 4);
+			Draw_StringQuad(q++, symbolwinding);
 
 			x += ((float)confontmap[c].w * scale);
 		}
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchString(gfxptr[pic], q);
 
 	return x;
 }
\ No newline at end of file
@@ -35,6 +35,8 @@ void Draw_GfxImageLegal(int x, int y, const char* name,
 	rcolor color, boolean alpha);
 void Draw_Sprite2D(int type, int rot, int frame, int x, int y,
 	float scale, int pal, rcolor c);
+void Draw_BatchQuad(dtexture texture, float x, float y, int width, int height,
+	float u1, float u2, float v1, float v2, rcolor c);
 
 #define SM_FONT1        16
 #define SM_FONT2        42
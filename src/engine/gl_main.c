@@ -48,6 +48,8 @@
 #include "z_zone.h"
 #include "r_main.h"
 #include "gl_texture.h"
+#include "gl_shader.h"
+#include "gl_batch.h"
 #include "con_console.h"
 #include "m_misc.h"
 #include "g_actions.h"
@@ -60,6 +62,7 @@ int ViewHeight = 0;
 int gl_max_texture_units;
 int gl_max_texture_size;
 boolean gl_has_combiner;
+boolean gl_has_shaders;
 
 const char* gl_vendor;
 const char* gl_renderer;
@@ -107,11 +110,25 @@ GL_ARB_multitexture_Define();
 GL_EXT_compiled_vertex_array_Define();
 //GL_EXT_multi_draw_arrays_Define();
 //GL_EXT_fog_coord_Define();
-//GL_ARB_vertex_buffer_object_Define();
+GL_ARB_vertex_buffer_object_Define();
 //GL_ARB_texture_non_power_of_two_Define();
 GL_ARB_texture_env_combine_Define();
 GL_EXT_texture_env_combine_Define();
 GL_EXT_texture_filter_anisotropic_Define();
+GL_ARB_texture_compression_Define();
+GL_EXT_texture_compression_s3tc_Define();
+GL_ARB_texture_compression_bptc_Define();
+GL_EXT_framebuffer_object_Define();
+GL_ARB_occlusion_query_Define();
+GL_ARB_shader_objects_Define();
+GL_ARB_vertex_shader_Define();
+GL_ARB_fragment_shader_Define();
+GL_ARB_shading_language_100_Define();
+GL_ARB_instanced_arrays_Define();
+GL_ARB_draw_instanced_Define();
+GL_ARB_map_buffer_range_Define();
+GL_ARB_buffer_storage_Define();
+GL_ARB_sync_Define();
 
 //
 // FindExtension
@@ -178,6 +195,20 @@ void* GL_RegisterProc(const char* address) {
     return proc;
 }
 
+//
+// GL_GetFitView
+// Where a 4:3 picture sits in a widescreen view
+//
+
+static void GL_GetFitView(int* x, int* width) {
+    const float ratio = (4.0f / 3.0f);
+    float fitwidth = ViewHeight * ratio;
+    float fitx = (ViewWidth - fitwidth) / 2.0f;
+
+    *x = (int)fitx;
+    *width = (int)fitwidth;
+}
+
 //
 // GL_SetOrtho
 //
@@ -205,11 +236,11 @@ void GL_SetOrtho(boolean stretch) {
     dglLoadIdentity();
 
     if (widescreen && !stretch) {
-        const float ratio = (4.0f / 3.0f);
-        float fitwidth = ViewHeight * ratio;
-        float fitx = (ViewWidth - fitwidth) / 2.0f;
+        int fitx;
+        int fitwidth;
 
-        dglViewport(ViewWindowX + (int)fitx, ViewWindowY, (int)fitwidth, ViewHeight);
+        GL_GetFitView(&fitx, &fitwidth);
+        dglViewport(ViewWindowX + fitx, ViewWindowY, fitwidth, ViewHeight);
     }
 
     width = SCREENWIDTH;
@@ -225,6 +256,34 @@ void GL_SetOrtho(boolean stretch) {
     checkortho = (stretch && widescreen) ? 2 : 1;
 }
 
+//
+// GL_Map2DVertices
+// Moves vertices laid out for GL_SetOrtho(stretch) at the current
+// scale into the whole view at a scale of 1
+//
+
+void GL_Map2DVertices(vtx_t* v, int count, boolean stretch) {
+    float xscale = glScaleFactor;
+    float yscale = glScaleFactor;
+    float xoffset = 0.0f;
+    int i;
+
+    if (widescreen && !stretch) {
+        int fitx;
+        int fitwidth;
+
+        GL_GetFitView(&fitx, &fitwidth);
+
+        xscale *= (float)fitwidth / (float)ViewWidth;
+        xoffset = (SCREENWIDTH * (float)fitx) / (float)ViewWidth;
+    }
+
+    for (i = 0; i < count; i++) {
+        v[i].x = xoffset + (v[i].x * xscale);
+        v[i].y *= yscale;
+    }
+}
+
 //
 // GL_ResetViewport
 //
@@ -257,6 +316,8 @@ float GL_GetOrthoScale(void) {
 //
 
 void GL_SwapBuffers(void) {
+    GL_EndBatchFrame();
+    dglEndFrame();
     I_FinishUpdate();
 }
 
@@ -283,6 +344,7 @@ byte* GL_GetScreenBuffer(int x, int y, int width, int height) {
     //
     dglGetIntegerv(GL_PACK_ALIGNMENT, &pack);
     dglPixelStorei(GL_PACK_ALIGNMENT, 1);
+    GL_FlushBatch();
     dglFlush();
     dglReadPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
     dglPixelStorei(GL_PACK_ALIGNMENT, pack);
@@ -324,11 +386,29 @@ void GL_SetTextureFilter(void) {
             dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropic);
         }
         else {
-            dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 0);
+            // 1 is the lowest value the extension accepts
+            dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
         }
     }
 }
 
+//
+// GL_SetMipmapFilter
+// Same as GL_SetTextureFilter, for a texture that has its
+// full mip chain
+//
+
+void GL_SetMipmapFilter(void) {
+    if (!usingGL) {
+        return;
+    }
+
+    GL_SetTextureFilter();
+
+    dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+        (int)r_filter.value == 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST);
+}
+
 //
 // GL_SetDefaultCombiner
 //
@@ -425,6 +505,9 @@ void GL_Draw2DQuad(vtx_t* v, boolean stretch) {
 
     GL_ResetViewport();
 
+    batchstats.draws++;
+    batchstats.quads++;
+
     if (devparm) {
         vertCount += 4;
     }
@@ -648,6 +731,21 @@ void GL_Init(void) {
     GL_ARB_texture_env_combine_Init();
     GL_EXT_texture_env_combine_Init();
     GL_EXT_texture_filter_anisotropic_Init();
+    GL_ARB_texture_compression_Init();
+    GL_EXT_texture_compression_s3tc_Init();
+    GL_ARB_texture_compression_bptc_Init();
+    GL_EXT_framebuffer_object_Init();
+    GL_ARB_occlusion_query_Init();
+    GL_ARB_vertex_buffer_object_Init();
+    GL_ARB_shader_objects_Init();
+    GL_ARB_vertex_shader_Init();
+    GL_ARB_fragment_shader_Init();
+    GL_ARB_shading_language_100_Init();
+    GL_ARB_instanced_arrays_Init();
+    GL_ARB_draw_instanced_Init();
+    GL_ARB_map_buffer_range_Init();
+    GL_ARB_buffer_storage_Init();
+    GL_ARB_sync_Init();
 
     if (!has_GL_ARB_multitexture) {
         CON_Warnf("GL_ARB_multitexture not supported...\n");
@@ -661,6 +759,13 @@ void GL_Init(void) {
         CON_CvarSetValue(r_texturecombiner.name, 0.0f);
     }
 
+    gl_has_shaders = (has_GL_ARB_shader_objects && has_GL_ARB_vertex_shader &&
+        has_GL_ARB_fragment_shader && has_GL_ARB_shading_language_100);
+
+    GL_InitShaders();
+    dglInitRing();
+    GL_InitBatch();
+
     dglEnableClientState(GL_VERTEX_ARRAY);
     dglEnableClientState(GL_TEXTURE_COORD_ARRAY);
     dglEnableClientState(GL_COLOR_ARRAY);
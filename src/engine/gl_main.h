@@ -44,6 +44,7 @@ typedef GLhandleARB    rhandle;
 extern int gl_max_texture_units;
 extern int gl_max_texture_size;
 extern boolean gl_has_combiner;
+extern boolean gl_has_shaders;
 
 typedef struct {
 	rfloat    x;
@@ -98,7 +99,9 @@ void GL_CheckFillMode(void);
 void GL_SwapBuffers(void);
 byte* GL_GetScreenBuffer(int x, int y, int width, int height);
 void GL_SetTextureFilter(void);
+void GL_SetMipmapFilter(void);
 void GL_SetOrtho(boolean stretch);
+void GL_Map2DVertices(vtx_t* v, int count, boolean stretch);
 void GL_ResetViewport(void);
 void GL_SetOrthoScale(float scale);
 float GL_GetOrthoScale(void);
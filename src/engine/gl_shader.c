@@ -0,0 +1,285 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: GLSL programs
+//
+// Programs are written for GLSL 1.20 and the compatibility
+// profile, so they can read the fixed function matrices and fog
+// state that the rest of the renderer already sets up.
+//
+// The world program stands in for the texture combiners when
+// drawing the draw lists. Sector glow comes in as a vertex
+// attribute next to the vertex colour, and flash, colour scale and
+// fog are uniforms, so draw runs only have to break on textures.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "gl_main.h"
+#include "gl_shader.h"
+#include "dgl.h"
+#include "con_console.h"
+
+enum {
+	WA_GLOW = GLSHADER_FIRSTATTRIB
+};
+
+static const char* worldattribs[] = {
+	"glow",
+	NULL
+};
+
+static const char* worldvertsrc =
+	"#version 120\n"
+	"attribute float glow;\n"
+	"varying float vglow;\n"
+	"void main() {\n"
+	"    vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+	"    gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+	"    gl_FrontColor = gl_Color;\n"
+	"    vglow = glow;\n"
+	"    gl_FogFragCoord = abs(eye.z);\n"
+	"    gl_Position = ftransform();\n"
+	"}\n";
+
+static const char* worldfragsrc =
+	"#version 120\n"
+	GLSHADER_FOG
+	"uniform sampler2D image;\n"
+	"uniform vec3 flash;\n"
+	"uniform float lights;\n"
+	"uniform float scale;\n"
+	"varying float vglow;\n"
+	"void main() {\n"
+	"    vec4 texel = texture2D(image, gl_TexCoord[0].st);\n"
+	"    vec3 rgb = min((texel.rgb + vglow) * scale, 1.0);\n"
+	"    rgb = mix(rgb, rgb * gl_Color.rgb, lights);\n"
+	"    rgb = min(rgb + flash, 1.0);\n"
+	"    gl_FragColor = vec4(ApplyFog(rgb), texel.a * gl_Color.a);\n"
+	"}\n";
+
+static rhandle worldprogram = 0;
+static boolean worldfailed = false;
+
+static GLint u_image;
+static GLint u_flash;
+static GLint u_lights;
+static GLint u_scale;
+static GLint u_fogmode;
+
+CVAR(r_shaders, 1);
+
+CVAR_EXTERNAL(r_fillmode);
+CVAR_EXTERNAL(r_colorscale);
+
+//
+// GL_PrintInfoLog
+//
+
+static void GL_PrintInfoLog(const char* name, rhandle obj) {
+	GLint length = 0;
+	GLcharARB* log;
+
+	dglGetObjectParameterivARB(obj, GL_OBJECT_INFO_LOG_LENGTH_ARB, &length);
+
+	if (length <= 1) {
+		return;
+	}
+
+	log = (GLcharARB*)malloc(length);
+	dglGetInfoLogARB(obj, length, NULL, log);
+	CON_Warnf("%s: %s\n", name, log);
+	free(log);
+}
+
+//
+// GL_CompileShader
+//
+
+static rhandle GL_CompileShader(const char* name, GLenum type, const char* source) {
+	rhandle shader;
+	GLint status = 0;
+
+	shader = dglCreateShaderObjectARB(type);
+	dglShaderSourceARB(shader, 1, &source, NULL);
+	dglCompileShaderARB(shader);
+	dglGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, &status);
+
+	if (!status) {
+		CON_Warnf("GL_CompileShader: %s failed to compile\n", name);
+		GL_PrintInfoLog(name, shader);
+		dglDeleteObjectARB(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+//
+// GL_CreateProgram
+// The attributes in the NULL terminated list are bound in
+// order from GLSHADER_FIRSTATTRIB. Returns 0 if anything fails
+//
+
+rhandle GL_CreateProgram(const char* name, const char* vertsrc, const char* fragsrc, const char** attribs) {
+	rhandle program;
+	rhandle vert;
+	rhandle frag;
+	GLint status = 0;
+	int i;
+
+	if (!gl_has_shaders) {
+		return 0;
+	}
+
+	if (!(vert = GL_CompileShader(name, GL_VERTEX_SHADER_ARB, vertsrc))) {
+		return 0;
+	}
+
+	if (!(frag = GL_CompileShader(name, GL_FRAGMENT_SHADER_ARB, fragsrc))) {
+		dglDeleteObjectARB(vert);
+		return 0;
+	}
+
+	program = dglCreateProgramObjectARB();
+	dglAttachObjectARB(program, vert);
+	dglAttachObjectARB(program, frag);
+
+	for (i = 0; attribs && attribs[i]; i++) {
+		dglBindAttribLocationARB(program, GLSHADER_FIRSTATTRIB + i, attribs[i]);
+	}
+
+	dglLinkProgramARB(program);
+
+	// the program holds on to them until it's deleted
+	dglDeleteObjectARB(vert);
+	dglDeleteObjectARB(frag);
+
+	dglGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &status);
+
+	if (!status) {
+		CON_Warnf("GL_CreateProgram: %s failed to link\n", name);
+		GL_PrintInfoLog(name, program);
+		dglDeleteObjectARB(program);
+		return 0;
+	}
+
+	return program;
+}
+
+//
+// GL_GetFogMode
+//
+
+int GL_GetFogMode(void) {
+	GLint mode = 0;
+
+	if (!dglIsEnabled(GL_FOG)) {
+		return GLSHADER_FOG_NONE;
+	}
+
+	dglGetIntegerv(GL_FOG_MODE, &mode);
+	return mode == GL_EXP ? GLSHADER_FOG_EXP : GLSHADER_FOG_LINEAR;
+}
+
+//
+// GL_CreateWorldProgram
+//
+
+static boolean GL_CreateWorldProgram(void) {
+	if (worldprogram) {
+		return true;
+	}
+
+	if (worldfailed) {
+		return false;
+	}
+
+	worldprogram = GL_CreateProgram("world", worldvertsrc, worldfragsrc, worldattribs);
+
+	if (!worldprogram) {
+		CON_Warnf("GL_CreateWorldProgram: Using texture combiners for the world\n");
+		worldfailed = true;
+		return false;
+	}
+
+	u_image = dglGetUniformLocationARB(worldprogram, "image");
+	u_flash = dglGetUniformLocationARB(worldprogram, "flash");
+	u_lights = dglGetUniformLocationARB(worldprogram, "lights");
+	u_scale = dglGetUniformLocationARB(worldprogram, "scale");
+	u_fogmode = dglGetUniformLocationARB(worldprogram, "fogmode");
+
+	return true;
+}
+
+//
+// GL_UseWorldProgram
+// Wireframe has no textures to light, so it stays fixed function
+//
+
+boolean GL_UseWorldProgram(void) {
+	return (r_shaders.value > 0 && r_fillmode.value > 0 &&
+		gl_has_shaders && GL_CreateWorldProgram());
+}
+
+//
+// GL_BeginWorldProgram
+// glow holds one value per vertex of the array set by dglSetVertex
+//
+
+void GL_BeginWorldProgram(float* glow, boolean lights, rcolor flash) {
+	float f[4];
+	int cs;
+
+	dglGetColorf(flash, f);
+	cs = (int)r_colorscale.value;
+
+	dglUseProgramObjectARB(worldprogram);
+
+	dglUniform1iARB(u_image, 0);
+	dglUniform3fARB(u_flash, f[0], f[1], f[2]);
+	dglUniform1fARB(u_lights, lights ? 1.0f : 0.0f);
+	dglUniform1fARB(u_scale, cs == 1 ? 2.0f : cs == 2 ? 4.0f : 1.0f);
+	dglUniform1iARB(u_fogmode, GL_GetFogMode());
+
+	dglVertexAttribPointerARB(WA_GLOW, 1, GL_FLOAT, GL_FALSE, sizeof(float), glow);
+	dglEnableVertexAttribArrayARB(WA_GLOW);
+}
+
+//
+// GL_EndWorldProgram
+//
+
+void GL_EndWorldProgram(void) {
+	dglDisableVertexAttribArrayARB(WA_GLOW);
+	dglUseProgramObjectARB(0);
+}
+
+//
+// GL_InitShaders
+// Programs belong to the old context after a video reset
+//
+
+void GL_InitShaders(void) {
+	worldprogram = 0;
+	worldfailed = false;
+}
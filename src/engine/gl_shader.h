@@ -0,0 +1,58 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __GL_SHADER_H__
+#define __GL_SHADER_H__
+
+#include "gl_main.h"
+
+// generic attribute 0 stands in for glVertex, so leave it alone
+#define GLSHADER_FIRSTATTRIB    1
+
+// fog as SetupFog left it, for fragment shaders that include GLSHADER_FOG
+#define GLSHADER_FOG_NONE       0
+#define GLSHADER_FOG_LINEAR     1
+#define GLSHADER_FOG_EXP        2
+
+#define GLSHADER_FOG \
+	"uniform int fogmode;\n" \
+	"vec3 ApplyFog(vec3 rgb) {\n" \
+	"    float f;\n" \
+	"    if (fogmode == 1) {\n" \
+	"        f = (gl_Fog.end - gl_FogFragCoord) * gl_Fog.scale;\n" \
+	"    }\n" \
+	"    else if (fogmode == 2) {\n" \
+	"        f = exp(-gl_Fog.density * gl_FogFragCoord);\n" \
+	"    }\n" \
+	"    else {\n" \
+	"        return rgb;\n" \
+	"    }\n" \
+	"    return mix(gl_Fog.color.rgb, rgb, clamp(f, 0.0, 1.0));\n" \
+	"}\n"
+
+rhandle GL_CreateProgram(const char* name, const char* vertsrc, const char* fragsrc, const char** attribs);
+int GL_GetFogMode(void);
+
+boolean GL_UseWorldProgram(void);
+void GL_BeginWorldProgram(float* glow, boolean lights, rcolor flash);
+void GL_EndWorldProgram(void);
+void GL_InitShaders(void);
+
+#endif
@@ -0,0 +1,557 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Compressed texture cache
+//
+// With r_texturecompression on, world textures and sprites are
+// handed to the driver with a compressed internal format the
+// first time they are bound. The blocks the driver encoded are
+// read back and appended to a cache file in the user directory,
+// so later binds (and later launches) upload the blocks as they
+// are without decoding the PNG again.
+//
+// The file is keyed on the wad checksum and the block format, and
+// is started over if either of them change. Each entry also keeps
+// the gamma its palette was corrected with, so entries for every
+// gamma setting live side by side in the same file.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_png.h"
+#include "i_system.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include "gl_main.h"
+#include "gl_texture.h"
+#include "gl_texcomp.h"
+#include "p_spec.h"
+#include "con_console.h"
+#include "g_actions.h"
+#include "m_misc.h"
+#include "md5.h"
+
+void W_Checksum(md5_digest_t digest);
+
+#define TEXCOMP_FILE        "gltexcomp.dat"
+#define TEXCOMP_VERSION     2
+#define TEXCOMP_HASHSIZE    1024    // must be a power of two
+
+typedef struct {
+	char            id[8];
+	int             version;
+	md5_digest_t    key;
+	int             format;
+} texcompheader_t;
+
+typedef struct {
+	int             kind;
+	int             index;
+	int             pal;
+	int             width;
+	int             height;
+	int             size;
+	float           gamma;
+} texcomprecord_t;
+
+typedef struct texcompentry_s {
+	texcomprecord_t         rec;
+	long                    offset;     // start of the blocks in the file
+	struct texcompentry_s*  next;
+} texcompentry_t;
+
+static FILE* texcompfile = NULL;
+static int texcompformat = 0;
+static boolean texcompdisabled = false;
+static texcompentry_t* texcomphash[TEXCOMP_HASHSIZE];
+static byte* texcompbuffer = NULL;
+static int texcompbuffersize = 0;
+
+// stats for texcompstats
+static int texcompentries = 0;
+static int texcomphits = 0;
+static int texcompencodes = 0;
+static int texcompfallbacks = 0;
+static uint64_t texcompbytes = 0;
+static uint64_t texcomprawbytes = 0;
+
+CVAR_EXTERNAL(i_gamma);
+
+CVAR_CMD(r_texturecompression, 0) {
+	GL_DumpTextures();
+}
+
+//
+// TexComp_Hash
+//
+
+static int TexComp_Hash(int kind, int index, int pal) {
+	return ((((unsigned int)index * 31) + kind) * 17 + pal) & (TEXCOMP_HASHSIZE - 1);
+}
+
+//
+// TexComp_Find
+//
+
+static texcompentry_t* TexComp_Find(int kind, int index, int pal, float gamma) {
+	texcompentry_t* entry;
+
+	for (entry = texcomphash[TexComp_Hash(kind, index, pal)]; entry; entry = entry->next) {
+		if (entry->rec.kind == kind && entry->rec.index == index && entry->rec.pal == pal &&
+			entry->rec.gamma == gamma) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+//
+// TexComp_Add
+//
+
+static void TexComp_Add(texcomprecord_t* rec, long offset) {
+	texcompentry_t* entry;
+	int hash;
+
+	if ((entry = TexComp_Find(rec->kind, rec->index, rec->pal, rec->gamma))) {
+		// a later copy in the file replaces the earlier one
+		entry->rec = *rec;
+		entry->offset = offset;
+		return;
+	}
+
+	hash = TexComp_Hash(rec->kind, rec->index, rec->pal);
+
+	entry = (texcompentry_t*)malloc(sizeof(texcompentry_t));
+	entry->rec = *rec;
+	entry->offset = offset;
+	entry->next = texcomphash[hash];
+	texcomphash[hash] = entry;
+
+	texcompentries++;
+}
+
+//
+// TexComp_Remove
+// The blocks stay in the file, but nothing points at them
+//
+
+static void TexComp_Remove(texcompentry_t* entry) {
+	texcompentry_t** link;
+
+	link = &texcomphash[TexComp_Hash(entry->rec.kind, entry->rec.index, entry->rec.pal)];
+
+	while (*link && *link != entry) {
+		link = &(*link)->next;
+	}
+
+	if (*link) {
+		*link = entry->next;
+		free(entry);
+		texcompentries--;
+	}
+}
+
+//
+// TexComp_Close
+//
+
+static void TexComp_Close(void) {
+	int i;
+
+	for (i = 0; i < TEXCOMP_HASHSIZE; i++) {
+		while (texcomphash[i]) {
+			texcompentry_t* next = texcomphash[i]->next;
+
+			free(texcomphash[i]);
+			texcomphash[i] = next;
+		}
+	}
+
+	if (texcompfile) {
+		fclose(texcompfile);
+		texcompfile = NULL;
+	}
+
+	texcompformat = 0;
+	texcompentries = 0;
+}
+
+//
+// TexComp_SetupHeader
+//
+
+static void TexComp_SetupHeader(texcompheader_t* header, int format) {
+	dmemset(header, 0, sizeof(texcompheader_t));
+	dmemcpy(header->id, "GLTEXCMP", 8);
+	header->version = TEXCOMP_VERSION;
+	W_Checksum(header->key);
+	header->format = format;
+}
+
+//
+// TexComp_Open
+// Reads the index of an existing cache, or starts a new one
+//
+
+static boolean TexComp_Open(int format) {
+	texcompheader_t header;
+	texcompheader_t fileheader;
+	texcomprecord_t rec;
+	char* path;
+	long offset;
+
+	if (!(path = I_GetUserFile(TEXCOMP_FILE))) {
+		return false;
+	}
+
+	TexComp_SetupHeader(&header, format);
+
+	if ((texcompfile = fopen(path, "r+b"))) {
+		if (fread(&fileheader, sizeof(texcompheader_t), 1, texcompfile) != 1 ||
+			memcmp(&fileheader, &header, sizeof(texcompheader_t))) {
+			fclose(texcompfile);
+			texcompfile = NULL;
+		}
+	}
+
+	if (texcompfile) {
+		offset = sizeof(texcompheader_t);
+
+		while (fread(&rec, sizeof(texcomprecord_t), 1, texcompfile) == 1) {
+			if (rec.kind < 0 || rec.kind >= NUMTCKINDS || rec.size <= 0 ||
+				fseek(texcompfile, rec.size, SEEK_CUR)) {
+				break;
+			}
+
+			offset += sizeof(texcomprecord_t);
+			TexComp_Add(&rec, offset);
+			offset += rec.size;
+		}
+
+		// a record cut short by a crash can't be trusted, and
+		// neither can anything written after it
+		if (offset != ftell(texcompfile) || fseek(texcompfile, 0, SEEK_END) || offset != ftell(texcompfile)) {
+			CON_Warnf("TexComp_Open: %s is damaged, starting over\n", TEXCOMP_FILE);
+			TexComp_Close();
+		}
+	}
+
+	if (!texcompfile) {
+		if (!(texcompfile = fopen(path, "w+b"))) {
+			CON_Warnf("TexComp_Open: couldn't create %s\n", path);
+			free(path);
+			return false;
+		}
+
+		fwrite(&header, sizeof(texcompheader_t), 1, texcompfile);
+		fflush(texcompfile);
+	}
+
+	free(path);
+
+	texcompformat = format;
+
+	CON_DPrintf("Compressed texture cache: %i entries, format 0x%x\n", texcompentries, format);
+	return true;
+}
+
+//
+// TexComp_WantedFormat
+// 1 asks for S3TC, 2 for BPTC with S3TC as the fallback
+//
+
+static int TexComp_WantedFormat(void) {
+	if (!usingGL || r_texturecompression.value <= 0 || !has_GL_ARB_texture_compression) {
+		return 0;
+	}
+
+	if (r_texturecompression.value >= 2 && has_GL_ARB_texture_compression_bptc) {
+		return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+	}
+
+	if (has_GL_EXT_texture_compression_s3tc) {
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	return 0;
+}
+
+//
+// TexComp_Check
+// Returns the block format to use, reopening the cache if the
+// settings have changed since it was opened
+//
+
+static int TexComp_Check(void) {
+	static boolean warned = false;
+	int format;
+
+	if (texcompdisabled) {
+		return 0;
+	}
+
+	format = TexComp_WantedFormat();
+
+	if (format == texcompformat) {
+		return format;
+	}
+
+	TexComp_Close();
+
+	if (!format) {
+		if (r_texturecompression.value > 0 && usingGL && !warned) {
+			CON_Warnf("No supported compressed texture format, using RGBA8\n");
+			warned = true;
+		}
+
+		return 0;
+	}
+
+	if (!TexComp_Open(format)) {
+		return 0;
+	}
+
+	return format;
+}
+
+//
+// TexComp_Buffer
+//
+
+static byte* TexComp_Buffer(int size) {
+	if (size > texcompbuffersize) {
+		texcompbuffer = (byte*)realloc(texcompbuffer, size);
+		texcompbuffersize = size;
+	}
+
+	return texcompbuffer;
+}
+
+//
+// GL_LoadCachedTexture
+// Uploads the cached blocks for a texture into the bound texture
+// object. Returns false if there are none and the PNG has to be
+// decoded instead
+//
+
+boolean GL_LoadCachedTexture(int kind, int index, int pal, int* width, int* height) {
+	texcompentry_t* entry;
+	byte* data;
+	int format;
+
+	if (!(format = TexComp_Check())) {
+		return false;
+	}
+
+	if (!(entry = TexComp_Find(kind, index, pal, i_gamma.value))) {
+		return false;
+	}
+
+	data = TexComp_Buffer(entry->rec.size);
+
+	// drop entries that can't be used, so the texture is encoded
+	// again instead of failing on every bind
+	if (fseek(texcompfile, entry->offset, SEEK_SET) ||
+		fread(data, 1, (size_t)entry->rec.size, texcompfile) != (size_t)entry->rec.size) {
+		CON_Warnf("GL_LoadCachedTexture: couldn't read from %s\n", TEXCOMP_FILE);
+		TexComp_Remove(entry);
+		return false;
+	}
+
+	dglGetError();
+	dglCompressedTexImage2DARB(GL_TEXTURE_2D, 0, format, entry->rec.width, entry->rec.height,
+		0, entry->rec.size, data);
+
+	// the driver may have turned the blocks down
+	if (dglGetError() != GL_NO_ERROR) {
+		TexComp_Remove(entry);
+		return false;
+	}
+
+	*width = entry->rec.width;
+	*height = entry->rec.height;
+
+	texcomphits++;
+	texcompbytes += entry->rec.size;
+	texcomprawbytes += entry->rec.width * entry->rec.height * 4;
+
+	return true;
+}
+
+//
+// GL_CompressTexture
+// Uploads RGBA pixels into the bound texture object, compressed
+// if r_texturecompression is on, and appends what the driver
+// encoded to the cache
+//
+
+void GL_CompressTexture(int kind, int index, int pal, byte* data, int width, int height) {
+	texcomprecord_t rec;
+	int format;
+	int compressed;
+	int size;
+
+	if (!(format = TexComp_Check())) {
+		dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		return;
+	}
+
+	dglTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+	compressed = 0;
+	dglGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_ARB, &compressed);
+
+	if (!compressed) {
+		texcompfallbacks++;
+		return;
+	}
+
+	size = 0;
+	dglGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE_ARB, &size);
+
+	if (size <= 0) {
+		return;
+	}
+
+	dglGetCompressedTexImageARB(GL_TEXTURE_2D, 0, TexComp_Buffer(size));
+
+	rec.kind = kind;
+	rec.index = index;
+	rec.pal = pal;
+	rec.width = width;
+	rec.height = height;
+	rec.size = size;
+	rec.gamma = i_gamma.value;
+
+	if (fseek(texcompfile, 0, SEEK_END) ||
+		fwrite(&rec, sizeof(texcomprecord_t), 1, texcompfile) != 1 ||
+		fwrite(texcompbuffer, 1, (size_t)size, texcompfile) != (size_t)size) {
+		CON_Warnf("GL_CompressTexture: couldn't write to %s\n", TEXCOMP_FILE);
+		TexComp_Close();
+		return;
+	}
+
+	fflush(texcompfile);
+	TexComp_Add(&rec, ftell(texcompfile) - size);
+
+	texcompencodes++;
+	texcompbytes += size;
+	texcomprawbytes += width * height * 4;
+}
+
+//
+// TexComp_Precompress
+//
+
+static void TexComp_Precompress(int kind, int index, int lump, int pal) {
+	byte* png;
+	int w;
+	int h;
+
+	if (TexComp_Find(kind, index, pal, i_gamma.value)) {
+		return;
+	}
+
+	png = I_PNGReadDataTemp(lump, false, true, true, &w, &h, NULL, pal);
+	GL_CompressTexture(kind, index, pal, png, w, h);
+}
+
+//
+// CMD_TexCompress
+// Encodes every world texture and sprite, including palette
+// variants, instead of waiting for them to be bound
+//
+
+static CMD(TexCompress) {
+	dtexture texture;
+	uint64_t start;
+	int before;
+	int i;
+	int p;
+
+	if (!TexComp_Check()) {
+		CON_Printf(WHITE, "r_texturecompression is off or not supported\n");
+		return;
+	}
+
+	start = I_GetTimeUS();
+	before = texcompencodes;
+
+	dglGenTextures(1, &texture);
+	dglBindTexture(GL_TEXTURE_2D, texture);
+
+	for (i = 0; i < numtextures; i++) {
+		TexComp_Precompress(TC_WORLD, i, t_start + i, 0);
+
+		for (p = 0; p < numanimdef; p++) {
+			int j;
+
+			if (!animdefs[p].palette || W_CheckNumForName(animdefs[p].name) != t_start + i) {
+				continue;
+			}
+
+			for (j = 1; j < animdefs[p].frames; j++) {
+				TexComp_Precompress(TC_WORLD, i, t_start + i, j);
+			}
+		}
+	}
+
+	for (i = 0; i < numsprtex; i++) {
+		for (p = 0; p < spritecount[i]; p++) {
+			TexComp_Precompress(TC_SPRITE, i, s_start + i, p);
+		}
+	}
+
+	dglDeleteTextures(1, &texture);
+	GL_ResetTextures();
+
+	CON_Printf(WHITE, "Compressed %i textures in %i ms\n", texcompencodes - before,
+		(int)((I_GetTimeUS() - start) / 1000));
+}
+
+//
+// CMD_TexCompStats
+//
+
+static CMD(TexCompStats) {
+	CON_Printf(WHITE, "Format: %s\n", texcompformat == GL_COMPRESSED_RGBA_BPTC_UNORM_ARB ? "BPTC" :
+		texcompformat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? "S3TC DXT5" : "RGBA8");
+	CON_Printf(WHITE, "Cached: %i, Loaded: %i, Encoded: %i, Not compressed: %i\n",
+		texcompentries, texcomphits, texcompencodes, texcompfallbacks);
+	CON_Printf(WHITE, "Uploaded %i KB of blocks for %i KB of RGBA8\n",
+		(int)(texcompbytes >> 10), (int)(texcomprawbytes >> 10));
+}
+
+//
+// GL_InitTexCompression
+//
+
+void GL_InitTexCompression(void) {
+	texcompdisabled = (M_CheckParm("-notexcache") != 0);
+
+	G_AddCommand("texcompress", CMD_TexCompress, 0);
+	G_AddCommand("texcompstats", CMD_TexCompStats, 0);
+}
@@ -0,0 +1,30 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __GL_TEXCOMP_H__
+#define __GL_TEXCOMP_H__
+
+#include "doomtype.h"
+
+void        GL_InitTexCompression(void);
+boolean     GL_LoadCachedTexture(int kind, int index, int pal, int* width, int* height);
+void        GL_CompressTexture(int kind, int index, int pal, byte* data, int width, int height);
+
+#endif
@@ -0,0 +1,347 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Texture residency
+//
+// Keeps track of how much video memory the world textures and
+// sprites take and when each was last bound. Once the total goes
+// over r_texturebudget, the ones that have gone unused longest
+// are unloaded and will be uploaded again if they're bound later.
+// Textures stay loaded across level changes so the ones shared
+// between maps aren't uploaded again.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "z_zone.h"
+#include "gl_main.h"
+#include "gl_texture.h"
+#include "gl_texres.h"
+#include "con_console.h"
+#include "g_actions.h"
+
+#define TEXRES_HASHSIZE     1024    // must be a power of two
+
+typedef struct texres_s {
+	int                 kind;
+	int                 index;
+	int                 pal;
+	int                 size;
+	unsigned int        lastframe;
+	struct texres_s*    next;
+	struct texres_s*    lruprev;
+	struct texres_s*    lrunext;
+} texres_t;
+
+static texres_t* texreshash[TEXRES_HASHSIZE];
+
+// least recently bound first
+static texres_t* texreslruhead = NULL;
+static texres_t* texreslrutail = NULL;
+static unsigned int texresframe = 1;
+
+static int texrescount = 0;
+static uint64_t texresbytes = 0;
+
+// stats for texresstats
+static int texreshits = 0;
+static int texresmisses = 0;
+static int texresevictions = 0;
+static uint64_t texresframebytes = 0;
+static uint64_t texreslastframebytes = 0;
+static uint64_t texrespeakframebytes = 0;
+
+CVAR(r_texturebudget, 256);
+
+//
+// TexRes_Hash
+//
+
+static int TexRes_Hash(int kind, int index, int pal) {
+	return ((((unsigned int)index * 31) + kind) * 17 + pal) & (TEXRES_HASHSIZE - 1);
+}
+
+//
+// TexRes_Find
+//
+
+static texres_t* TexRes_Find(int kind, int index, int pal) {
+	texres_t* res;
+
+	for (res = texreshash[TexRes_Hash(kind, index, pal)]; res; res = res->next) {
+		if (res->kind == kind && res->index == index && res->pal == pal) {
+			return res;
+		}
+	}
+
+	return NULL;
+}
+
+//
+// TexRes_Unlink
+//
+
+static void TexRes_Unlink(texres_t* res) {
+	if (res->lruprev) {
+		res->lruprev->lrunext = res->lrunext;
+	}
+	else {
+		texreslruhead = res->lrunext;
+	}
+
+	if (res->lrunext) {
+		res->lrunext->lruprev = res->lruprev;
+	}
+	else {
+		texreslrutail = res->lruprev;
+	}
+
+	res->lruprev = res->lrunext = NULL;
+}
+
+//
+// TexRes_MarkUsed
+// Moves the entry to the end of the LRU list
+//
+
+static void TexRes_MarkUsed(texres_t* res) {
+	res->lastframe = texresframe;
+
+	if (res == texreslrutail) {
+		return;
+	}
+
+	if (res->lruprev || res->lrunext || res == texreslruhead) {
+		TexRes_Unlink(res);
+	}
+
+	res->lruprev = texreslrutail;
+	res->lrunext = NULL;
+
+	if (texreslrutail) {
+		texreslrutail->lrunext = res;
+	}
+	else {
+		texreslruhead = res;
+	}
+
+	texreslrutail = res;
+}
+
+//
+// TexRes_Unload
+// Deletes the texture object and forgets the entry
+//
+
+static void TexRes_Unload(texres_t* res) {
+	texres_t** link;
+
+	if (res->kind == TC_WORLD) {
+		GL_UnloadTexture(&textureptr[res->index][res->pal]);
+
+		if (curtexture == res->index) {
+			curtexture = -1;
+		}
+	}
+	else {
+		GL_UnloadTexture(&spriteptr[res->index][res->pal]);
+
+		if (cursprite == res->index) {
+			cursprite = -1;
+		}
+	}
+
+	for (link = &texreshash[TexRes_Hash(res->kind, res->index, res->pal)]; *link; link = &(*link)->next) {
+		if (*link == res) {
+			*link = res->next;
+			break;
+		}
+	}
+
+	TexRes_Unlink(res);
+
+	texresbytes -= res->size;
+	texrescount--;
+
+	free(res);
+}
+
+//
+// TexRes_Evict
+// Unloads least recently used textures until the total fits the
+// budget. Anything bound during this frame is kept
+//
+
+static void TexRes_Evict(void) {
+	uint64_t budget;
+
+	if (r_texturebudget.value <= 0) {
+		return;
+	}
+
+	budget = (uint64_t)r_texturebudget.value << 20;
+
+	// everything after the first texture bound this frame was
+	// bound this frame too
+	while (texresbytes > budget && texreslruhead &&
+		texreslruhead->lastframe != texresframe) {
+		TexRes_Unload(texreslruhead);
+		texresevictions++;
+	}
+}
+
+//
+// GL_TouchTexture
+// Marks an already loaded texture as used this frame
+//
+
+void GL_TouchTexture(int kind, int index, int pal) {
+	texres_t* res;
+
+	if (!(res = TexRes_Find(kind, index, pal))) {
+		texresmisses++;
+		return;
+	}
+
+	TexRes_MarkUsed(res);
+	texreshits++;
+}
+
+//
+// GL_AddResidentTexture
+// Called once a texture has been uploaded
+//
+
+void GL_AddResidentTexture(int kind, int index, int pal, int width, int height, boolean mipmapped) {
+	texres_t* res;
+	int size;
+	int hash;
+
+	size = width * height * 4;
+
+	if (has_GL_ARB_texture_compression) {
+		int compressed = 0;
+
+		dglGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_ARB, &compressed);
+
+		if (compressed) {
+			dglGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE_ARB, &size);
+		}
+	}
+
+	// the rest of the chain adds up to a third of the top level
+	if (mipmapped) {
+		size += size / 3;
+	}
+
+	texresmisses++;
+	texresframebytes += size;
+
+	if ((res = TexRes_Find(kind, index, pal))) {
+		texresbytes -= res->size;
+	}
+	else {
+		hash = TexRes_Hash(kind, index, pal);
+
+		res = (texres_t*)malloc(sizeof(texres_t));
+		res->kind = kind;
+		res->index = index;
+		res->pal = pal;
+		res->lruprev = NULL;
+		res->lrunext = NULL;
+		res->next = texreshash[hash];
+		texreshash[hash] = res;
+
+		texrescount++;
+	}
+
+	res->size = size;
+	TexRes_MarkUsed(res);
+	texresbytes += size;
+
+	TexRes_Evict();
+}
+
+//
+// GL_ResetResidency
+// Forgets every entry. The caller unloads the textures
+//
+
+void GL_ResetResidency(void) {
+	int i;
+
+	for (i = 0; i < TEXRES_HASHSIZE; i++) {
+		while (texreshash[i]) {
+			texres_t* next = texreshash[i]->next;
+
+			free(texreshash[i]);
+			texreshash[i] = next;
+		}
+	}
+
+	texreslruhead = NULL;
+	texreslrutail = NULL;
+	texrescount = 0;
+	texresbytes = 0;
+}
+
+//
+// GL_EndTextureFrame
+//
+
+void GL_EndTextureFrame(void) {
+	texreslastframebytes = texresframebytes;
+
+	if (texresframebytes > texrespeakframebytes) {
+		texrespeakframebytes = texresframebytes;
+	}
+
+	texresframebytes = 0;
+	texresframe++;
+}
+
+//
+// CMD_TexResStats
+//
+
+static CMD(TexResStats) {
+	CON_Printf(WHITE, "Resident: %i textures, %i KB of %i MB budget\n",
+		texrescount, (int)(texresbytes >> 10), (int)r_texturebudget.value);
+	CON_Printf(WHITE, "Binds: %i hits, %i misses, %i evictions\n",
+		texreshits, texresmisses, texresevictions);
+	CON_Printf(WHITE, "Uploads: %i KB last frame, %i KB peak frame\n",
+		(int)(texreslastframebytes >> 10), (int)(texrespeakframebytes >> 10));
+
+	if (param[0] && !dstricmp(param[0], "reset")) {
+		texreshits = texresmisses = texresevictions = 0;
+		texrespeakframebytes = 0;
+	}
+}
+
+//
+// GL_InitTexResidency
+//
+
+void GL_InitTexResidency(void) {
+	G_AddCommand("texresstats", CMD_TexResStats, 0);
+}
@@ -24,6 +24,9 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "doomstat.h"
 #include "r_local.h"
 #include "i_png.h"
@@ -31,11 +34,18 @@
 #include "w_wad.h"
 #include "z_zone.h"
 #include "gl_texture.h"
+#include "gl_texcomp.h"
+#include "gl_texres.h"
 #include "gl_main.h"
+#include "gl_batch.h"
 #include "p_spec.h"
 #include "p_local.h"
 #include "con_console.h"
 #include "g_actions.h"
+#include "m_misc.h"
+#include "md5.h"
+
+void W_Checksum(md5_digest_t digest);
 
 #define GL_MAX_TEX_UNITS    4
 
@@ -94,6 +104,7 @@ static gl_env_state_t gl_env_state[GL_MAX_TEX_UNITS];
 static int curunit = -1;
 
 CVAR_EXTERNAL(r_fillmode);
+CVAR_EXTERNAL(r_mipmaps);
 CVAR_CMD(r_texturecombiner, 1) {
 	int i;
 
@@ -138,10 +149,6 @@ static void InitWorldTextures(void) {
 	textureheight = Z_Calloc(numtextures * sizeof(word), PU_STATIC, NULL);
 
 	for (i = 0; i < numtextures; i++) {
-		byte* png;
-		int w;
-		int h;
-
 		// allocate at least one slot for each texture pointer
 		textureptr[i] = (dtexture*)Z_Malloc(1 * sizeof(dtexture), PU_STATIC, 0);
 
@@ -152,18 +159,94 @@ static void InitWorldTextures(void) {
 
 		texturetranslation[i] = i;
 		palettetranslation[i] = 0;
+		textureptr[i][0] = 0;
+	}
 
-		// read PNG and setup global width and heights
-		png = I_PNGReadData(t_start + i, true, true, false, &w, &h, NULL, 0);
+	CON_DPrintf("%i world textures initialized\n", numtextures);
+}
+
+//
+// ProbeWorldTextures
+// Read each PNG to setup global width and heights
+//
+
+static void ProbeWorldTextures(void) {
+	int i;
+
+	for (i = 0; i < numtextures; i++) {
+		int w;
+		int h;
+
+		I_PNGReadDataTemp(t_start + i, true, true, false, &w, &h, NULL, 0);
 
-		textureptr[i][0] = 0;
 		texturewidth[i] = w;
 		textureheight[i] = h;
+	}
+}
+
+//
+// GenerateMipmaps
+// Fills in the mip chain of the bound texture once level 0 is
+// uploaded. The driver does it if it can, otherwise data (if
+// given) is box filtered down in place. Sets the texture filter
+// to match what was built and returns true if there's a chain
+//
 
-		Z_Free(png);
+static boolean GenerateMipmaps(byte* data, int width, int height) {
+	int format;
+	int level;
+
+	if (r_mipmaps.value <= 0) {
+		GL_SetTextureFilter();
+		return false;
 	}
 
-	CON_DPrintf("%i world textures initialized\n", numtextures);
+	if (has_GL_EXT_framebuffer_object) {
+		dglGenerateMipmapEXT(GL_TEXTURE_2D);
+		GL_SetMipmapFilter();
+		return true;
+	}
+
+	if (!data) {
+		GL_SetTextureFilter();
+		return false;
+	}
+
+	format = GL_RGBA8;
+	dglGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+
+	for (level = 1; width > 1 || height > 1; level++) {
+		int w = MAX(width >> 1, 1);
+		int h = MAX(height >> 1, 1);
+		int x;
+		int y;
+		int c;
+
+		// each output texel is written at or before the first
+		// input texel it reads, so this can be done in place
+		for (y = 0; y < h; y++) {
+			byte* row1 = data + (MIN(y * 2, height - 1) * width) * 4;
+			byte* row2 = data + (MIN(y * 2 + 1, height - 1) * width) * 4;
+
+			for (x = 0; x < w; x++) {
+				int x1 = MIN(x * 2, width - 1) * 4;
+				int x2 = MIN(x * 2 + 1, width - 1) * 4;
+
+				for (c = 0; c < 4; c++) {
+					data[(y * w + x) * 4 + c] = (byte)((row1[x1 + c] + row1[x2 + c] +
+						row2[x1 + c] + row2[x2 + c] + 2) >> 2);
+				}
+			}
+		}
+
+		width = w;
+		height = h;
+
+		dglTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+
+	GL_SetMipmapFilter();
+	return true;
 }
 
 //
@@ -174,6 +257,7 @@ void GL_BindWorldTexture(int texnum, int* width, int* height) {
 	byte* png;
 	int w;
 	int h;
+	boolean mipmapped;
 
 	if (r_fillmode.value <= 0) {
 		return;
@@ -200,6 +284,7 @@ void GL_BindWorldTexture(int texnum, int* width, int* height) {
 		dglBindTexture(GL_TEXTURE_2D, textureptr[texnum][palettetranslation[texnum]]);
 		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		GL_TouchTexture(TC_WORLD, texnum, palettetranslation[texnum]);
 		if (devparm) {
 			glBindCalls++;
 		}
@@ -207,18 +292,25 @@ void GL_BindWorldTexture(int texnum, int* width, int* height) {
 	}
 
 	// create a new texture
-	png = I_PNGReadData(t_start + texnum, false, true, true,
-		&w, &h, NULL, palettetranslation[texnum]);
-
 	dglGenTextures(1, &textureptr[texnum][palettetranslation[texnum]]);
 	dglBindTexture(GL_TEXTURE_2D, textureptr[texnum][palettetranslation[texnum]]);
-	dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, png);
+
+	png = NULL;
+
+	if (!GL_LoadCachedTexture(TC_WORLD, texnum, palettetranslation[texnum], &w, &h)) {
+		png = I_PNGReadDataTemp(t_start + texnum, false, true, true,
+			&w, &h, NULL, palettetranslation[texnum]);
+
+		GL_CompressTexture(TC_WORLD, texnum, palettetranslation[texnum], png, w, h);
+	}
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
 	GL_CheckFillMode();
-	GL_SetTextureFilter();
+	mipmapped = GenerateMipmaps(png, w, h);
+
+	GL_AddResidentTexture(TC_WORLD, texnum, palettetranslation[texnum], w, h, mipmapped);
 
 	// update global width and heights
 	texturewidth[texnum] = w;
@@ -231,8 +323,6 @@ void GL_BindWorldTexture(int texnum, int* width, int* height) {
 		*height = textureheight[texnum];
 	}
 
-	Z_Free(png);
-
 	if (devparm) {
 		glBindCalls++;
 	}
@@ -289,22 +379,30 @@ static void InitGfxTextures(void) {
 	gfxorigheight = Z_Calloc(numgfx * sizeof(int16_t), PU_STATIC, NULL);
 
 	for (i = 0; i < numgfx; i++) {
-		byte* png;
+		gfxptr[i] = 0;
+	}
+
+	CON_DPrintf("%i generic textures initialized\n", numgfx);
+}
+
+//
+// ProbeGfxTextures
+//
+
+static void ProbeGfxTextures(void) {
+	int i;
+
+	for (i = 0; i < numgfx; i++) {
 		int w;
 		int h;
 
-		png = I_PNGReadData(g_start + i, true, true, false, &w, &h, NULL, 0);
+		I_PNGReadDataTemp(g_start + i, true, true, false, &w, &h, NULL, 0);
 
-		gfxptr[i] = 0;
 		gfxwidth[i] = w;
 		gfxorigwidth[i] = w;
 		gfxorigheight[i] = h;
 		gfxheight[i] = h;
-
-		Z_Free(png);
 	}
-
-	CON_DPrintf("%i generic textures initialized\n", numgfx);
 }
 
 //
@@ -338,7 +436,7 @@ int GL_BindGfxTexture(const char* name, int alpha) {
 		return gfxid;
 	}
 
-	png = I_PNGReadData(lump, false, true, alpha, &width, &height, NULL, 0);
+	png = I_PNGReadDataTemp(lump, false, true, alpha, &width, &height, NULL, 0);
 
 	dglGenTextures(1, &gfxptr[gfxid]);
 	dglBindTexture(GL_TEXTURE_2D, gfxptr[gfxid]);
@@ -348,7 +446,6 @@ int GL_BindGfxTexture(const char* name, int alpha) {
 	type = alpha ? GL_RGBA : GL_RGB;
 
 	SetTextureImage(png, (alpha ? 4 : 3), &width, &height, format, type);
-	Z_Free(png);
 
 	gfxwidth[gfxid] = width;
 	gfxheight[gfxid] = height;
@@ -369,7 +466,6 @@ static void InitSpriteTextures(void) {
 	int j = 0;
 	int p = 0;
 	int palcnt = 0;
-	int offset[2];
 
 	s_start = W_GetNumForName("S_START") + 1;
 	s_end = W_GetNumForName("S_END") - 1;
@@ -410,9 +506,6 @@ static void InitSpriteTextures(void) {
 	CON_DPrintf("%i external palettes initialized\n", palcnt);
 
 	for (i = 0; i < numsprtex; i++) {
-		byte* png;
-		int w;
-		int h;
 		size_t x;
 
 		// allocate # of sprites per pointer
@@ -422,17 +515,211 @@ static void InitSpriteTextures(void) {
 		for (x = 0; x < spritecount[i]; x++) {
 			spriteptr[i][x] = 0;
 		}
+	}
+}
+
+//
+// ProbeSpriteTextures
+//
+
+static void ProbeSpriteTextures(void) {
+	int i;
+	int offset[2];
+
+	for (i = 0; i < numsprtex; i++) {
+		int w;
+		int h;
 
 		// read data and setup globals
-		png = I_PNGReadData(s_start + i, true, true, false, &w, &h, offset, 0);
+		I_PNGReadDataTemp(s_start + i, true, true, false, &w, &h, offset, 0);
 
 		spritewidth[i] = w;
 		spriteheight[i] = h;
 		spriteoffset[i] = (float)offset[0];
 		spritetopoffset[i] = (float)offset[1];
+	}
+}
+
+//
+// TEXTURE SIZE CACHE
+//
+// Finding the size and offsets of every texture, gfx and sprite
+// means decoding each PNG at startup. The results only depend on
+// the loaded wads, so they're kept in a flat file keyed on the
+// wad directory checksum and read back in one go next time
+//
+
+#define TEXCACHE_FILE       "texcache.dat"
+#define TEXCACHE_VERSION    1
+
+typedef struct {
+	char            id[8];
+	int             version;
+	md5_digest_t    key;
+	int             numtextures;
+	int             numgfx;
+	int             numsprites;
+} texcacheheader_t;
+
+typedef struct {
+	word            width;
+	word            height;
+} texcachesize_t;
+
+typedef struct {
+	word            width;
+	word            height;
+	float           offset;
+	float           topoffset;
+} texcachesprite_t;
+
+//
+// TexCache_Size
+//
+
+static size_t TexCache_Size(void) {
+	return sizeof(texcacheheader_t) +
+		(numtextures + numgfx) * sizeof(texcachesize_t) +
+		numsprtex * sizeof(texcachesprite_t);
+}
 
-		Z_Free(png);
+//
+// TexCache_SetupHeader
+//
+
+static void TexCache_SetupHeader(texcacheheader_t* header) {
+	dmemset(header, 0, sizeof(texcacheheader_t));
+	dmemcpy(header->id, "TEXCACHE", 8);
+	header->version = TEXCACHE_VERSION;
+	W_Checksum(header->key);
+	header->numtextures = numtextures;
+	header->numgfx = numgfx;
+	header->numsprites = numsprtex;
+}
+
+//
+// TexCache_Load
+// Returns false if the cache is missing or stale
+//
+
+static boolean TexCache_Load(void) {
+	texcacheheader_t header;
+	texcachesize_t* size;
+	texcachesprite_t* sprite;
+	char* path;
+	byte* data;
+	FILE* fp;
+	size_t length;
+	int i;
+
+	if (!(path = I_GetUserFile(TEXCACHE_FILE))) {
+		return false;
+	}
+
+	fp = fopen(path, "rb");
+	free(path);
+
+	if (!fp) {
+		return false;
+	}
+
+	length = TexCache_Size();
+	data = (byte*)malloc(length + 1);
+
+	// a file of any other size can't be ours
+	if (fread(data, 1, length + 1, fp) != length) {
+		free(data);
+		fclose(fp);
+		return false;
+	}
+
+	fclose(fp);
+
+	TexCache_SetupHeader(&header);
+
+	if (memcmp(data, &header, sizeof(texcacheheader_t))) {
+		free(data);
+		return false;
+	}
+
+	size = (texcachesize_t*)(data + sizeof(texcacheheader_t));
+
+	for (i = 0; i < numtextures; i++, size++) {
+		texturewidth[i] = size->width;
+		textureheight[i] = size->height;
+	}
+
+	for (i = 0; i < numgfx; i++, size++) {
+		gfxwidth[i] = gfxorigwidth[i] = size->width;
+		gfxheight[i] = gfxorigheight[i] = size->height;
 	}
+
+	sprite = (texcachesprite_t*)size;
+
+	for (i = 0; i < numsprtex; i++, sprite++) {
+		spritewidth[i] = sprite->width;
+		spriteheight[i] = sprite->height;
+		spriteoffset[i] = sprite->offset;
+		spritetopoffset[i] = sprite->topoffset;
+	}
+
+	free(data);
+	return true;
+}
+
+//
+// TexCache_Save
+//
+
+static void TexCache_Save(void) {
+	texcachesize_t* size;
+	texcachesprite_t* sprite;
+	char* path;
+	byte* data;
+	FILE* fp;
+	size_t length;
+	int i;
+
+	if (!(path = I_GetUserFile(TEXCACHE_FILE))) {
+		return;
+	}
+
+	length = TexCache_Size();
+	data = (byte*)calloc(1, length);
+
+	TexCache_SetupHeader((texcacheheader_t*)data);
+
+	size = (texcachesize_t*)(data + sizeof(texcacheheader_t));
+
+	for (i = 0; i < numtextures; i++, size++) {
+		size->width = texturewidth[i];
+		size->height = textureheight[i];
+	}
+
+	for (i = 0; i < numgfx; i++, size++) {
+		size->width = gfxwidth[i];
+		size->height = gfxheight[i];
+	}
+
+	sprite = (texcachesprite_t*)size;
+
+	for (i = 0; i < numsprtex; i++, sprite++) {
+		sprite->width = spritewidth[i];
+		sprite->height = spriteheight[i];
+		sprite->offset = spriteoffset[i];
+		sprite->topoffset = spritetopoffset[i];
+	}
+
+	if ((fp = fopen(path, "wb"))) {
+		if (fwrite(data, 1, length, fp) != length) {
+			CON_Warnf("TexCache_Save: couldn't write %s\n", path);
+		}
+
+		fclose(fp);
+	}
+
+	free(data);
+	free(path);
 }
 
 //
@@ -443,6 +730,7 @@ void GL_BindSpriteTexture(int spritenum, int pal) {
 	byte* png;
 	int w;
 	int h;
+	boolean mipmapped;
 
 	if (r_fillmode.value <= 0) {
 		return;
@@ -465,22 +753,30 @@ void GL_BindSpriteTexture(int spritenum, int pal) {
 		dglBindTexture(GL_TEXTURE_2D, spriteptr[spritenum][pal]);
 		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
+		GL_TouchTexture(TC_SPRITE, spritenum, pal);
 		if (devparm) {
 			glBindCalls++;
 		}
 		return;
 	}
 
-	png = I_PNGReadData(s_start + spritenum, false, true, true, &w, &h, NULL, pal);
-
 	dglGenTextures(1, &spriteptr[spritenum][pal]);
 	dglBindTexture(GL_TEXTURE_2D, spriteptr[spritenum][pal]);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
-	SetTextureImage(png, 4, &w, &h, GL_RGBA8, GL_RGBA);
-	Z_Free(png);
+	png = NULL;
+
+	if (!GL_LoadCachedTexture(TC_SPRITE, spritenum, pal, &w, &h)) {
+		png = I_PNGReadDataTemp(s_start + spritenum, false, true, true, &w, &h, NULL, pal);
+		GL_CompressTexture(TC_SPRITE, spritenum, pal, png, w, h);
+	}
+
+	GL_CheckFillMode();
+	mipmapped = GenerateMipmaps(png, w, h);
+
+	GL_AddResidentTexture(TC_SPRITE, spritenum, pal, w, h, mipmapped);
 
 	spritewidth[spritenum] = w;
 	spriteheight[spritenum] = h;
@@ -499,6 +795,9 @@ dtexture GL_ScreenToTexture(void) {
 	int width;
 	int height;
 
+	// the copy has to see any batched 2D
+	GL_FlushBatch();
+
 	dglEnable(GL_TEXTURE_2D);
 
 	dglGenTextures(1, &id);
@@ -658,6 +957,8 @@ void GL_UpdateEnvTexture(rcolor color) {
 
 void GL_UnloadTexture(dtexture* texture) {
 	if (*texture != 0) {
+		// batched 2D may still be waiting to draw with it
+		GL_FlushBatch();
 		dglDeleteTextures(1, texture);
 		*texture = 0;
 	}
@@ -837,6 +1138,65 @@ void GL_SetCombineOperandAlpha(int operand, int target) {
 	dglTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA + operand, state->operand_alpha[operand]);
 }
 
+//
+// CMD_PNGBench
+// Decodes every world texture and sprite the way they are
+// uploaded, once into new zone blocks and once into the
+// reused scratch buffer
+//
+
+static CMD(PNGBench) {
+	uint64_t start;
+	uint64_t alloctime;
+	uint64_t pooltime;
+	uint64_t bytes;
+	int count;
+	int pass;
+	int i;
+	int w;
+	int h;
+
+	count = numtextures + numsprtex;
+
+	if (!count) {
+		return;
+	}
+
+	alloctime = pooltime = bytes = 0;
+
+	for (pass = 0; pass < 2; pass++) {
+		start = I_GetTimeUS();
+
+		for (i = 0; i < count; i++) {
+			int lump = i < numtextures ? t_start + i : s_start + (i - numtextures);
+			byte* png;
+
+			if (pass == 0) {
+				png = I_PNGReadData(lump, false, true, true, &w, &h, NULL, 0);
+				Z_Free(png);
+				bytes += w * h * 4;
+			}
+			else {
+				I_PNGReadDataTemp(lump, false, true, true, &w, &h, NULL, 0);
+			}
+		}
+
+		if (pass == 0) {
+			alloctime = I_GetTimeUS() - start;
+		}
+		else {
+			pooltime = I_GetTimeUS() - start;
+		}
+	}
+
+	CON_Printf(WHITE, "Decoded %i images (%i KB RGBA)\n", count, (int)(bytes >> 10));
+	CON_Printf(WHITE, "Allocated: %i ms (%i us/image), Pooled: %i ms (%i us/image)\n",
+		(int)(alloctime / 1000), (int)(alloctime / count),
+		(int)(pooltime / 1000), (int)(pooltime / count));
+	CON_Printf(WHITE, "Throughput: %i MB/s\n",
+		(int)(bytes / MAX(pooltime, 1)));
+}
+
 //
 // GL_InitTextures
 //
@@ -844,12 +1204,47 @@ void GL_SetCombineOperandAlpha(int operand, int target) {
 void GL_InitTextures(void) {
 	CON_DPrintf("--------Initializing textures--------\n");
 
+	uint64_t start;
+	boolean cached;
+
+	start = I_GetTimeUS();
+
 	InitWorldTextures();
 	InitGfxTextures();
 	InitSpriteTextures();
+	GL_ResetResidency();
+
+	//!
+	// @category video
+	//
+	// Don't use or write the cache of texture and sprite sizes
+	//
+
+	cached = false;
+
+	if (!M_CheckParm("-notexcache")) {
+		cached = TexCache_Load();
+	}
+
+	if (!cached) {
+		ProbeWorldTextures();
+		ProbeGfxTextures();
+		ProbeSpriteTextures();
+
+		if (!M_CheckParm("-notexcache")) {
+			TexCache_Save();
+		}
+	}
+
+	CON_DPrintf("Texture sizes %s in %i ms\n", cached ? "loaded from cache" : "probed",
+		(int)((I_GetTimeUS() - start) / 1000));
 
 	G_AddCommand("dumptextures", CMD_DumpTextures, 0);
 	G_AddCommand("resettextures", CMD_ResetTextures, 0);
+	G_AddCommand("pngbench", CMD_PNGBench, 0);
+
+	GL_InitTexCompression();
+	GL_InitTexResidency();
 }
 
 //
@@ -909,6 +1304,8 @@ void GL_DumpTextures(void) {
 	for (i = 0; i < numgfx; i++) {
 		GL_UnloadTexture(&gfxptr[i]);
 	}
+
+	GL_ResetResidency();
 }
 
 //
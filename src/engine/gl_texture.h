@@ -26,6 +26,13 @@
 
 #include "gl_main.h"
 
+// texture sets that are cached and budgeted per lump and palette
+typedef enum {
+	TC_WORLD,
+	TC_SPRITE,
+	NUMTCKINDS
+} tckind_t;
+
 extern int                  curtexture;
 extern int                  cursprite;
 extern int                    curtrans;
@@ -58,6 +65,7 @@ extern word* spritewidth;
 extern float* spriteoffset;
 extern float* spritetopoffset;
 extern word* spriteheight;
+extern word* spritecount;
 
 void        GL_InitTextures(void);
 void        GL_UnloadTexture(dtexture* texture);
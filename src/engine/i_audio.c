@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 
 #ifndef _WIN32
 #include <sys/types.h>
@@ -52,11 +53,21 @@
 #include "w_wad.h"
 #include "z_zone.h"
 #include "i_swap.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "tables.h"
 #include "con_console.h"    // for cvars
+#include "g_actions.h"
 
 // 20120203 villsa - cvar for soundfont location
 CVAR(s_soundfont, doomsnd.sf2);
 
+// play sound effects from pre-rendered PCM instead of live synth voices
+CVAR(s_pcmcache, 0);
+
+// 0 = run the sequencer every millisecond, 1 = sleep until the next event
+CVAR(s_scheduler, 0);
+
 // 20120203 villsa - cvar for audio driver
 #ifdef _WIN32
 CVAR_CMD(s_driver, dsound)
@@ -109,12 +120,14 @@ static SDL_Mutex* lock = NULL;
 #define MUTEX_UNLOCK()  SDL_UnlockMutex(lock);
 
 //
-// Semaphore stuff
+// Wake-up semaphore for the audio thread when it's
+// sleeping until the next event (s_scheduler 1)
 //
+static SDL_Semaphore* seqwake = NULL;
+static SDL_AtomicInt seqsleeping;
 
-static SDL_Semaphore* semaphore = NULL;
-#define SEMAPHORE_LOCK()    if(SDL_WaitSemaphore(semaphore) == 0) {
-#define SEMAPHORE_UNLOCK()  SDL_PostSemaphore(semaphore); }
+#define SEQ_MAXSLEEP    250     // msecs
+#define SEQ_PCMPOLL     10      // msecs between checks on pre-rendered sounds
 
 // 20120205 villsa - bool to determine if sequencer is ready or not
 static int seqready = 0;
@@ -156,6 +169,89 @@ typedef struct {
     double      timediv;
 } song_t;
 
+//
+// PRE-RENDERED SOUND EFFECTS
+//
+// With s_pcmcache enabled, each sound effect is rendered
+// once through a private synth on a worker thread and
+// played back by a small mixer that runs inside the
+// fluidsynth audio callback. Only music keeps using live
+// synth voices. Entries are rendered the first time a
+// sound is played (until then the live synth is used)
+// and saved to disk on shutdown
+//
+
+#define PCM_CACHEFILE   "sfxcache.dat"
+#define PCM_VERSION     2
+#define PCM_DEPTHS      3           // reverb depths 0, 16 and 32
+#define PCM_RENDERGAIN  0.5f        // headroom for 16-bit samples
+#define PCM_CENTERGAIN  1.4142136f  // undoes the synth's equal power center pan
+#define PCM_MAXLENGTH   10000       // msecs. longer sounds are assumed to loop
+#define PCM_MAXTAIL     2000        // msecs of release and reverb kept after a sound ends
+#define PCM_SILENCE     8           // peak sample level treated as silent
+#define PCM_QUIETMSECS  20          // msecs of silence before the tail is cut
+#define PCM_QUEUESIZE   256         // must be a power of two
+
+typedef enum {
+    PCM_STATE_NONE = 0,
+    PCM_STATE_QUEUED,
+    PCM_STATE_READY,
+    PCM_STATE_UNCACHED      // loops or failed to render; always use the synth
+} pcmstate_e;
+
+typedef struct {
+    SDL_AtomicInt   state;
+    int             frames;
+    short* data;            // interleaved stereo
+} pcmsfx_t;
+
+typedef enum {
+    VOICE_IDLE = 0,
+    VOICE_START,
+    VOICE_PLAYING,
+    VOICE_DONE
+} voicestate_e;
+
+typedef struct {
+    SDL_AtomicInt   state;
+
+    // written by the sequencer before the voice is started
+    short* data;
+    int             frames;
+
+    // written by the sequencer, read by the mixer
+    float           left;
+    float           right;
+
+    // mixer only
+    short* playdata;
+    int             playframes;
+    int             pos;
+} pcmvoice_t;
+
+typedef struct {
+    pcmsfx_t* sfx;             // nsongs * PCM_DEPTHS entries
+    int             numsfx;
+    char* sfpath;
+    md5_digest_t    key;
+    int             samplerate;
+    boolean         dirty;
+
+    // render requests from the sequencer to the worker
+    int             queue[PCM_QUEUESIZE];
+    SDL_AtomicInt   queuehead;
+    SDL_AtomicInt   queuetail;
+    SDL_Semaphore* wake;
+    SDL_AtomicInt   quit;
+    SDL_Thread* thread;
+
+    int             rendered;
+    int             loaded;
+    uint64_t        rendertime;
+} pcmcache_t;
+
+static pcmcache_t pcmcache;
+
 //
 // SEQUENCER CHANNEL
 //
@@ -164,9 +260,12 @@ typedef struct {
 // is where communication between the audio
 // thread and the game could get dangerous
 // as they both need to access and modify
-// data. In order to avoid this, certain
-// properties have been divided up for
-// both the audio thread and game code only
+// data. In order to avoid this, the game
+// code never modifies a channel directly;
+// it sends commands through the sound queue
+// below instead. The only exception is the
+// origin, which is claimed and cleared by
+// the game code with atomic writes
 //
 
 typedef enum {
@@ -186,14 +285,13 @@ typedef struct {
     // used primarily by normal sounds
     byte        id;
 
-    // these are both accessed by the
-    // audio thread and the game code
-    // and should lock and unlock
-    // the mutex whenever these need
-    // to be modified..
+    // written by the game code only
+    // (see I_ClaimChannel)
+    sndsrc_t* origin;
+
+    // accessed by the audio thread only
     float       volume;
     byte        pan;
-    sndsrc_t* origin;
     int         depth;
 
     // accessed by the audio thread only
@@ -210,13 +308,75 @@ typedef struct {
     chanstate_e state;
     int         paused;
 
-    // read by audio thread but only
-    // modified by game code
     int         stop;
     float       basevol;
+
+    // set when playing back a pre-rendered sound
+    pcmsfx_t* pcm;
 } channel_t;
 
 static channel_t playlist[MIDI_CHANNELS];   // channels active in sequencer
+static pcmvoice_t pcmvoices[MIDI_CHANNELS]; // mixer voices, one per channel
+
+// set by the game code when it claims a channel,
+// cleared by the audio thread once it's released
+static SDL_AtomicInt chanused[MIDI_CHANNELS];
+
+//
+// SOUND COMMAND QUEUE
+//
+// Single producer (game code), single consumer (audio
+// thread) ring. The game pushes a command and returns
+// immediately; the audio thread drains everything that's
+// pending before it runs the playlist. Neither side ever
+// waits on the other. If the ring is ever full the
+// command is dropped and counted rather than blocking
+//
+
+#define SNDQUEUESIZE    1024    // must be a power of two
+
+typedef enum {
+    SNDCMD_STARTSOUND = 0,
+    SNDCMD_STARTMUSIC,
+    SNDCMD_STOPSOUND,
+    SNDCMD_UPDATE,
+    MAXSNDCMDTYPES
+} sndcmd_e;
+
+typedef struct {
+    sndcmd_e    type;
+    int         channel;
+    int         id;
+    int         track;
+    sndsrc_t* origin;
+    int         volume;
+    int         pan;
+    int         depth;
+    uint64_t    time;
+} sndcmd_t;
+
+static sndcmd_t sndqueue[SNDQUEUESIZE];
+static SDL_AtomicInt sndhead;       // only written by the game code
+static SDL_AtomicInt sndtail;       // only written by the audio thread
+
+typedef struct {
+    // written by the game code
+    int         pushed;
+    int         dropped;        // queue was full
+    int         nochannel;      // no free channel to claim
+    int         maxdepth;
+    int         maxpushtime;    // microseconds
+
+    uint64_t    resettime;
+
+    // written by the audio thread
+    int         drained;
+    int         maxlatency;     // microseconds
+    uint64_t    totallatency;
+    int         passes;         // times the playlist was run
+} sndqueuestats_t;
+
+static sndqueuestats_t sndstats;
 
 //
 // DOOM SEQUENCER
@@ -310,6 +470,19 @@ static double Song_GetTimeDivision(song_t* song) {
     return (double)song->tempo / (double)song->delta / 1000.0;
 }
 
+//
+// Seq_Wake
+//
+// Wake up the audio thread if it's sleeping until its
+// next event. Never blocks
+//
+
+static void Seq_Wake(void) {
+    if (SDL_AtomicCompareAndSwap(&seqsleeping, 1, 0)) {
+        SDL_PostSemaphore(seqwake);
+    }
+}
+
 //
 // Seq_SetStatus
 //
@@ -318,6 +491,8 @@ static void Seq_SetStatus(doomseq_t* seq, int status) {
     MUTEX_LOCK()
         seq->signal = status;
     MUTEX_UNLOCK()
+
+    Seq_Wake();
 }
 
 //
@@ -465,7 +640,13 @@ static int Chan_RemoveTrackFromPlaylist(doomseq_t* seq, channel_t* chan) {
         return false;
     }
 
-    Chan_StopTrack(seq, chan);
+    if (chan->pcm) {
+        SDL_AtomicSet(&pcmvoices[chan - playlist].state, VOICE_IDLE);
+        chan->pcm = NULL;
+    }
+    else {
+        Chan_StopTrack(seq, chan);
+    }
 
     chan->song = NULL;
     chan->track = NULL;
@@ -486,61 +667,70 @@ static int Chan_RemoveTrackFromPlaylist(doomseq_t* seq, channel_t* chan) {
     chan->volume = 0.0f;
     chan->basevol = 0.0f;
     chan->pan = 0;
-    chan->origin = NULL;
 
     seq->voices--;
 
+    // sounds being pre-rendered don't use a playlist channel
+    if (seq != &doomseq) {
+        return true;
+    }
+
+    // hand the channel back to the game code
+    SDL_AtomicSetPtr((void**)&chan->origin, NULL);
+    SDL_AtomicSet(&chanused[chan - playlist], 0);
+
     return true;
 }
 
 //
-// Song_AddTrackToPlaylist
+// Chan_Setup
+//
+// Sets any default values to a channel and starts
+// reading the track
 //
-// Add a song to the playlist for the sequencer to play.
-// Sets any default values to the channel in the process
-// Both start sound and start music refer to this
 
-static channel_t* Song_AddTrackToPlaylist(doomseq_t* seq, song_t* song, track_t* track) {
-    int i;
+static void Chan_Setup(doomseq_t* seq, channel_t* chan, song_t* song, track_t* track, int id) {
+    chan->song = song;
+    chan->track = track;
+    chan->tics = 0;
+    chan->lasttic = 0;
+    chan->starttic = 0;
+    chan->pos = track->data;
+    chan->jump = NULL;
+    chan->state = CHAN_STATE_READY;
+    chan->paused = false;
+    chan->stop = false;
+    chan->key = 0;
+    chan->velocity = 0;
+    chan->id = id;
+    chan->volume = 127.0f;
+    chan->basevol = 127.0f;
+    chan->pan = 64;
+    chan->depth = 0;
+    chan->starttime = 0;
+    chan->curtime = 0;
+    chan->pcm = NULL;
 
-    for (i = 0; i < MIDI_CHANNELS; i++) {
+    // immediately start reading the midi track
+    chan->nexttic = Chan_GetNextTick(chan);
 
-        if (playlist[i].song == NULL) {
-            playlist[i].song = song;
-            playlist[i].track = track;
-            playlist[i].tics = 0;
-            playlist[i].lasttic = 0;
-            playlist[i].starttic = 0;
-            playlist[i].pos = track->data;
-            playlist[i].jump = NULL;
-            playlist[i].state = CHAN_STATE_READY;
-            playlist[i].paused = false;
-            playlist[i].stop = false;
-            playlist[i].key = 0;
-            playlist[i].velocity = 0;
-
-            // channels 0 through 15 are reserved for music only
-            // channel ids should only be accessed by non-music sounds
-            playlist[i].id = 0x0f + i;
-
-            playlist[i].volume = 127.0f;
-            playlist[i].basevol = 127.0f;
-            playlist[i].pan = 64;
-            playlist[i].origin = NULL;
-            playlist[i].depth = 0;
-            playlist[i].starttime = 0;
-            playlist[i].curtime = 0;
-
-            // immediately start reading the midi track
-            playlist[i].nexttic = Chan_GetNextTick(&playlist[i]);
-
-            seq->voices++;
-
-            return &playlist[i];
-        }
-    }
+    seq->voices++;
+}
 
-    return NULL;
+//
+// Song_AddTrackToPlaylist
+//
+// Add a song to the playlist for the sequencer to play.
+// Both start sound and start music refer to this. The
+// channel has already been claimed by the game code
+//
+
+static channel_t* Song_AddTrackToPlaylist(doomseq_t* seq, int c, song_t* song, track_t* track) {
+    // channels 0 through 15 are reserved for music only
+    // channel ids should only be accessed by non-music sounds
+    Chan_Setup(seq, &playlist[c], song, track, 0x0f + c);
+
+    return &playlist[c];
 }
 
 //
@@ -741,17 +931,15 @@ static int Signal_StopAll(doomseq_t* seq) {
     channel_t* c;
     int i;
 
-    SEMAPHORE_LOCK()
-        for (i = 0; i < MIDI_CHANNELS; i++) {
-            c = &playlist[i];
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        c = &playlist[i];
 
-            if (c->song) {
-                Chan_RemoveTrackFromPlaylist(seq, c);
-            }
+        if (c->song) {
+            Chan_RemoveTrackFromPlaylist(seq, c);
         }
-    SEMAPHORE_UNLOCK()
+    }
 
-        Seq_SetStatus(seq, SEQ_SIGNAL_READY);
+    Seq_SetStatus(seq, SEQ_SIGNAL_READY);
     return 1;
 }
 
@@ -776,13 +964,11 @@ static int Signal_Pause(doomseq_t* seq) {
     int i;
     channel_t* c;
 
-    SEMAPHORE_LOCK()
-        for (i = 0; i < MIDI_CHANNELS; i++) {
-            c = &playlist[i];
-        }
-    SEMAPHORE_UNLOCK()
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        c = &playlist[i];
+    }
 
-        Seq_SetStatus(seq, SEQ_SIGNAL_READY);
+    Seq_SetStatus(seq, SEQ_SIGNAL_READY);
     return 1;
 }
 
@@ -796,13 +982,11 @@ static int Signal_Resume(doomseq_t* seq) {
     int i;
     channel_t* c;
 
-    SEMAPHORE_LOCK()
-        for (i = 0; i < MIDI_CHANNELS; i++) {
-            c = &playlist[i];
-        }
-    SEMAPHORE_UNLOCK()
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        c = &playlist[i];
+    }
 
-        Seq_SetStatus(seq, SEQ_SIGNAL_READY);
+    Seq_SetStatus(seq, SEQ_SIGNAL_READY);
     return 1;
 }
 
@@ -811,13 +995,9 @@ static int Signal_Resume(doomseq_t* seq) {
 //
 
 static int Signal_UpdateGain(doomseq_t* seq) {
-    SEMAPHORE_LOCK()
-
-        Seq_SetGain(seq);
+    Seq_SetGain(seq);
 
-    SEMAPHORE_UNLOCK()
-
-        Seq_SetStatus(seq, SEQ_SIGNAL_READY);
+    Seq_SetStatus(seq, SEQ_SIGNAL_READY);
     return 1;
 }
 
@@ -958,149 +1138,899 @@ static void Chan_RunSong(doomseq_t* seq, channel_t* chan, int msecs) {
 }
 
 //
-// Seq_RunSong
+// Pcm_GetSfx
+//
+// Returns the pre-rendered copy of a sound if there is one.
+// Otherwise asks the worker to render it and returns NULL so
+// the caller falls back to the synth. Audio thread only
 //
 
-static void Seq_RunSong(doomseq_t* seq, int msecs) {
+static pcmsfx_t* Pcm_GetSfx(doomseq_t* seq, int id, int track, int depth) {
+    pcmsfx_t* pcm;
+    int head;
     int i;
-    channel_t* chan;
 
-    seq->playtime = msecs;
+    if (!pcmcache.sfx || track != 0 || seq->songs[id].ntracks != 1 ||
+        seq->songs[id].type != 0 || (depth & 15) || depth >= 16 * PCM_DEPTHS) {
+        return NULL;
+    }
 
-    SEMAPHORE_LOCK()
-        for (i = 0; i < MIDI_CHANNELS; i++) {
-            chan = &playlist[i];
+    i = id * PCM_DEPTHS + (depth >> 4);
+    pcm = &pcmcache.sfx[i];
 
-            if (!chan->song) {
-                continue;
-            }
+    switch (SDL_AtomicGet(&pcm->state)) {
+    case PCM_STATE_READY:
+        return pcm;
 
-            if (chan->stop) {
-                Chan_RemoveTrackFromPlaylist(seq, chan);
-            }
-            else {
-                Chan_RunSong(seq, chan, msecs);
-            }
+    case PCM_STATE_NONE:
+        head = SDL_AtomicGet(&pcmcache.queuehead);
+
+        if (head - SDL_AtomicGet(&pcmcache.queuetail) < PCM_QUEUESIZE) {
+            SDL_AtomicSet(&pcm->state, PCM_STATE_QUEUED);
+            pcmcache.queue[head & (PCM_QUEUESIZE - 1)] = i;
+            SDL_AtomicSet(&pcmcache.queuehead, head + 1);
+            SDL_PostSemaphore(pcmcache.wake);
         }
-    SEMAPHORE_UNLOCK()
+        break;
+
+    default:
+        break;
+    }
+
+    return NULL;
 }
 
 //
-// Song_RegisterTracks
+// Chan_SetPCMVolume
 //
-// Allocate data for all tracks for a midi song
+// Works out the mixer gains that match what the synth
+// would have done with the same volume and pan controllers
 //
 
-static int Song_RegisterTracks(song_t* song) {
-    int i;
-    byte* data;
+static void Chan_SetPCMVolume(doomseq_t* seq, channel_t* chan) {
+    pcmvoice_t* voice;
+    float amp;
+    float angle;
 
-    song->tracks = (track_t*)Z_Calloc(sizeof(track_t) * song->ntracks, PU_STATIC, 0);
-    data = song->data + 0x0e;
+    voice = &pcmvoices[chan - playlist];
 
-    for (i = 0; i < song->ntracks; i++) {
-        track_t* track = &song->tracks[i];
+    // midi volume follows a 40*log10 curve
+    amp = (float)((int)((chan->basevol * seq->soundvolume) / 127.0f)) / 127.0f;
+    amp = amp * amp * seq->gain / (PCM_RENDERGAIN * 32768.0f);
 
-        dmemcpy(track, data, 8);
-        if (dstrncmp(track->header, "MTrk", 4)) {
-            return false;
-        }
+    angle = (float)MIN(chan->pan, 127) / 127.0f * (float)(M_PI / 2);
 
-        data = data + 8;
+    voice->left = amp * (float)cos(angle) * PCM_CENTERGAIN;
+    voice->right = amp * (float)sin(angle) * PCM_CENTERGAIN;
+}
 
-        track->length = I_SwapBE32(track->length);
-        track->data = data;
+//
+// Chan_StartPCM
+//
 
-        data = data + track->length;
+static void Chan_StartPCM(doomseq_t* seq, channel_t* chan, pcmsfx_t* pcm) {
+    pcmvoice_t* voice;
+
+    voice = &pcmvoices[chan - playlist];
+
+    chan->pcm = pcm;
+    voice->data = pcm->data;
+    voice->frames = pcm->frames;
+
+    Chan_SetPCMVolume(seq, chan);
+
+    SDL_AtomicSet(&voice->state, VOICE_START);
+}
+
+//
+// Chan_RunPCM
+//
+
+static void Chan_RunPCM(doomseq_t* seq, channel_t* chan) {
+    if (SDL_AtomicGet(&pcmvoices[chan - playlist].state) == VOICE_DONE) {
+        Chan_RemoveTrackFromPlaylist(seq, chan);
+        return;
     }
 
-    return true;
+    Chan_SetPCMVolume(seq, chan);
 }
 
 //
-// Seq_RegisterSongs
+// Pcm_Mix
 //
-// Allocate data for all midi songs
+// Add all playing voices on top of the synth output.
+// Runs inside the fluidsynth audio driver thread
 //
 
-static int Seq_RegisterSongs(doomseq_t* seq) {
+static void Pcm_Mix(int len, float* left, float* right) {
+    pcmvoice_t* voice;
+    short* data;
+    float l;
+    float r;
+    int count;
+    int state;
     int i;
-    int start;
-    int end;
-    int fail;
+    int j;
 
-    seq->nsongs = 0;
-    i = 0;
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        voice = &pcmvoices[i];
+        state = SDL_AtomicGet(&voice->state);
 
-    start = W_GetNumForName("DM_START") + 1;
-    end = W_GetNumForName("DM_END") - 1;
+        if (state == VOICE_START) {
+            voice->playdata = voice->data;
+            voice->playframes = voice->frames;
+            voice->pos = 0;
 
-    seq->nsongs = (end - start) + 1;
+            if (!SDL_AtomicCompareAndSwap(&voice->state, VOICE_START, VOICE_PLAYING)) {
+                continue;
+            }
+        }
+        else if (state != VOICE_PLAYING) {
+            continue;
+        }
 
-    //
-    // no midi songs found in iwad?
-    //
-    if (seq->nsongs <= 0) {
-        return false;
+        l = voice->left;
+        r = voice->right;
+        data = voice->playdata + (voice->pos << 1);
+        count = MIN(len, voice->playframes - voice->pos);
+
+        for (j = 0; j < count; j++) {
+            left[j] += (float)data[0] * l;
+            right[j] += (float)data[1] * r;
+            data += 2;
+        }
+
+        voice->pos += count;
+
+        if (voice->pos >= voice->playframes) {
+            SDL_AtomicCompareAndSwap(&voice->state, VOICE_PLAYING, VOICE_DONE);
+        }
+    }
+}
+
+//
+// Seq_AudioCallback
+//
+// Used instead of the default driver callback when
+// pre-rendered sounds are enabled
+//
+
+static int Seq_AudioCallback(void* data, int len, int nfx, float* fx[], int nout, float* out[]) {
+    doomseq_t* seq = (doomseq_t*)data;
+    int ret;
+
+    if (nfx == 0) {
+        float* fxb[4] = { out[0], out[1], out[0], out[1] };
+        ret = fluid_synth_process(seq->synth, len, 4, fxb, nout, out);
+    }
+    else {
+        ret = fluid_synth_process(seq->synth, len, nfx, fx, nout, out);
     }
 
-    seq->songs = (song_t*)Z_Calloc(seq->nsongs * sizeof(song_t), PU_STATIC, 0);
+    if (nout >= 2) {
+        Pcm_Mix(len, out[0], out[1]);
+    }
 
-    fail = 0;
-    for (i = 0; i < seq->nsongs; i++) {
-        song_t* song;
+    return ret;
+}
 
-        song = &seq->songs[i];
-        song->data = W_CacheLumpNum(start + i, PU_STATIC);
-        song->length = W_LumpLength(start + i);
+//
+// Pcm_Render
+//
+// Play a sound effect through a private synth and keep the
+// output. Runs on the worker thread, so sample data comes
+// from malloc and not the zone allocator
+//
+
+static void Pcm_Render(pcmcache_t* cache, fluid_synth_t* synth, int i) {
+    pcmsfx_t* pcm;
+    doomseq_t rseq;
+    channel_t chan;
+    song_t song;
+    track_t track;
+    short* data;
+    int frames;
+    int maxframes;
+    int msecs;
+    int endmsecs;
+    int quiet;
+    int peak;
+    int len;
+    int j;
+    uint64_t start;
+
+    pcm = &cache->sfx[i];
+    start = I_GetTimeUS();
+
+    fluid_synth_system_reset(synth);
+
+    dmemset(&rseq, 0, sizeof(doomseq_t));
+    rseq.synth = synth;
+    rseq.soundvolume = 127.0f;
+    rseq.musicvolume = 127.0f;
+
+    // work on copies; the sequencer writes to both while playing
+    song = doomseq.songs[i / PCM_DEPTHS];
+    track = song.tracks[0];
+
+    dmemset(&chan, 0, sizeof(channel_t));
+    Chan_Setup(&rseq, &chan, &song, &track, 0x0f);
+    chan.depth = (i % PCM_DEPTHS) << 4;
+
+    data = NULL;
+    frames = 0;
+    maxframes = 0;
+    endmsecs = 0;
+    quiet = 0;
+
+    for (msecs = 1; chan.song; msecs++) {
+        if (!endmsecs) {
+            if (msecs > PCM_MAXLENGTH) {
+                free(data);
+                SDL_AtomicSet(&pcm->state, PCM_STATE_UNCACHED);
+                return;
+            }
 
-        if (!song->length) {
-            continue;
+            Chan_RunSong(&rseq, &chan, msecs);
+
+            if (chan.state == CHAN_STATE_ENDED) {
+                endmsecs = msecs;
+            }
+        }
+        else if (quiet >= PCM_QUIETMSECS || msecs - endmsecs > PCM_MAXTAIL) {
+            // the synth keeps sounding after the sequence ends
+            break;
         }
 
-        dmemcpy(song, song->data, 0x0e);
-        if (dstrncmp(song->header, "MThd", 4)) {
-            fail++;
-            continue;
+        len = (int)(((int64_t)msecs * cache->samplerate) / 1000 -
+                    ((int64_t)(msecs - 1) * cache->samplerate) / 1000);
+
+        if (frames + len > maxframes) {
+            maxframes = MAX(maxframes * 2, cache->samplerate / 4);
+            data = (short*)realloc(data, maxframes * 2 * sizeof(short));
         }
 
-        song->chunksize = I_SwapBE32(song->chunksize);
-        song->ntracks = I_SwapBE16(song->ntracks);
-        song->delta = I_SwapBE16(song->delta);
-        song->type = I_SwapBE16(song->type);
-        song->timediv = Song_GetTimeDivision(song);
-        song->tempo = 480000;
+        fluid_synth_write_s16(synth, len, data, frames * 2, 2, data, frames * 2 + 1, 2);
 
-        if (!Song_RegisterTracks(song)) {
-            fail++;
-            continue;
+        if (endmsecs) {
+            peak = 0;
+            for (j = frames * 2; j < (frames + len) * 2; j++) {
+                peak = MAX(peak, abs(data[j]));
+            }
+
+            quiet = (peak < PCM_SILENCE) ? quiet + 1 : 0;
         }
+
+        frames += len;
     }
 
-    if (fail) {
-        I_Printf("Failed to load %d MIDI tracks.\n", fail);
+    if (!frames) {
+        free(data);
+        SDL_AtomicSet(&pcm->state, PCM_STATE_UNCACHED);
+        return;
     }
 
-    return true;
+    pcm->data = data;
+    pcm->frames = frames;
+
+    cache->rendered++;
+    cache->rendertime += I_GetTimeUS() - start;
+    cache->dirty = true;
+
+    // publish to the sequencer
+    SDL_AtomicSet(&pcm->state, PCM_STATE_READY);
 }
 
 //
-// Seq_Shutdown
+// Pcm_ComputeKey
+//
+// Cached sounds are only valid for the same soundfont,
+// sound data and output rate
 //
 
-static void Seq_Shutdown(doomseq_t* seq) {
-    //
-    // signal the sequencer to shut down
-    //
-    Seq_SetStatus(seq, SEQ_SIGNAL_SHUTDOWN);
-    //
-    // wait until the audio thread is finished
-    //
-    SDL_WaitThread(seq->thread, NULL);
+static void Pcm_ComputeKey(pcmcache_t* cache) {
+    md5_context_t md5;
+    FILE* fp;
+    byte* buf;
+    int len;
+    int i;
 
-    //
-    // fluidsynth cleanup stuff
-    //
+    MD5_Init(&md5);
+    MD5_UpdateInt32(&md5, PCM_VERSION);
+    MD5_UpdateInt32(&md5, cache->samplerate);
+
+    if ((fp = fopen(cache->sfpath, "rb"))) {
+        buf = (byte*)malloc(0x10000);
+
+        while ((len = (int)fread(buf, 1, 0x10000, fp)) > 0) {
+            MD5_Update(&md5, buf, len);
+        }
+
+        free(buf);
+        fclose(fp);
+    }
+
+    for (i = 0; i < doomseq.nsongs; i++) {
+        song_t* song = &doomseq.songs[i];
+
+        MD5_UpdateInt32(&md5, song->length);
+
+        if (song->length) {
+            MD5_Update(&md5, song->data, song->length);
+        }
+    }
+
+    MD5_Final(cache->key, &md5);
+}
+
+//
+// Pcm_LoadCache
+//
+
+static void Pcm_LoadCache(pcmcache_t* cache) {
+    char* path;
+    FILE* fp;
+    char id[8];
+    int version;
+    md5_digest_t key;
+    int count;
+    int i;
+    int frames;
+    short* data;
+    pcmsfx_t* pcm;
+
+    if (!(path = I_GetUserFile(PCM_CACHEFILE))) {
+        return;
+    }
+
+    fp = fopen(path, "rb");
+    free(path);
+
+    if (!fp) {
+        return;
+    }
+
+    if (fread(id, 1, 8, fp) != 8 || dstrncmp(id, "SFXCACHE", 8) ||
+        fread(&version, sizeof(int), 1, fp) != 1 || version != PCM_VERSION ||
+        fread(key, 1, sizeof(md5_digest_t), fp) != sizeof(md5_digest_t) ||
+        memcmp(key, cache->key, sizeof(md5_digest_t)) ||
+        fread(&count, sizeof(int), 1, fp) != 1) {
+        fclose(fp);
+        return;
+    }
+
+    while (count-- > 0) {
+        if (fread(&i, sizeof(int), 1, fp) != 1 ||
+            fread(&frames, sizeof(int), 1, fp) != 1 ||
+            i < 0 || i >= cache->numsfx || frames <= 0 ||
+            frames > cache->samplerate * (PCM_MAXLENGTH / 1000)) {
+            break;
+        }
+
+        data = (short*)malloc(frames * 2 * sizeof(short));
+
+        if (fread(data, sizeof(short) * 2, frames, fp) != (size_t)frames) {
+            free(data);
+            break;
+        }
+
+        pcm = &cache->sfx[i];
+
+        if (SDL_AtomicGet(&pcm->state) == PCM_STATE_READY) {
+            free(data);
+            continue;
+        }
+
+        pcm->data = data;
+        pcm->frames = frames;
+        SDL_AtomicSet(&pcm->state, PCM_STATE_READY);
+
+        cache->loaded++;
+    }
+
+    fclose(fp);
+}
+
+//
+// Pcm_SaveCache
+//
+
+static void Pcm_SaveCache(pcmcache_t* cache) {
+    char* path;
+    FILE* fp;
+    int version;
+    int count;
+    int i;
+
+    if (!(path = I_GetUserFile(PCM_CACHEFILE))) {
+        return;
+    }
+
+    fp = fopen(path, "wb");
+    free(path);
+
+    if (!fp) {
+        return;
+    }
+
+    count = 0;
+    for (i = 0; i < cache->numsfx; i++) {
+        if (SDL_AtomicGet(&cache->sfx[i].state) == PCM_STATE_READY) {
+            count++;
+        }
+    }
+
+    version = PCM_VERSION;
+
+    fwrite("SFXCACHE", 1, 8, fp);
+    fwrite(&version, sizeof(int), 1, fp);
+    fwrite(cache->key, 1, sizeof(md5_digest_t), fp);
+    fwrite(&count, sizeof(int), 1, fp);
+
+    for (i = 0; i < cache->numsfx; i++) {
+        pcmsfx_t* pcm = &cache->sfx[i];
+
+        if (SDL_AtomicGet(&pcm->state) != PCM_STATE_READY) {
+            continue;
+        }
+
+        fwrite(&i, sizeof(int), 1, fp);
+        fwrite(&pcm->frames, sizeof(int), 1, fp);
+        fwrite(pcm->data, sizeof(short) * 2, pcm->frames, fp);
+    }
+
+    fclose(fp);
+}
+
+//
+// Thread_RenderHandler
+//
+// Main routine of the sound rendering thread
+//
+
+static int SDLCALL Thread_RenderHandler(void* param) {
+    pcmcache_t* cache = (pcmcache_t*)param;
+    fluid_settings_t* settings;
+    fluid_synth_t* synth;
+    int tail;
+    int i;
+
+    settings = new_fluid_settings();
+    fluid_settings_setnum(settings, "synth.sample-rate", (double)cache->samplerate);
+    fluid_settings_setint(settings, "synth.polyphony", 128);
+
+    synth = new_fluid_synth(settings);
+
+    if (synth == NULL || fluid_synth_sfload(synth, cache->sfpath, 1) == -1) {
+        if (synth) {
+            delete_fluid_synth(synth);
+        }
+
+        delete_fluid_settings(settings);
+        return 0;
+    }
+
+    fluid_synth_set_gain(synth, PCM_RENDERGAIN);
+    fluid_synth_set_interp_method(synth, -1, FLUID_INTERP_LINEAR);
+
+    Pcm_ComputeKey(cache);
+    Pcm_LoadCache(cache);
+
+    while (1) {
+        SDL_WaitSemaphore(cache->wake);
+
+        if (SDL_AtomicGet(&cache->quit)) {
+            break;
+        }
+
+        tail = SDL_AtomicGet(&cache->queuetail);
+
+        while (tail != SDL_AtomicGet(&cache->queuehead)) {
+            i = cache->queue[tail & (PCM_QUEUESIZE - 1)];
+            SDL_AtomicSet(&cache->queuetail, ++tail);
+
+            if (SDL_AtomicGet(&cache->sfx[i].state) == PCM_STATE_QUEUED) {
+                Pcm_Render(cache, synth, i);
+            }
+
+            if (SDL_AtomicGet(&cache->quit)) {
+                break;
+            }
+        }
+    }
+
+    delete_fluid_synth(synth);
+    delete_fluid_settings(settings);
+
+    return 1;
+}
+
+//
+// Pcm_Init
+//
+
+static void Pcm_Init(doomseq_t* seq, char* sfpath) {
+    double rate;
+
+    dmemset(&pcmcache, 0, sizeof(pcmcache_t));
+
+    if (fluid_settings_getnum(seq->settings, "synth.sample-rate", &rate) != FLUID_OK) {
+        rate = 44100.0;
+    }
+
+    pcmcache.samplerate = (int)rate;
+    pcmcache.sfpath = sfpath;
+    pcmcache.numsfx = seq->nsongs * PCM_DEPTHS;
+    pcmcache.sfx = (pcmsfx_t*)Z_Calloc(pcmcache.numsfx * sizeof(pcmsfx_t), PU_STATIC, 0);
+
+    pcmcache.wake = SDL_CreateSemaphore(0);
+    if (pcmcache.wake == NULL) {
+        CON_Warnf("Pcm_Init: failed to create semaphore\n");
+        Z_Free(pcmcache.sfx);
+        free(pcmcache.sfpath);
+        pcmcache.sfx = NULL;
+        return;
+    }
+
+    pcmcache.thread = SDL_CreateThread(Thread_RenderHandler, "SfxRender", &pcmcache);
+    if (pcmcache.thread == NULL) {
+        CON_Warnf("Pcm_Init: failed to create render thread\n");
+        SDL_DestroySemaphore(pcmcache.wake);
+        Z_Free(pcmcache.sfx);
+        free(pcmcache.sfpath);
+        pcmcache.sfx = NULL;
+        return;
+    }
+}
+
+//
+// Pcm_Shutdown
+//
+
+static void Pcm_Shutdown(void) {
+    int i;
+
+    if (!pcmcache.thread) {
+        return;
+    }
+
+    SDL_AtomicSet(&pcmcache.quit, 1);
+    SDL_PostSemaphore(pcmcache.wake);
+    SDL_WaitThread(pcmcache.thread, NULL);
+    SDL_DestroySemaphore(pcmcache.wake);
+
+    pcmcache.thread = NULL;
+
+    if (pcmcache.dirty) {
+        Pcm_SaveCache(&pcmcache);
+    }
+
+    for (i = 0; i < pcmcache.numsfx; i++) {
+        free(pcmcache.sfx[i].data);
+    }
+
+    free(pcmcache.sfpath);
+    Z_Free(pcmcache.sfx);
+    pcmcache.sfx = NULL;
+}
+
+//
+// Seq_RunCommand
+//
+// Executes a command queued by the game code
+//
+
+static void Seq_RunCommand(doomseq_t* seq, sndcmd_t* cmd) {
+    song_t* song;
+    channel_t* chan;
+    pcmsfx_t* pcm;
+    int i;
+
+    switch (cmd->type) {
+    case SNDCMD_STARTSOUND:
+        song = &seq->songs[cmd->id];
+        chan = Song_AddTrackToPlaylist(seq, cmd->channel, song, &song->tracks[cmd->track]);
+
+        chan->volume = (float)cmd->volume;
+        chan->pan = (byte)(cmd->pan >> 1);
+        chan->depth = cmd->depth;
+
+        if ((pcm = Pcm_GetSfx(seq, cmd->id, cmd->track, cmd->depth))) {
+            Chan_StartPCM(seq, chan, pcm);
+            break;
+        }
+
+        // [Immorpher] Re-establish linear sound interpolation
+        fluid_synth_set_interp_method(seq->synth, chan->id, FLUID_INTERP_LINEAR);
+        break;
+
+    case SNDCMD_STARTMUSIC:
+        song = &seq->songs[cmd->id];
+        chan = Song_AddTrackToPlaylist(seq, cmd->channel, song, &song->tracks[cmd->track]);
+
+        chan->volume = seq->musicvolume;
+
+        // [Immorpher] Re-establish linear sound interpolation
+        if (cmd->track == 0) {
+            for (i = 0; i < 15; i++) {
+                fluid_synth_set_interp_method(seq->synth, i, FLUID_INTERP_LINEAR);
+            }
+        }
+        break;
+
+    case SNDCMD_STOPSOUND:
+        song = &seq->songs[cmd->id];
+        for (i = 0; i < MIDI_CHANNELS; i++) {
+            chan = &playlist[i];
+
+            if (!chan->song) {
+                continue;
+            }
+
+            if (song == chan->song ||
+                (cmd->origin && SDL_AtomicGetPtr((void**)&chan->origin) == cmd->origin)) {
+                chan->stop = true;
+            }
+        }
+        break;
+
+    case SNDCMD_UPDATE:
+        chan = &playlist[cmd->channel];
+
+        if (chan->song) {
+            chan->basevol = (float)cmd->volume;
+            chan->pan = (byte)(cmd->pan >> 1);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+//
+// Seq_RunCommands
+//
+// Drain the sound queue. Only ever called by the audio thread
+//
+
+static void Seq_RunCommands(doomseq_t* seq) {
+    int head;
+    int tail;
+    int latency;
+    uint64_t now;
+
+    head = SDL_AtomicGet(&sndhead);
+    tail = SDL_AtomicGet(&sndtail);
+
+    if (head == tail) {
+        return;
+    }
+
+    now = I_GetTimeUS();
+
+    while (tail != head) {
+        sndcmd_t* cmd = &sndqueue[tail & (SNDQUEUESIZE - 1)];
+
+        latency = (int)(now - MIN(now, cmd->time));
+        sndstats.totallatency += latency;
+        sndstats.maxlatency = MAX(sndstats.maxlatency, latency);
+        sndstats.drained++;
+
+        Seq_RunCommand(seq, cmd);
+        tail++;
+    }
+
+    // release the slots back to the game code
+    SDL_AtomicSet(&sndtail, tail);
+}
+
+//
+// Chan_GetNextEvent
+//
+// Returns when the channel next needs to be run or -1 if
+// it's waiting on nothing
+//
+
+static int Chan_GetNextEvent(channel_t* chan, int msecs) {
+    if (!chan->song) {
+        return -1;
+    }
+
+    if (chan->pcm) {
+        return msecs + SEQ_PCMPOLL;
+    }
+
+    if (chan->state != CHAN_STATE_READY || chan->starttime == 0) {
+        return (chan->state == CHAN_STATE_ENDED) ? -1 : msecs + 1;
+    }
+
+    return chan->starttime + chan->nexttic;
+}
+
+//
+// Seq_RunSong
+//
+// Returns the time of the next pending event or -1 if
+// there's nothing to play
+//
+
+static int Seq_RunSong(doomseq_t* seq, int msecs) {
+    int i;
+    int next;
+    int event;
+    channel_t* chan;
+
+    seq->playtime = msecs;
+    sndstats.passes++;
+
+    Seq_RunCommands(seq);
+
+    next = -1;
+
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        chan = &playlist[i];
+
+        if (!chan->song) {
+            continue;
+        }
+
+        if (chan->stop) {
+            Chan_RemoveTrackFromPlaylist(seq, chan);
+        }
+        else if (chan->pcm) {
+            Chan_RunPCM(seq, chan);
+        }
+        else {
+            Chan_RunSong(seq, chan, msecs);
+        }
+
+        event = Chan_GetNextEvent(chan, msecs);
+
+        if (event != -1 && (next == -1 || event < next)) {
+            next = event;
+        }
+    }
+
+    return next;
+}
+
+//
+// Seq_Sleep
+//
+// Sleep until the next event is due or until the game
+// code queues something
+//
+
+static void Seq_Sleep(int timeout) {
+    SDL_AtomicSet(&seqsleeping, 1);
+
+    // make sure nothing was queued since the last pass
+    if (SDL_AtomicGet(&sndhead) == SDL_AtomicGet(&sndtail)) {
+        SDL_WaitSemaphoreTimeout(seqwake, timeout);
+    }
+
+    SDL_AtomicSet(&seqsleeping, 0);
+}
+
+//
+// Song_RegisterTracks
+//
+// Allocate data for all tracks for a midi song
+//
+
+static int Song_RegisterTracks(song_t* song) {
+    int i;
+    byte* data;
+
+    song->tracks = (track_t*)Z_Calloc(sizeof(track_t) * song->ntracks, PU_STATIC, 0);
+    data = song->data + 0x0e;
+
+    for (i = 0; i < song->ntracks; i++) {
+        track_t* track = &song->tracks[i];
+
+        dmemcpy(track, data, 8);
+        if (dstrncmp(track->header, "MTrk", 4)) {
+            return false;
+        }
+
+        data = data + 8;
+
+        track->length = I_SwapBE32(track->length);
+        track->data = data;
+
+        data = data + track->length;
+    }
+
+    return true;
+}
+
+//
+// Seq_RegisterSongs
+//
+// Allocate data for all midi songs
+//
+
+static int Seq_RegisterSongs(doomseq_t* seq) {
+    int i;
+    int start;
+    int end;
+    int fail;
+
+    seq->nsongs = 0;
+    i = 0;
+
+    start = W_GetNumForName("DM_START") + 1;
+    end = W_GetNumForName("DM_END") - 1;
+
+    seq->nsongs = (end - start) + 1;
+
+    //
+    // no midi songs found in iwad?
+    //
+    if (seq->nsongs <= 0) {
+        return false;
+    }
+
+    seq->songs = (song_t*)Z_Calloc(seq->nsongs * sizeof(song_t), PU_STATIC, 0);
+
+    fail = 0;
+    for (i = 0; i < seq->nsongs; i++) {
+        song_t* song;
+
+        song = &seq->songs[i];
+        song->data = W_CacheLumpNum(start + i, PU_STATIC);
+        song->length = W_LumpLength(start + i);
+
+        if (!song->length) {
+            continue;
+        }
+
+        dmemcpy(song, song->data, 0x0e);
+        if (dstrncmp(song->header, "MThd", 4)) {
+            fail++;
+            continue;
+        }
+
+        song->chunksize = I_SwapBE32(song->chunksize);
+        song->ntracks = I_SwapBE16(song->ntracks);
+        song->delta = I_SwapBE16(song->delta);
+        song->type = I_SwapBE16(song->type);
+        song->timediv = Song_GetTimeDivision(song);
+        song->tempo = 480000;
+
+        if (!Song_RegisterTracks(song)) {
+            fail++;
+            continue;
+        }
+    }
+
+    if (fail) {
+        I_Printf("Failed to load %d MIDI tracks.\n", fail);
+    }
+
+    return true;
+}
+
+//
+// Seq_Shutdown
+//
+
+static void Seq_Shutdown(doomseq_t* seq) {
+    //
+    // signal the sequencer to shut down
+    //
+    Seq_SetStatus(seq, SEQ_SIGNAL_SHUTDOWN);
+    //
+    // wait until the audio thread is finished
+    //
+    SDL_WaitThread(seq->thread, NULL);
+
+    Pcm_Shutdown();
+
+    //
+    // fluidsynth cleanup stuff
+    //
     delete_fluid_audio_driver(seq->driver);
     delete_fluid_synth(seq->synth);
     delete_fluid_settings(seq->settings);
@@ -1122,6 +2052,8 @@ static int SDLCALL Thread_PlayerHandler(void* param) {
     long long delay = 0;
     int status;
     long long count = 0;
+    long long now;
+    int next;
     signalhandler signal;
 
     while (1) {
@@ -1148,9 +2080,26 @@ static int SDLCALL Thread_PlayerHandler(void* param) {
         //
         // play some songs
         //
-        Seq_RunSong(seq, SDL_GetTicks() - start);
+        next = Seq_RunSong(seq, SDL_GetTicks() - start);
         count++;
 
+        //
+        // sleep until something needs to be done instead
+        // of waking up every millisecond
+        //
+        if (s_scheduler.value && seqwake) {
+            now = SDL_GetTicks() - start;
+            delay = (next == -1) ? SEQ_MAXSLEEP : MIN(next - now, SEQ_MAXSLEEP);
+
+            if (delay > 0 && seq->signal == SEQ_SIGNAL_READY) {
+                Seq_Sleep((int)delay);
+            }
+
+            // keep the polling clock in step in case the mode changes
+            count = SDL_GetTicks() - start;
+            continue;
+        }
+
         // try to avoid incremental time de-syncs
         delay = count - (SDL_GetTicks() - start);
 
@@ -1162,6 +2111,165 @@ static int SDLCALL Thread_PlayerHandler(void* param) {
     return 0;
 }
 
+//
+// I_ClaimChannel
+//
+// Reserve a free channel for a sound that's about to be
+// queued. Only the game code claims channels and only the
+// audio thread releases them, so no locking is needed
+//
+
+static int I_ClaimChannel(sndsrc_t* origin) {
+    int i;
+
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        if (SDL_AtomicGet(&chanused[i]) == 0) {
+            SDL_AtomicSet(&chanused[i], 1);
+            SDL_AtomicSetPtr((void**)&playlist[i].origin, origin);
+            return i;
+        }
+    }
+
+    sndstats.nochannel++;
+    return -1;
+}
+
+//
+// I_ReleaseChannel
+//
+// Give back a claimed channel that never made it into the queue
+//
+
+static void I_ReleaseChannel(int c) {
+    SDL_AtomicSetPtr((void**)&playlist[c].origin, NULL);
+    SDL_AtomicSet(&chanused[c], 0);
+}
+
+//
+// I_PushSoundCommand
+//
+// Queue a command for the audio thread. Never blocks;
+// returns false if the queue is full
+//
+
+static boolean I_PushSoundCommand(sndcmd_t* cmd) {
+    int head;
+    int depth;
+    uint64_t start;
+
+    start = I_GetTimeUS();
+
+    head = SDL_AtomicGet(&sndhead);
+    depth = head - SDL_AtomicGet(&sndtail);
+
+    if (depth >= SNDQUEUESIZE) {
+        sndstats.dropped++;
+        return false;
+    }
+
+    cmd->time = start;
+    sndqueue[head & (SNDQUEUESIZE - 1)] = *cmd;
+
+    // publish the command to the audio thread
+    SDL_AtomicSet(&sndhead, head + 1);
+    Seq_Wake();
+
+    sndstats.pushed++;
+    sndstats.maxdepth = MAX(sndstats.maxdepth, depth + 1);
+    sndstats.maxpushtime = MAX(sndstats.maxpushtime, (int)(I_GetTimeUS() - start));
+
+    return true;
+}
+
+//
+// I_StartTracks
+//
+// Claim a channel and queue a start command for each track of a song
+//
+
+static void I_StartTracks(sndcmd_e type, int id, sndsrc_t* origin, int volume, int pan, int reverb) {
+    song_t* song;
+    sndcmd_t cmd;
+    int i;
+
+    song = &doomseq.songs[id];
+
+    for (i = 0; i < song->ntracks; i++) {
+        cmd.type = type;
+        cmd.channel = I_ClaimChannel(origin);
+
+        if (cmd.channel == -1) {
+            break;
+        }
+
+        cmd.id = id;
+        cmd.track = i;
+        cmd.origin = origin;
+        cmd.volume = volume;
+        cmd.pan = pan;
+        cmd.depth = reverb;
+
+        if (!I_PushSoundCommand(&cmd)) {
+            I_ReleaseChannel(cmd.channel);
+            break;
+        }
+    }
+}
+
+//
+// CMD_SoundStats
+//
+
+static CMD(SoundStats) {
+    int drained;
+    int ready;
+    int playing;
+    int i;
+
+    if (param[0] && !dstricmp(param[0], "reset")) {
+        dmemset(&sndstats, 0, sizeof(sndqueuestats_t));
+        sndstats.resettime = I_GetTimeUS();
+        return;
+    }
+
+    drained = MAX(sndstats.drained, 1);
+
+    CON_Printf(WHITE, "Sound queue: %i pushed, %i drained, %i pending\n",
+        sndstats.pushed, sndstats.drained,
+        SDL_AtomicGet(&sndhead) - SDL_AtomicGet(&sndtail));
+    CON_Printf(sndstats.dropped ? YELLOW : WHITE, "Queue full: %i, No free channel: %i, Max depth: %i/%i\n",
+        sndstats.dropped, sndstats.nochannel, sndstats.maxdepth, SNDQUEUESIZE);
+    CON_Printf(WHITE, "Max push time: %ius\n", sndstats.maxpushtime);
+    CON_Printf(WHITE, "Sequencer passes: %i (%i per second, %s)\n", sndstats.passes,
+        (int)((uint64_t)sndstats.passes * 1000000 / MAX(I_GetTimeUS() - sndstats.resettime, 1)),
+        s_scheduler.value ? "sleeping until next event" : "polling");
+    CON_Printf(WHITE, "Latency: %ius avg, %ius max\n",
+        (int)(sndstats.totallatency / drained), sndstats.maxlatency);
+
+    if (!pcmcache.sfx) {
+        return;
+    }
+
+    ready = 0;
+    for (i = 0; i < pcmcache.numsfx; i++) {
+        if (SDL_AtomicGet(&pcmcache.sfx[i].state) == PCM_STATE_READY) {
+            ready++;
+        }
+    }
+
+    playing = 0;
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        if (SDL_AtomicGet(&pcmvoices[i].state) == VOICE_PLAYING) {
+            playing++;
+        }
+    }
+
+    CON_Printf(WHITE, "PCM cache: %i ready, %i loaded, %i rendered in %ims\n",
+        ready, pcmcache.loaded, pcmcache.rendered, (int)(pcmcache.rendertime / 1000));
+    CON_Printf(WHITE, "PCM voices: %i, Synth voices: %i\n",
+        playing, fluid_synth_get_active_voice_count(doomseq.synth));
+}
+
 //
 // I_InitSequencer
 //
@@ -1169,6 +2277,7 @@ static int SDLCALL Thread_PlayerHandler(void* param) {
 void I_InitSequencer(void) {
     int   sffound;
     char* sfpath;
+    char* sfname = NULL;
 
     CON_DPrintf("--------Initializing Software Synthesizer--------\n");
 
@@ -1182,12 +2291,12 @@ void I_InitSequencer(void) {
     }
 
     //
-    // init semaphore
+    // init wake-up semaphore. without it the
+    // sequencer just keeps polling
     //
-    semaphore = SDL_CreateSemaphore(1);
-    if (semaphore == NULL) {
+    seqwake = SDL_CreateSemaphore(0);
+    if (seqwake == NULL) {
         CON_Warnf("I_InitSequencer: failed to create semaphore");
-        return;
     }
 
     dmemset(&doomseq, 0, sizeof(doomseq_t));
@@ -1235,7 +2344,13 @@ void I_InitSequencer(void) {
     //
     // init audio driver
     //
-    doomseq.driver = new_fluid_audio_driver(doomseq.settings, doomseq.synth);
+    if (s_pcmcache.value) {
+        doomseq.driver = new_fluid_audio_driver2(doomseq.settings, Seq_AudioCallback, &doomseq);
+    }
+    else {
+        doomseq.driver = new_fluid_audio_driver(doomseq.settings, doomseq.synth);
+    }
+
     if (doomseq.driver == NULL) {
         CON_Warnf("I_InitSequencer: failed to create audio driver");
         return;
@@ -1253,6 +2368,7 @@ void I_InitSequencer(void) {
 
             CON_DPrintf("Loading %s\n", s_soundfont.string);
 
+            sfname = M_StringDuplicate((char*)s_soundfont.string);
             sffound = true;
         }
         else {
@@ -1266,7 +2382,7 @@ void I_InitSequencer(void) {
 
         CON_DPrintf("Loading %s\n", sfpath);
 
-        free(sfpath);
+        sfname = sfpath;
         sffound = true;
     }
 
@@ -1284,6 +2400,7 @@ void I_InitSequencer(void) {
     if (!Seq_RegisterSongs(&doomseq)) {
         CON_Warnf("I_InitSequencer: Failed to register songs\n");
         Seq_Shutdown(&doomseq);
+        free(sfname);
         return;
     }
 
@@ -1293,11 +2410,25 @@ void I_InitSequencer(void) {
     if (doomseq.sfont_id == -1) {
         CON_Warnf("I_InitSequencer: Failed to find soundfont file\n");
         Seq_Shutdown(&doomseq);
+        free(sfname);
         return;
     }
 
     Song_ClearPlaylist();
 
+    //
+    // start rendering sound effects in the background
+    //
+    if (s_pcmcache.value && doomseq.driver) {
+        Pcm_Init(&doomseq, sfname);
+    }
+    else {
+        free(sfname);
+    }
+
+    sndstats.resettime = I_GetTimeUS();
+    G_AddCommand("soundstats", CMD_SoundStats, 0);
+
     // 20120205 villsa - sequencer is now ready
     seqready = true;
 }
@@ -1323,11 +2454,7 @@ int I_GetVoiceCount(void) {
 //
 
 sndsrc_t* I_GetSoundSource(int c) {
-    if (playlist[c].song == NULL) {
-        return NULL;
-    }
-
-    return playlist[c].origin;
+    return (sndsrc_t*)SDL_AtomicGetPtr((void**)&playlist[c].origin);
 }
 
 //
@@ -1335,7 +2462,7 @@ sndsrc_t* I_GetSoundSource(int c) {
 //
 
 void I_RemoveSoundSource(int c) {
-    playlist[c].origin = NULL;
+    SDL_AtomicSetPtr((void**)&playlist[c].origin, NULL);
 }
 
 //
@@ -1343,11 +2470,14 @@ void I_RemoveSoundSource(int c) {
 //
 
 void I_UpdateChannel(int c, int volume, int pan) {
-    channel_t* chan;
+    sndcmd_t cmd;
 
-    chan = &playlist[c];
-    chan->basevol = (float)volume;
-    chan->pan = (byte)(pan >> 1);
+    cmd.type = SNDCMD_UPDATE;
+    cmd.channel = c;
+    cmd.volume = volume;
+    cmd.pan = pan;
+
+    I_PushSoundCommand(&cmd);
 }
 
 //
@@ -1366,6 +2496,7 @@ void I_ShutdownSound(void) {
 
 void I_SetMusicVolume(float volume) {
     doomseq.musicvolume = (volume * 1.125f);
+    Seq_Wake();
 }
 
 //
@@ -1374,6 +2505,7 @@ void I_SetMusicVolume(float volume) {
 
 void I_SetSoundVolume(float volume) {
     doomseq.soundvolume = (volume * 0.925f);
+    Seq_Wake();
 }
 
 //
@@ -1437,31 +2569,11 @@ void I_SetGain(float db) {
 //
 
 void I_StartMusic(int mus_id) {
-    song_t* song;
-    channel_t* chan;
-    int i;
-
     if (!seqready) {
         return;
     }
 
-    SEMAPHORE_LOCK()
-        song = &doomseq.songs[mus_id];
-    for (i = 0; i < song->ntracks; i++) {
-        chan = Song_AddTrackToPlaylist(&doomseq, song, &song->tracks[i]);
-
-        if (chan == NULL) {
-            break;
-        }
-
-        chan->volume = doomseq.musicvolume;
-    }
-    SEMAPHORE_UNLOCK()
-
-        // [Immorpher] Re-establish linear sound interpolation
-        for (i = 0; i < 15; i++) {
-            fluid_synth_set_interp_method(doomseq.synth, i, FLUID_INTERP_LINEAR);
-        }
+    I_StartTracks(SNDCMD_STARTMUSIC, mus_id, NULL, 0, 0, 0);
 }
 
 //
@@ -1469,24 +2581,17 @@ void I_StartMusic(int mus_id) {
 //
 
 void I_StopSound(sndsrc_t* origin, int sfx_id) {
-    song_t* song;
-    channel_t* c;
-    int i;
+    sndcmd_t cmd;
 
     if (!seqready) {
         return;
     }
 
-    SEMAPHORE_LOCK()
-        song = &doomseq.songs[sfx_id];
-    for (i = 0; i < MIDI_CHANNELS; i++) {
-        c = &playlist[i];
+    cmd.type = SNDCMD_STOPSOUND;
+    cmd.id = sfx_id;
+    cmd.origin = origin;
 
-        if (song == c->song || (origin && c->origin == origin)) {
-            c->stop = true;
-        }
-    }
-    SEMAPHORE_UNLOCK()
+    I_PushSoundCommand(&cmd);
 }
 
 //
@@ -1494,10 +2599,6 @@ void I_StopSound(sndsrc_t* origin, int sfx_id) {
 //
 
 void I_StartSound(int sfx_id, sndsrc_t* origin, int volume, int pan, int reverb) {
-    song_t* song;
-    channel_t* chan;
-    int i;
-
     if (!seqready) {
         return;
     }
@@ -1506,24 +2607,5 @@ void I_StartSound(int sfx_id, sndsrc_t* origin, int volume, int pan, int reverb)
         return;
     }
 
-    SEMAPHORE_LOCK()
-        song = &doomseq.songs[sfx_id];
-    for (i = 0; i < song->ntracks; i++) {
-        chan = Song_AddTrackToPlaylist(&doomseq, song, &song->tracks[i]);
-
-        if (chan == NULL) {
-            break;
-        }
-
-        chan->volume = (float)volume;
-        chan->pan = (byte)(pan >> 1);
-        chan->origin = origin;
-        chan->depth = reverb;
-    }
-    SEMAPHORE_UNLOCK()
-
-        // [Immorpher] Re-establish linear sound interpolation
-        for (i = 16; i < MIDI_CHANNELS + 15; i++) {
-            fluid_synth_set_interp_method(doomseq.synth, i, FLUID_INTERP_LINEAR);
-        }
-}
\ No newline at end of file
+    I_StartTracks(SNDCMD_STARTSOUND, sfx_id, origin, volume, pan, reverb);
+}
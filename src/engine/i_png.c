@@ -42,6 +42,15 @@ static byte* pngWriteData;
 static byte* pngReadData;
 static unsigned int   pngWritePos = 0;
 
+// scratch space reused between decodes
+static byte** pngRowPool;
+static unsigned int   pngRowPoolSize = 0;
+static byte* pngPixelPool;
+static unsigned int   pngPixelPoolSize = 0;
+
+static byte gammatable[256];
+static float gammatablevalue = -1;
+
 CVAR_CMD(i_gamma, 0) {
 	GL_DumpTextures();
 }
@@ -98,22 +107,36 @@ d_inline static byte I_GetRGBGamma(int c) {
 // Increases the palette RGB based on gamma settings
 //
 
-static void I_TranslatePalette(png_colorp dest) {
+static void I_TranslatePalette(png_colorp dest, int num_pal) {
 	int i = 0;
 
-	for (i = 0; i < 256; i++) {
-		dest[i].red = I_GetRGBGamma(dest[i].red);
-		dest[i].green = I_GetRGBGamma(dest[i].green);
-		dest[i].blue = I_GetRGBGamma(dest[i].blue);
+	// only recompute the curve when the gamma changes
+	if (gammatablevalue != i_gamma.value) {
+		for (i = 0; i < 256; i++) {
+			gammatable[i] = I_GetRGBGamma(i);
+		}
+
+		gammatablevalue = i_gamma.value;
+	}
+
+	for (i = 0; i < num_pal; i++) {
+		dest[i].red = gammatable[dest[i].red];
+		dest[i].green = gammatable[dest[i].green];
+		dest[i].blue = gammatable[dest[i].blue];
 	}
 }
 
 //
-// I_PNGReadData
+// I_PNGDecode
+//
+// RGBA output comes straight out of libpng in the byte order
+// GL wants, with the alpha filled in after the colour. If pooled
+// is set the pixels go into a scratch buffer that's reused by
+// the next pooled decode instead of a new zone block
 //
 
-byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
-	int* w, int* h, int* offset, int palindex) {
+static byte* I_PNGDecode(int lump, int palette, int nopack, int alpha,
+	int* w, int* h, int* offset, int palindex, boolean pooled) {
 	png_structp png_ptr;
 	png_infop   info_ptr;
 	png_uint_32 width;
@@ -121,7 +144,6 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 	int         bit_depth;
 	int         color_type;
 	int         interlace_type;
-	int         pixel_depth;
 	byte* png;
 	byte* out;
 	unsigned int      row;
@@ -221,6 +243,7 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 				}
 				else if (bit_depth >= 8) {  // 8 bit and up requires an external palette lump
 					png_colorp pallump;
+					int pallumpnum;
 					char palname[9];
 
 					sprintf(palname, "PAL");
@@ -228,8 +251,8 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 					sprintf(palname + 7, "%i", palindex);
 
 					// villsa 12/04/13: don't abort if external palette is not found
-					if (W_CheckNumForName(palname) != -1) {
-						pallump = W_CacheLumpName(palname, PU_STATIC);
+					if ((pallumpnum = W_CheckNumForName(palname)) != -1) {
+						pallump = W_CacheLumpNum(pallumpnum, PU_STATIC);
 
 						// swap out current palette with the new one
 						for (i = 0; i < 256; i++) {
@@ -238,7 +261,7 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 							pal[i].blue = pallump[i].blue;
 						}
 
-						Z_Free(pallump);
+						W_ReleaseLumpNum(pallumpnum);
 					}
 					// villsa 12/04/13: if we're loading texture palette as normal
 					// but palindex is not zero, then just copy out a single row from the
@@ -251,14 +274,13 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 				}
 			}
 
-			I_TranslatePalette(pal);
+			I_TranslatePalette(pal, MIN(num_pal, 256));
 			png_set_palette_to_rgb(png_ptr);
 		}
 
 		if (alpha) {
-			// add alpha values to the RGB data
-			png_set_swap_alpha(png_ptr);
-			png_set_add_alpha(png_ptr, 0xff, 0);
+			// add alpha values to the RGB data, giving RGBA
+			png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
 		}
 	}
 
@@ -278,16 +300,7 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 		NULL);
 
 	// get the size of each row
-	pixel_depth = bit_depth;
-
-	if (color_type == PNG_COLOR_TYPE_RGB) {
-		pixel_depth *= 3;
-	}
-	else if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
-		pixel_depth *= 4;
-	}
-
-	rowSize = I_PNGRowSize(width, pixel_depth /*info_ptr->pixel_depth*/);
+	rowSize = (unsigned int)png_get_rowbytes(png_ptr, info_ptr);
 
 	if (w) {
 		*w = width;
@@ -296,9 +309,34 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 		*h = height;
 	}
 
-	// allocate output and row pointers
-	out = (byte*)Z_Calloc(rowSize * height, PU_STATIC, 0);
-	row_pointers = (byte**)Z_Malloc(sizeof(byte*) * height, PU_STATIC, 0);
+	// allocate output
+	if (pooled) {
+		if (rowSize * height > pngPixelPoolSize) {
+			if (pngPixelPool) {
+				Z_Free(pngPixelPool);
+			}
+
+			pngPixelPoolSize = rowSize * height;
+			pngPixelPool = (byte*)Z_Malloc(pngPixelPoolSize, PU_STATIC, 0);
+		}
+
+		out = pngPixelPool;
+	}
+	else {
+		out = (byte*)Z_Malloc(rowSize * height, PU_STATIC, 0);
+	}
+
+	// row pointers are always scratch
+	if (height > pngRowPoolSize) {
+		if (pngRowPool) {
+			Z_Free(pngRowPool);
+		}
+
+		pngRowPoolSize = height;
+		pngRowPool = (byte**)Z_Malloc(sizeof(byte*) * height, PU_STATIC, 0);
+	}
+
+	row_pointers = pngRowPool;
 
 	for (row = 0; row < height; row++) {
 		row_pointers[row] = out + (row * rowSize);
@@ -307,31 +345,32 @@ byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 	png_read_image(png_ptr, row_pointers);
 	png_read_end(png_ptr, info_ptr);
 
-	if (alpha) {
-		unsigned int i;
-		int* check = (int*)out;
-
-		// need to reverse the bytes to ABGR format
-		for (i = 0; i < (height * rowSize) / 4; i++) {
-			int c = *check;
+	//cleanup
+	W_ReleaseLumpNum(lump);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
-			byte b = (byte)((c >> 24) & 0xff);
-			byte g = (byte)((c >> 16) & 0xff);
-			byte r = (byte)((c >> 8) & 0xff);
-			byte a = (byte)(c & 0xff);
+	return out;
+}
 
-			*check = ((a << 24) | (b << 16) | (g << 8) | r);
+//
+// I_PNGReadData
+// Returns a new zone block the caller frees
+//
 
-			check++;
-		}
-	}
+byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
+	int* w, int* h, int* offset, int palindex) {
+	return I_PNGDecode(lump, palette, nopack, alpha, w, h, offset, palindex, false);
+}
 
-	//cleanup
-	Z_Free(row_pointers);
-	Z_Free(png);
-	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+//
+// I_PNGReadDataTemp
+// Same as I_PNGReadData, but the data is only good until the
+// next call. For decodes that are uploaded straight away
+//
 
-	return out;
+byte* I_PNGReadDataTemp(int lump, int palette, int nopack, int alpha,
+	int* w, int* h, int* offset, int palindex) {
+	return I_PNGDecode(lump, palette, nopack, alpha, w, h, offset, palindex, true);
 }
 
 //
@@ -28,6 +28,8 @@
 
 byte* I_PNGReadData(int lump, int palette, int nopack, int alpha,
 	int* w, int* h, int* offset, int palindex);
+byte* I_PNGReadDataTemp(int lump, int palette, int nopack, int alpha,
+	int* w, int* h, int* offset, int palindex);
 
 byte* I_PNGCreate(int width, int height, byte* data, int* size);
 
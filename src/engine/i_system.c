@@ -59,6 +59,7 @@
 #include "z_zone.h"
 #include "i_system.h"
 #include "gl_draw.h"
+#include "r_drawlist.h"
 
 #ifdef __APPLE__
 #include "i_mac_audio.h"
@@ -233,6 +234,16 @@ int I_GetTimeMS(void) {
 	return ticks - basetime;
 }
 
+//
+// I_GetTimeUS
+//
+// High resolution clock in microseconds, used for profiling
+//
+
+uint64_t I_GetTimeUS(void) {
+	return SDL_GetTicksNS() / 1000;
+}
+
 //
 // I_GetTime_SaveMS
 //
@@ -437,6 +448,7 @@ void I_Quit(void) {
 	}
 	M_SaveDefaults();
 	I_ShutdownSound();
+	DL_Shutdown();
 	I_ShutdownVideo();
 
 	exit(0);
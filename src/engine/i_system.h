@@ -45,6 +45,7 @@ extern fixed_t rendertic_frac;
 extern int (*I_GetTime)(void);
 void            I_InitClockRate(void);
 int             I_GetTimeMS(void);
+uint64_t        I_GetTimeUS(void);
 void            I_Sleep(unsigned long usecs);
 boolean        I_StartDisplay(void);
 void            I_EndDisplay(void);
@@ -199,6 +199,8 @@ int IN_Ticker(void) {
 	int   i;
 	player_t* player;
 
+	P_PrefetchLevel(nextmap);
+
 	// Fade out for finale after all of text has scrolled up towards the screen
 	if (fInterFadeOut) {
 		// text hasn't scrolled off screen yet
@@ -69,6 +69,7 @@
 #include "p_setup.h"
 #include "gl_texture.h"
 #include "gl_draw.h"
+#include "gl_batch.h"
 
 #ifdef _WIN32
 #include "i_xinput.h"
@@ -3981,6 +3982,9 @@ static boolean M_SetThumbnail(int which) {
 //
 
 static void M_DrawSaveGameFrontend(menu_t* def) {
+	// the panels are drawn straight away, over anything batched
+	GL_FlushBatch();
+
 	GL_SetState(GLSTATE_BLEND, 1);
 	GL_SetOrtho(0);
 
@@ -4097,7 +4101,6 @@ void M_DrawXInputButton(int x, int y, int button) {
 	float width;
 	float height;
 	int pic;
-	vtx_t vtx[4];
 	const rcolor color = MENUCOLORWHITE;
 
 	switch (button) {
@@ -4158,11 +4161,6 @@ void M_DrawXInputButton(int x, int y, int button) {
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
-	dglEnable(GL_BLEND);
-	dglSetVertex(vtx);
-
-	GL_SetOrtho(0);
-
 	vx1 = (float)x;
 	vy1 = (float)y;
 
@@ -4171,8 +4169,8 @@ void M_DrawXInputButton(int x, int y, int button) {
 	ty1 = ((float)xinputbutons[index].y / height) + 0.005f;
 	ty2 = (ty1 + (((float)xinputbutons[index].h / height))) - 0.008f;
 
-	GL_Set2DQuad(
-		vtx,
+	Draw_BatchQuad(
+		gfxptr[pic],
 		vx1,
 		vy1,
 		xinputbutons[index].w,
@@ -4183,13 +4181,6 @@ void M_DrawXInputButton(int x, int y, int button) {
 		ty2,
 		color
 	);
-
-	dglTriangle(0, 1, 2);
-	dglTriangle(3, 2, 1);
-	dglDrawGeometry(4, vtx);
-
-	GL_ResetViewport();
-	dglDisable(GL_BLEND);
 }
 
 #endif
@@ -4613,7 +4604,6 @@ static void M_DrawMenuSkull(int x, int y) {
 	float smbwidth;
 	float smbheight;
 	int pic, parama, paramr;
-	vtx_t vtx[4];
 	const rcolor color = MENUCOLORWHITE;
 
 	parama = M_CheckParm("-alpha");
@@ -4635,11 +4625,6 @@ static void M_DrawMenuSkull(int x, int y) {
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
-	dglEnable(GL_BLEND);
-	dglSetVertex(vtx);
-
-	GL_SetOrtho(0);
-
 	index = (whichSkull & 7) + SM_SKULLS;
 
 	vx1 = (float)x;
@@ -4653,8 +4638,8 @@ static void M_DrawMenuSkull(int x, int y) {
 	ty1 = ((float)symboldata[index].y / smbheight) + 0.005f;
 	ty2 = (ty1 + (((float)symboldata[index].h / smbheight))) - 0.008f;
 
-	GL_Set2DQuad(
-		vtx,
+	Draw_BatchQuad(
+		gfxptr[pic],
 		vx1,
 		vy1,
 		symboldata[index].w,
@@ -4665,13 +4650,6 @@ static void M_DrawMenuSkull(int x, int y) {
 		ty2,
 		color
 	);
-
-	dglTriangle(0, 1, 2);
-	dglTriangle(3, 2, 1);
-	dglDrawGeometry(4, vtx);
-
-	GL_ResetViewport();
-	dglDisable(GL_BLEND);
 }
 
 //
@@ -4692,11 +4670,8 @@ static void M_DrawCursor(float x, float y) {
 		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 
 		GL_SetOrthoScale(scale);
-		GL_SetState(GLSTATE_BLEND, 1);
-		GL_SetupAndDraw2DQuad((float)x * factor, (float)y * factor,
-			gfxwidth[gfxIdx], gfxheight[gfxIdx], 0, 1.0f, 0, 1.0f, WHITE, 0);
-
-		GL_SetState(GLSTATE_BLEND, 0);
+		Draw_BatchQuad(gfxptr[gfxIdx], (float)x * factor, (float)y * factor,
+			gfxwidth[gfxIdx], gfxheight[gfxIdx], 0, 1.0f, 0, 1.0f, WHITE);
 		GL_SetOrthoScale(1.0f);
 	}
 }
@@ -0,0 +1,757 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//      Network condition simulator. Sits in front of another module
+//      and holds back received packets to fake a bad connection.
+//      Conditions are applied on the receiving end, so both the
+//      client and server ends need wrapping to impair both directions.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "m_misc.h"
+#include "con_console.h"
+#include "con_cvar.h"
+#include "g_actions.h"
+#include "net_defs.h"
+#include "net_packet.h"
+#include "net_sim.h"
+
+#define MAX_SIM_PACKETS 256
+#define MAX_SIM_ADDRS 16
+
+// extra hold-back for packets picked to arrive out of order
+
+#define REORDER_DELAY 50
+
+// whether the simulator runs at all is decided when the network
+// modules are set up, so one of these or -netsim has to be set by
+// then; after that, changes apply to the next packet received
+
+CVAR(net_sim_latency, 0);   // milliseconds
+CVAR(net_sim_jitter, 0);    // +/- milliseconds
+CVAR(net_sim_loss, 0);      // percent
+CVAR(net_sim_dup, 0);       // percent
+CVAR(net_sim_reorder, 0);   // percent
+CVAR(net_sim_seed, 1993);
+
+// values given on the command line are kept here rather than in
+// the cvars, which are written to the config, so they only last
+// for the run they were given on. They take precedence over the
+// cvars while set
+
+typedef struct
+{
+	cvar_t* cvar;
+	boolean set;
+	float value;
+} sim_setting_t;
+
+static sim_setting_t sim_latency = { &net_sim_latency, false, 0 };
+static sim_setting_t sim_jitter = { &net_sim_jitter, false, 0 };
+static sim_setting_t sim_loss = { &net_sim_loss, false, 0 };
+static sim_setting_t sim_dup = { &net_sim_dup, false, 0 };
+static sim_setting_t sim_reorder = { &net_sim_reorder, false, 0 };
+static sim_setting_t sim_seed = { &net_sim_seed, false, 0 };
+
+typedef struct
+{
+	net_packet_t* packet;
+	net_addr_t* addr;
+	int arrival;                // when the transport handed it over
+	int time;                   // when the packet may be received
+	unsigned int order;         // keeps equal times in arrival order
+} sim_packet_t;
+
+typedef struct
+{
+	int packets_in;
+	int packets_out;
+	int bytes_in;
+	int bytes_out;
+	int dropped;
+	int duplicated;
+	int reordered;
+	int overflowed;
+	int resends;                // GAMEDATA_RESEND requests seen
+	int total_delay;            // milliseconds, over packets_out
+} sim_stats_t;
+
+typedef struct
+{
+	char* name;
+	net_module_t* module;       // the wrapper itself
+	net_module_t* inner;        // transport being wrapped
+	sim_packet_t queue[MAX_SIM_PACKETS];
+	int num_queued;
+	unsigned int order;
+	net_addr_t addrs[MAX_SIM_ADDRS];
+	unsigned int seed;
+	sim_stats_t stats;
+} net_sim_t;
+
+static net_sim_t sim_client;
+static net_sim_t sim_server;
+
+static boolean sim_enabled = false;
+
+// time of the first game data packet dropped since the last resend
+// request, used to measure how long the netcode takes to recover
+
+static int sim_droptime = 0;
+static int sim_recoveries = 0;
+static int sim_recoverytime = 0;
+
+//
+// SimValue
+// The command line value if one was given, otherwise the cvar
+//
+
+static float SimValue(sim_setting_t* setting)
+{
+	return setting->set ? setting->value : setting->cvar->value;
+}
+
+//
+// SimRandom
+// xorshift; every instance has its own seed so runs are repeatable
+//
+
+static unsigned int SimRandom(net_sim_t* sim)
+{
+	unsigned int x = sim->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	sim->seed = x;
+
+	return x;
+}
+
+static boolean SimChance(net_sim_t* sim, float percent)
+{
+	if (percent <= 0)
+	{
+		return false;
+	}
+
+	return (SimRandom(sim) % 10000) < (unsigned int)(percent * 100);
+}
+
+static void SimReset(net_sim_t* sim, int instance)
+{
+	int i;
+
+	// anything still held back is dropped along with the stats
+	for (i = 0; i < sim->num_queued; ++i)
+	{
+		NET_FreePacket(sim->queue[i].packet);
+	}
+
+	sim->seed = ((unsigned int)SimValue(&sim_seed) * 2654435761u) ^ (instance + 1);
+
+	if (sim->seed == 0)
+	{
+		sim->seed = 1;
+	}
+
+	sim->num_queued = 0;
+	sim->order = 0;
+	dmemset(&sim->stats, 0, sizeof(sim_stats_t));
+}
+
+//
+// SimPacketType
+// Peek at the packet header without moving the read position
+//
+
+static unsigned int SimPacketType(net_packet_t* packet)
+{
+	if (packet->len < 2)
+	{
+		return 0xffff;
+	}
+
+	return ((packet->data[0] << 8) | packet->data[1]) & ~NET_RELIABLE_PACKET;
+}
+
+//
+// Address mapping
+//
+// Addresses handed out by the wrapper point back at the wrapper so
+// replies come through it; the transport's own address is the handle
+//
+
+static net_addr_t* SimWrapAddr(net_sim_t* sim, net_addr_t* addr)
+{
+	int i;
+
+	if (addr == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < MAX_SIM_ADDRS; ++i)
+	{
+		if (sim->addrs[i].module != NULL && sim->addrs[i].handle == addr)
+		{
+			return &sim->addrs[i];
+		}
+	}
+
+	for (i = 0; i < MAX_SIM_ADDRS; ++i)
+	{
+		if (sim->addrs[i].module == NULL)
+		{
+			sim->addrs[i].module = sim->module;
+			sim->addrs[i].handle = addr;
+
+			return &sim->addrs[i];
+		}
+	}
+
+	I_Error("SimWrapAddr: out of %s addresses", sim->name);
+	return NULL;
+}
+
+static net_addr_t* SimInnerAddr(net_sim_t* sim, net_addr_t* addr)
+{
+	if (addr->module != sim->module)
+	{
+		// broadcast or foreign address: pass it through
+
+		return addr;
+	}
+
+	return (net_addr_t*)addr->handle;
+}
+
+//
+// SimQueuePacket
+// Decide the fate of a packet coming in from the transport
+//
+
+static void SimQueuePacket(net_sim_t* sim, net_addr_t* addr, net_packet_t* packet)
+{
+	unsigned int type;
+	int copies;
+	int delay;
+	int now;
+	int i;
+
+	now = I_GetTimeMS();
+	type = SimPacketType(packet);
+
+	sim->stats.packets_in++;
+	sim->stats.bytes_in += packet->len;
+
+	if (type == NET_PACKET_TYPE_GAMEDATA_RESEND)
+	{
+		sim->stats.resends++;
+
+		if (sim_droptime != 0)
+		{
+			sim_recoveries++;
+			sim_recoverytime += now - sim_droptime;
+			sim_droptime = 0;
+		}
+	}
+
+	if (SimChance(sim, SimValue(&sim_loss)))
+	{
+		sim->stats.dropped++;
+
+		if (type == NET_PACKET_TYPE_GAMEDATA && sim_droptime == 0)
+		{
+			sim_droptime = now;
+		}
+
+		NET_FreePacket(packet);
+		return;
+	}
+
+	copies = 1;
+
+	if (SimChance(sim, SimValue(&sim_dup)))
+	{
+		sim->stats.duplicated++;
+		copies = 2;
+	}
+
+	for (i = 0; i < copies; ++i)
+	{
+		sim_packet_t* entry;
+
+		if (sim->num_queued >= MAX_SIM_PACKETS)
+		{
+			sim->stats.overflowed++;
+
+			if (i == 0)
+			{
+				NET_FreePacket(packet);
+			}
+
+			return;
+		}
+
+		delay = (int)SimValue(&sim_latency);
+
+		if (SimValue(&sim_jitter) > 0)
+		{
+			int jitter = (int)SimValue(&sim_jitter);
+
+			delay += (int)(SimRandom(sim) % (2 * jitter + 1)) - jitter;
+		}
+
+		if (SimChance(sim, SimValue(&sim_reorder)))
+		{
+			sim->stats.reordered++;
+			delay += REORDER_DELAY;
+		}
+
+		if (delay < 0)
+		{
+			delay = 0;
+		}
+
+		entry = &sim->queue[sim->num_queued++];
+		entry->packet = (i == 0 ? packet : NET_PacketDup(packet));
+		entry->addr = addr;
+		entry->arrival = now;
+		entry->time = now + delay;
+		entry->order = sim->order++;
+	}
+}
+
+//
+// SimPopPacket
+// Hand out the earliest packet that is due
+//
+
+static boolean SimPopPacket(net_sim_t* sim, net_addr_t** addr, net_packet_t** packet)
+{
+	sim_packet_t* best;
+	int now;
+	int i;
+
+	best = NULL;
+
+	for (i = 0; i < sim->num_queued; ++i)
+	{
+		sim_packet_t* entry = &sim->queue[i];
+
+		if (best == NULL || entry->time < best->time
+			|| (entry->time == best->time && entry->order < best->order))
+		{
+			best = entry;
+		}
+	}
+
+	now = I_GetTimeMS();
+
+	if (best == NULL || best->time > now)
+	{
+		return false;
+	}
+
+	*addr = best->addr;
+	*packet = best->packet;
+
+	sim->stats.packets_out++;
+	sim->stats.bytes_out += best->packet->len;
+	sim->stats.total_delay += now - best->arrival;
+
+	*best = sim->queue[--sim->num_queued];
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Module functions
+//
+//-----------------------------------------------------------------------------
+
+static void SimSendPacket(net_sim_t* sim, net_addr_t* addr, net_packet_t* packet)
+{
+	sim->inner->SendPacket(SimInnerAddr(sim, addr), packet);
+}
+
+static boolean SimRecvPacket(net_sim_t* sim, net_addr_t** addr, net_packet_t** packet)
+{
+	net_addr_t* inaddr;
+	net_packet_t* inpacket;
+
+	// drain the transport into the delay queue
+
+	while (sim->inner->RecvPacket(&inaddr, &inpacket))
+	{
+		SimQueuePacket(sim, SimWrapAddr(sim, inaddr), inpacket);
+	}
+
+	return SimPopPacket(sim, addr, packet);
+}
+
+static void SimAddrToString(net_sim_t* sim, net_addr_t* addr, char* buffer, int buffer_len)
+{
+	net_addr_t* inner = SimInnerAddr(sim, addr);
+
+	inner->module->AddrToString(inner, buffer, buffer_len);
+}
+
+static void SimFreeAddress(net_sim_t* sim, net_addr_t* addr)
+{
+	net_addr_t* inner = SimInnerAddr(sim, addr);
+
+	inner->module->FreeAddress(inner);
+
+	if (addr != inner)
+	{
+		addr->module = NULL;
+		addr->handle = NULL;
+	}
+}
+
+static net_addr_t* SimResolveAddress(net_sim_t* sim, char* address)
+{
+	return SimWrapAddr(sim, sim->inner->ResolveAddress(address));
+}
+
+//
+// Client end
+//
+
+static boolean NET_SIM_CL_InitClient(void)
+{
+	return sim_client.inner->InitClient();
+}
+
+static boolean NET_SIM_CL_InitServer(void)
+{
+	return sim_client.inner->InitServer();
+}
+
+static void NET_SIM_CL_SendPacket(net_addr_t* addr, net_packet_t* packet)
+{
+	SimSendPacket(&sim_client, addr, packet);
+}
+
+static boolean NET_SIM_CL_RecvPacket(net_addr_t** addr, net_packet_t** packet)
+{
+	return SimRecvPacket(&sim_client, addr, packet);
+}
+
+static void NET_SIM_CL_AddrToString(net_addr_t* addr, char* buffer, int buffer_len)
+{
+	SimAddrToString(&sim_client, addr, buffer, buffer_len);
+}
+
+static void NET_SIM_CL_FreeAddress(net_addr_t* addr)
+{
+	SimFreeAddress(&sim_client, addr);
+}
+
+static net_addr_t* NET_SIM_CL_ResolveAddress(char* address)
+{
+	return SimResolveAddress(&sim_client, address);
+}
+
+net_module_t net_sim_client_module =
+{
+	NET_SIM_CL_InitClient,
+	NET_SIM_CL_InitServer,
+	NET_SIM_CL_SendPacket,
+	NET_SIM_CL_RecvPacket,
+	NET_SIM_CL_AddrToString,
+	NET_SIM_CL_FreeAddress,
+	NET_SIM_CL_ResolveAddress,
+};
+
+//
+// Server end
+//
+
+static boolean NET_SIM_SV_InitClient(void)
+{
+	return sim_server.inner->InitClient();
+}
+
+static boolean NET_SIM_SV_InitServer(void)
+{
+	return sim_server.inner->InitServer();
+}
+
+static void NET_SIM_SV_SendPacket(net_addr_t* addr, net_packet_t* packet)
+{
+	SimSendPacket(&sim_server, addr, packet);
+}
+
+static boolean NET_SIM_SV_RecvPacket(net_addr_t** addr, net_packet_t** packet)
+{
+	return SimRecvPacket(&sim_server, addr, packet);
+}
+
+static void NET_SIM_SV_AddrToString(net_addr_t* addr, char* buffer, int buffer_len)
+{
+	SimAddrToString(&sim_server, addr, buffer, buffer_len);
+}
+
+static void NET_SIM_SV_FreeAddress(net_addr_t* addr)
+{
+	SimFreeAddress(&sim_server, addr);
+}
+
+static net_addr_t* NET_SIM_SV_ResolveAddress(char* address)
+{
+	return SimResolveAddress(&sim_server, address);
+}
+
+net_module_t net_sim_server_module =
+{
+	NET_SIM_SV_InitClient,
+	NET_SIM_SV_InitServer,
+	NET_SIM_SV_SendPacket,
+	NET_SIM_SV_RecvPacket,
+	NET_SIM_SV_AddrToString,
+	NET_SIM_SV_FreeAddress,
+	NET_SIM_SV_ResolveAddress,
+};
+
+//-----------------------------------------------------------------------------
+//
+// Setup
+//
+//-----------------------------------------------------------------------------
+
+//
+// SimCheckParm
+// Command line options override the cvars without changing them
+//
+
+static boolean SimCheckParm(char* parm, sim_setting_t* setting)
+{
+	int p;
+
+	p = M_CheckParm(parm);
+
+	if (p > 0 && p < myargc - 1)
+	{
+		setting->set = true;
+		setting->value = (float)atof(myargv[p + 1]);
+		return true;
+	}
+
+	return false;
+}
+
+static void SimInit(void)
+{
+	static boolean initialized = false;
+	boolean parms;
+
+	if (initialized)
+	{
+		return;
+	}
+
+	initialized = true;
+
+	sim_client.name = "client";
+	sim_client.module = &net_sim_client_module;
+	sim_server.name = "server";
+	sim_server.module = &net_sim_server_module;
+
+	//!
+	// @category net
+	//
+	// Run network traffic through the condition simulator. The
+	// net_sim_* cvars or the options below control what it does.
+	// It only starts if this, an option below or one of the cvars
+	// is set when the game starts.
+	//
+
+	parms = M_CheckParm("-netsim") > 0;
+
+	//!
+	// @arg <ms>
+	// @category net
+	//
+	// Simulated one-way latency.
+	//
+
+	parms |= SimCheckParm("-netlatency", &sim_latency);
+
+	//!
+	// @arg <ms>
+	// @category net
+	//
+	// Simulated latency varies by up to this much either way.
+	//
+
+	parms |= SimCheckParm("-netjitter", &sim_jitter);
+
+	//!
+	// @arg <percent>
+	// @category net
+	//
+	// Chance of a packet being lost.
+	//
+
+	parms |= SimCheckParm("-netloss", &sim_loss);
+
+	//!
+	// @arg <percent>
+	// @category net
+	//
+	// Chance of a packet arriving twice.
+	//
+
+	parms |= SimCheckParm("-netdup", &sim_dup);
+
+	//!
+	// @arg <percent>
+	// @category net
+	//
+	// Chance of a packet arriving after the ones sent behind it.
+	//
+
+	parms |= SimCheckParm("-netreorder", &sim_reorder);
+
+	//!
+	// @arg <n>
+	// @category net
+	//
+	// Seed for the simulator, so a run can be repeated exactly.
+	//
+
+	parms |= SimCheckParm("-netseed", &sim_seed);
+
+	sim_enabled = parms
+		|| SimValue(&sim_latency) || SimValue(&sim_jitter)
+		|| SimValue(&sim_loss) || SimValue(&sim_dup)
+		|| SimValue(&sim_reorder);
+
+	SimReset(&sim_client, 0);
+	SimReset(&sim_server, 1);
+
+	sim_droptime = sim_recoveries = sim_recoverytime = 0;
+}
+
+//
+// NET_SIM_WrapClient
+//
+
+net_module_t* NET_SIM_WrapClient(net_module_t* module)
+{
+	SimInit();
+
+	if (!sim_enabled)
+	{
+		return module;
+	}
+
+	sim_client.inner = module;
+
+	return &net_sim_client_module;
+}
+
+//
+// NET_SIM_WrapServer
+//
+
+net_module_t* NET_SIM_WrapServer(net_module_t* module)
+{
+	SimInit();
+
+	if (!sim_enabled)
+	{
+		return module;
+	}
+
+	sim_server.inner = module;
+
+	return &net_sim_server_module;
+}
+
+//
+// CMD_NetSim
+//
+
+static void SimPrintStats(net_sim_t* sim)
+{
+	sim_stats_t* stats = &sim->stats;
+
+	if (sim->inner == NULL)
+	{
+		return;
+	}
+
+	CON_Printf(GREEN, "%s end:\n", sim->name);
+	CON_Printf(WHITE, " in: %i packets, %i bytes\n", stats->packets_in, stats->bytes_in);
+	CON_Printf(WHITE, " out: %i packets, %i bytes\n", stats->packets_out, stats->bytes_out);
+	CON_Printf(WHITE, " dropped: %i, duplicated: %i, reordered: %i, overflowed: %i\n",
+		stats->dropped, stats->duplicated, stats->reordered, stats->overflowed);
+	CON_Printf(WHITE, " resend requests: %i, avg delay: %ims\n", stats->resends,
+		stats->packets_out ? stats->total_delay / stats->packets_out : 0);
+}
+
+static CMD(NetSim)
+{
+	if (!sim_enabled)
+	{
+		CON_Printf(WHITE, "Network simulator is not running\n");
+		CON_Printf(WHITE, "Set -netsim or a net_sim_* cvar before starting a netgame\n");
+		return;
+	}
+
+	if (param[0] && !dstricmp(param[0], "reset"))
+	{
+		SimReset(&sim_client, 0);
+		SimReset(&sim_server, 1);
+		sim_droptime = sim_recoveries = sim_recoverytime = 0;
+		return;
+	}
+
+	SimPrintStats(&sim_client);
+	SimPrintStats(&sim_server);
+
+	CON_Printf(AQUA, "recoveries: %i, avg time from loss to resend request: %ims\n",
+		sim_recoveries, sim_recoveries ? sim_recoverytime / sim_recoveries : 0);
+}
+
+//
+// NET_SIM_RegisterCvars
+//
+
+void NET_SIM_RegisterCvars(void)
+{
+	CON_CvarRegister(&net_sim_latency);
+	CON_CvarRegister(&net_sim_jitter);
+	CON_CvarRegister(&net_sim_loss);
+	CON_CvarRegister(&net_sim_dup);
+	CON_CvarRegister(&net_sim_reorder);
+	CON_CvarRegister(&net_sim_seed);
+
+	G_AddCommand("netsim", CMD_NetSim, 0);
+}
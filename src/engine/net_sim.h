@@ -0,0 +1,41 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//      Network condition simulator. Wraps another module and adds
+//      latency, jitter, loss, duplication and reordering.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include "net_defs.h"
+
+extern net_module_t net_sim_client_module;
+extern net_module_t net_sim_server_module;
+
+// Returns the simulator wrapped around module, or module itself
+// when no network conditions have been asked for
+
+net_module_t* NET_SIM_WrapClient(net_module_t* module);
+net_module_t* NET_SIM_WrapServer(net_module_t* module);
+
+void NET_SIM_RegisterCvars(void);
+
+#endif /* #ifndef NET_SIM_H */
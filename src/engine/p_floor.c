@@ -33,6 +33,7 @@
 #include "s_sound.h"
 #include "doomstat.h"
 #include "sounds.h"
+#include "r_lights.h"
 
 //
 // FLOORS
@@ -48,6 +49,8 @@ result_e T_MovePlane(sector_t* sector, fixed_t speed, fixed_t dest,
 	boolean flag;
 	fixed_t lastpos;
 
+	R_InvalidateSectorLight(sector);
+
 	switch (floorOrCeiling) {
 	case 0:
 		// FLOOR
@@ -500,6 +503,8 @@ void T_MoveSplitPlane(splitmove_t* split) {
 	boolean cdone = false;
 	boolean fdone = false;
 
+	R_InvalidateSectorLight(sector);
+
 	if (split->ceildir == -1) {
 		lastceilpos = sector->ceilingheight;
 
@@ -334,6 +334,17 @@ void P_UnsetThingPosition(mobj_t* thing) {
 		else {
 			thing->subsector->sector->thinglist = thing->snext;
 		}
+
+		if (thing->ssnext) {
+			thing->ssnext->ssprev = thing->ssprev;
+		}
+
+		if (thing->ssprev) {
+			thing->ssprev->ssnext = thing->ssnext;
+		}
+		else {
+			thing->subsector->thinglist = thing->ssnext;
+		}
 	}
 
 	if (!(thing->flags & MF_NOBLOCKMAP)) {
@@ -388,6 +399,15 @@ P_SetThingPosition(mobj_t* thing) {
 		}
 
 		sec->thinglist = thing;
+
+		thing->ssprev = NULL;
+		thing->ssnext = ss->thinglist;
+
+		if (ss->thinglist) {
+			ss->thinglist->ssprev = thing;
+		}
+
+		ss->thinglist = thing;
 	}
 
 	// link into blockmap
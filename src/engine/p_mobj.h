@@ -167,6 +167,13 @@ typedef struct mobj_s {
     struct mobj_s*      snext;
     struct mobj_s*      sprev;
 
+    // links in subsector, for collecting sprites
+    struct mobj_s*      ssnext;
+    struct mobj_s*      ssprev;
+
+    // occlusion query slot + 1, 0 if it has none
+    int                 occlusion;
+
     //More drawing info: to determine current sprite.
     angle_t             angle;    // orientation
     angle_t             pitch;  // [kex] pitch orientation; for looking up/down
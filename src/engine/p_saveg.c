@@ -38,8 +38,12 @@
 #include "info.h"
 #include "m_password.h"
 #include "p_saveg.h"
+#include "s_sound.h"
 #include "d_englsh.h"
 #include "m_misc.h"
+#include "m_random.h"
+#include "p_spec.h"
+#include "r_lights.h"
 #include "doomdef.h" // added just so MSVC would shut up about warning C4761
 
 void G_DoLoadLevel(void);
@@ -56,6 +60,11 @@ static byte* savebuffer;
 
 static unsigned long save_offset = 0;
 
+// when set, the archive is written to savebuffer instead of save_stream
+// and keeps full precision for netgame prediction snapshots
+static boolean save_snapshot = false;
+static int save_alloced = 0;
+
 //
 // P_GetSaveGameName
 //
@@ -82,6 +91,16 @@ static byte saveg_read8(void) {
 }
 
 static void saveg_write8(byte value) {
+    if (save_snapshot) {
+        if (save_offset >= (unsigned long)save_alloced) {
+            save_alloced = save_alloced ? save_alloced * 2 : SAVEGAMESIZE;
+            savebuffer = Z_Realloc(savebuffer, save_alloced, PU_STATIC, NULL);
+        }
+
+        savebuffer[save_offset++] = value;
+        return;
+    }
+
     fwrite(&value, 1, 1, save_stream);
     save_offset++;
 }
@@ -170,6 +189,19 @@ typedef struct {
 static savegmobj_t* savegmobj;
 static int          savegmobjnum;
 
+//
+// saveg_cmpmobj
+// Orders the ref table by mobj address so that
+// saveg_write_mobjindex can do a binary search
+//
+
+static int saveg_cmpmobj(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)((const savegmobj_t*)a)->mobj;
+    uintptr_t y = (uintptr_t)((const savegmobj_t*)b)->mobj;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
 static void saveg_setup_mobjwrite(void) {
     mobj_t* mobj;
     int i;
@@ -201,6 +233,8 @@ static void saveg_setup_mobjwrite(void) {
         savegmobj[i].mobj = mobj;
         i++;
     }
+
+    qsort(savegmobj, savegmobjnum, sizeof(savegmobj_t), saveg_cmpmobj);
 }
 
 static void saveg_setup_mobjread(void) {
@@ -218,31 +252,26 @@ static void saveg_setup_mobjread(void) {
 }
 
 static void saveg_write_mobjindex(mobj_t* mobj) {
-    int i;
-
-    for (i = 0; i < savegmobjnum; i++) {
-        if (savegmobj[i].mobj != mobj) {
-            continue;
-        }
+    savegmobj_t key;
+    savegmobj_t* ref;
 
-        saveg_write32(savegmobj[i].index);
+    if (mobj == NULL || savegmobjnum == 0) {
+        saveg_write32(0);
         return;
     }
 
-    saveg_write32(0);
+    key.mobj = mobj;
+    ref = bsearch(&key, savegmobj, savegmobjnum, sizeof(savegmobj_t), saveg_cmpmobj);
+
+    saveg_write32(ref ? ref->index : 0);
 }
 
 static mobj_t* saveg_read_mobjindex(void) {
     int index = saveg_read32();
 
-    if (index) {
-        int i;
-
-        for (i = 0; i < savegmobjnum; i++) {
-            if (savegmobj[i].index == index) {
-                return savegmobj[i].mobj;
-            }
-        }
+    // ref table is built in archive order, so index - 1 is the slot
+    if (index > 0 && index <= savegmobjnum) {
+        return savegmobj[index - 1].mobj;
     }
 
     return NULL;
@@ -1306,6 +1335,161 @@ boolean P_ReadSaveGame(char* name) {
     return true;
 }
 
+//------------------------------------------------------------------------
+//
+// Memory snapshots
+//
+// Used by the netgame prediction code in d_net.c. Unlike a savegame
+// these keep exact sector heights and also carry the state that
+// normally gets rebuilt by G_DoLoadLevel (rng, buttons, body queue)
+//
+//------------------------------------------------------------------------
+
+static void saveg_write_snapshotstate(void) {
+    int i;
+    int j;
+
+    for (i = 0; i < NUMPRCLASS; i++) {
+        saveg_write32(rng.seed[i]);
+    }
+
+    saveg_write32(rng.rndindex);
+    saveg_write32(rng.prndindex);
+    saveg_write32(basetic);
+    saveg_write32(leveltime);
+    saveg_write16(globalint);
+    saveg_write32(totalkills);
+    saveg_write32(totalitems);
+    saveg_write32(totalsecret);
+    saveg_write32(bodyqueslot);
+
+    for (i = 0; i < BODYQUESIZE; i++) {
+        saveg_write_mobjindex(bodyque[i]);
+    }
+
+    // buttons only reference map geometry which never moves,
+    // so they can be copied as is
+    for (i = 0; i < (int)sizeof(buttonlist); i++) {
+        saveg_write8(((byte*)buttonlist)[i]);
+    }
+
+    // guessed tics write their own values into these, and a
+    // rollback has to check the real commands against the
+    // values from before the guesses
+    for (i = 0; i < MAXPLAYERS; i++) {
+        for (j = 0; j < BACKUPTICS; j++) {
+            saveg_write8(consistency[i][j]);
+        }
+    }
+}
+
+static void saveg_read_snapshotstate(void) {
+    int i;
+    int j;
+
+    for (i = 0; i < NUMPRCLASS; i++) {
+        rng.seed[i] = saveg_read32();
+    }
+
+    rng.rndindex = saveg_read32();
+    rng.prndindex = saveg_read32();
+    basetic = saveg_read32();
+    leveltime = saveg_read32();
+    globalint = saveg_read16();
+    totalkills = saveg_read32();
+    totalitems = saveg_read32();
+    totalsecret = saveg_read32();
+    bodyqueslot = saveg_read32();
+
+    for (i = 0; i < BODYQUESIZE; i++) {
+        bodyque[i] = saveg_read_mobjindex();
+    }
+
+    for (i = 0; i < (int)sizeof(buttonlist); i++) {
+        ((byte*)buttonlist)[i] = saveg_read8();
+    }
+
+    for (i = 0; i < MAXPLAYERS; i++) {
+        for (j = 0; j < BACKUPTICS; j++) {
+            consistency[i][j] = saveg_read8();
+        }
+    }
+}
+
+//
+// P_WriteSnapshot
+// Archives the play state into *buffer, which is (re)allocated
+// as needed. Returns the size of the snapshot in bytes.
+//
+
+int P_WriteSnapshot(byte** buffer, int* alloced) {
+    int size;
+
+    savebuffer = *buffer;
+    save_alloced = *alloced;
+    save_offset = 0;
+    save_snapshot = true;
+
+    P_ArchiveMobjs();
+    saveg_write_snapshotstate();
+    P_ArchivePlayers();
+    P_ArchiveWorld();
+    P_ArchiveSpecials();
+    P_ArchiveMacros();
+
+    saveg_write_marker(SAVEGAME_EOF);
+
+    Z_Free(savegmobj);
+    savegmobj = NULL;
+
+    *buffer = savebuffer;
+    *alloced = save_alloced;
+    size = save_offset;
+
+    savebuffer = NULL;
+    save_alloced = 0;
+    save_snapshot = false;
+
+    return size;
+}
+
+//
+// P_ReadSnapshot
+// Restores the play state written by P_WriteSnapshot
+// on top of the current level
+//
+
+void P_ReadSnapshot(byte* buffer) {
+    savebuffer = buffer;
+    save_offset = 0;
+    save_snapshot = true;
+
+    // these only point at thinkers that are about to be freed
+    dmemset(activeceilings, 0, sizeof(activeceilings));
+    dmemset(activeplats, 0, sizeof(activeplats));
+    macrothinker = NULL;
+    macro = NULL;
+    nextmacro = NULL;
+    mobjmacro = NULL;
+
+    P_UnArchiveMobjs();
+    saveg_read_snapshotstate();
+    P_UnArchivePlayers();
+    P_UnArchiveWorld();
+    P_UnArchiveSpecials();
+    P_UnArchiveMacros();
+
+    if (!saveg_read_marker(SAVEGAME_EOF)) {
+        I_Error("P_ReadSnapshot: Snapshot is inconsistent");
+    }
+
+    Z_Free(savegmobj);
+    savegmobj = NULL;
+
+    savebuffer = NULL;
+    save_snapshot = false;
+}
+
 //
 // P_QuickReadSaveHeader
 //
@@ -1396,8 +1580,16 @@ void P_ArchiveWorld(void) {
 
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++) {
-        saveg_write16(F2INT(sec->floorheight));
-        saveg_write16(F2INT(sec->ceilingheight));
+        if (save_snapshot) {
+            // movers leave fractional heights behind
+            saveg_write32(sec->floorheight);
+            saveg_write32(sec->ceilingheight);
+        }
+        else {
+            saveg_write16(F2INT(sec->floorheight));
+            saveg_write16(F2INT(sec->ceilingheight));
+        }
+
         saveg_write16(sec->floorpic);
         saveg_write16(sec->ceilingpic);
         saveg_write16(sec->special);
@@ -1428,8 +1620,15 @@ void P_ArchiveWorld(void) {
 
             si = &sides[li->sidenum[j]];
 
-            saveg_write16(F2INT(si->textureoffset));
-            saveg_write16(F2INT(si->rowoffset));
+            if (save_snapshot) {
+                saveg_write32(si->textureoffset);
+                saveg_write32(si->rowoffset);
+            }
+            else {
+                saveg_write16(F2INT(si->textureoffset));
+                saveg_write16(F2INT(si->rowoffset));
+            }
+
             saveg_write16(si->toptexture);
             saveg_write16(si->bottomtexture);
             saveg_write16(si->midtexture);
@@ -1462,11 +1661,22 @@ void P_UnArchiveWorld(void) {
     line_t* li;
     light_t* light;
     side_t* si;
+    boolean changed;
 
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++) {
-        sec->floorheight = INT2F(saveg_read16());
-        sec->ceilingheight = INT2F(saveg_read16());
+        fixed_t floorheight = sec->floorheight;
+        fixed_t ceilingheight = sec->ceilingheight;
+
+        if (save_snapshot) {
+            sec->floorheight = saveg_read32();
+            sec->ceilingheight = saveg_read32();
+        }
+        else {
+            sec->floorheight = INT2F(saveg_read16());
+            sec->ceilingheight = INT2F(saveg_read16());
+        }
+
         sec->floorpic = saveg_read16();
         sec->ceilingpic = saveg_read16();
         sec->special = saveg_read16();
@@ -1478,8 +1688,19 @@ void P_UnArchiveWorld(void) {
 
         saveg_set_mobjtarget(&sec->soundtarget, saveg_read_mobjindex());
 
+        // rollbacks put most sectors back as they were, so only
+        // redo the wall colours of the ones that actually differ
+        changed = (sec->floorheight != floorheight || sec->ceilingheight != ceilingheight);
+
         for (j = 0; j < 5; j++) {
-            sec->colors[j] = saveg_read16();
+            short color = saveg_read16();
+
+            changed |= (sec->colors[j] != color);
+            sec->colors[j] = color;
+        }
+
+        if (changed) {
+            R_InvalidateSectorLight(sec);
         }
 
         sec->specialdata = 0;
@@ -1498,8 +1719,16 @@ void P_UnArchiveWorld(void) {
             }
 
             si = &sides[li->sidenum[j]];
-            si->textureoffset = INT2F(saveg_read16());
-            si->rowoffset = INT2F(saveg_read16());
+
+            if (save_snapshot) {
+                si->textureoffset = saveg_read32();
+                si->rowoffset = saveg_read32();
+            }
+            else {
+                si->textureoffset = INT2F(saveg_read16());
+                si->rowoffset = INT2F(saveg_read16());
+            }
+
             si->toptexture = saveg_read16();
             si->bottomtexture = saveg_read16();
             si->midtexture = saveg_read16();
@@ -1507,19 +1736,34 @@ void P_UnArchiveWorld(void) {
     }
 
     // do lights
+    changed = false;
+
     for (i = 0, light = lights; i < numlights; i++, light++) {
+        byte r, g, b;
+
         light->base_r = saveg_read8();
         light->base_g = saveg_read8();
         light->base_b = saveg_read8();
-        light->active_r = saveg_read8();
-        light->active_g = saveg_read8();
-        light->active_b = saveg_read8();
+
+        r = saveg_read8();
+        g = saveg_read8();
+        b = saveg_read8();
+
+        changed |= (light->active_r != r || light->active_g != g || light->active_b != b);
+
+        light->active_r = r;
+        light->active_g = g;
+        light->active_b = b;
         light->r = saveg_read8();
         light->g = saveg_read8();
         light->b = saveg_read8();
         saveg_read_pad();
         light->tag = saveg_read16();
     }
+
+    if (changed) {
+        R_InvalidateLightCache();
+    }
 }
 
 
@@ -1562,7 +1806,20 @@ void P_UnArchiveMobjs(void) {
     current = mobjhead.next;
     while (current != &mobjhead) {
         next = current->next;
-        P_RemoveMobj(current);
+
+        if (save_snapshot) {
+            // nothing else may hold on to these once the
+            // snapshot is restored, so free them right away
+            if (current->mobjfunc != P_SafeRemoveMobj) {
+                S_RemoveOrigin(current);
+                P_UnsetThingPosition(current);
+            }
+
+            Z_Free(current);
+        }
+        else {
+            P_RemoveMobj(current);
+        }
 
         current = next;
     }
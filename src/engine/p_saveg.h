@@ -40,6 +40,10 @@ boolean P_WriteSaveGame(char* description, int slot);
 boolean P_ReadSaveGame(char* name);
 boolean P_QuickReadSaveHeader(char* name, char* date, int* thumbnail, int* skill, int* map);
 
+// In-memory snapshots of the play state, for netgame prediction.
+int P_WriteSnapshot(byte** buffer, int* alloced);
+void P_ReadSnapshot(byte* buffer);
+
 // Persistent storage/archiving.
 // These are the load / save game routines.
 void P_ArchivePlayers(void);
@@ -30,6 +30,12 @@
 
 #include <math.h>
 
+#ifdef __OpenBSD__
+#include <SDL.h>
+#else
+#include <SDL3/SDL.h>
+#endif
+
 #include "doomdef.h"
 #include "i_swap.h"
 #include "m_fixed.h"
@@ -47,6 +53,7 @@
 #include "r_local.h"
 #include "gl_texture.h"
 #include "r_sky.h"
+#include "r_pvs.h"
 #include "con_console.h"
 #include "m_random.h"
 #include "z_zone.h"
@@ -145,19 +152,50 @@ mapthing_t          playerstarts[MAXPLAYERS];
 //
 // P_InitTextureHashTable
 //
+// Maps store textures as a 16 bit hash of the name. The texture
+// list doesn't change after startup, so the table is built once
+// and looked up by open addressing. It's only read after that,
+// which lets the level prefetch thread use it too
+//
 
-static word* texturehashlist[2];
+static word* texturehashkeys;       // hash of each texture's name
+static int* texturehashslots;       // texture index, -1 if empty
+static unsigned int texturehashsize;
 
 static void P_InitTextureHashTable(void) {
+	unsigned int slot;
 	int i;
-	int t = W_GetNumForName("T_START") + 1;
+	int t;
+
+	if (texturehashslots) {
+		return;
+	}
 
-	texturehashlist[0] = Z_Alloca(numtextures * sizeof(word));
-	texturehashlist[1] = Z_Alloca(numtextures * sizeof(word));
+	t = W_GetNumForName("T_START") + 1;
+
+	texturehashsize = 64;
+	while (texturehashsize < (unsigned int)numtextures * 2) {
+		texturehashsize <<= 1;
+	}
+
+	texturehashkeys = Z_Malloc(numtextures * sizeof(word), PU_STATIC, 0);
+	texturehashslots = Z_Malloc(texturehashsize * sizeof(int), PU_STATIC, 0);
+	dmemset(texturehashslots, 0xff, texturehashsize * sizeof(int));
 
 	for (i = 0; i < numtextures; i++) {
-		texturehashlist[0][i] = W_HashLumpName(lumpinfo[t + i].name) % 65536;
-		texturehashlist[1][i] = i;
+		texturehashkeys[i] = W_HashLumpName(lumpinfo[t + i].name) % 65536;
+
+		// keep the first texture with a given hash
+		for (slot = (texturehashkeys[i] * 2654435761u) & (texturehashsize - 1);
+			texturehashslots[slot] != -1; slot = (slot + 1) & (texturehashsize - 1)) {
+			if (texturehashkeys[texturehashslots[slot]] == texturehashkeys[i]) {
+				break;
+			}
+		}
+
+		if (texturehashslots[slot] == -1) {
+			texturehashslots[slot] = i;
+		}
 	}
 }
 
@@ -166,17 +204,294 @@ static void P_InitTextureHashTable(void) {
 //
 
 static word P_GetTextureHashKey(int hash) {
+	unsigned int slot;
+
+	for (slot = ((word)hash * 2654435761u) & (texturehashsize - 1);
+		texturehashslots[slot] != -1; slot = (slot + 1) & (texturehashsize - 1)) {
+		if (texturehashkeys[texturehashslots[slot]] == (word)hash) {
+			return texturehashslots[slot];
+		}
+	}
+
+	return 0;
+}
+
+//
+// LEVEL PREFETCH
+//
+// While the intermission runs, the next map's lump is read in
+// and a thread goes through its sidedefs, sectors and things
+// to work out which texture and sprite lumps it will need, so
+// they can be prefetched too. P_SetupLevel then finds the map
+// lump already cached. The zone isn't thread safe, so the thread
+// only reads the staged lump and the static tables and leaves
+// all allocation to the main thread
+//
+
+enum {
+	LP_IDLE,
+	LP_READING,     // lump prefetch issued, read it next tic
+	LP_SCANNING,    // thread is going through the staged lump
+	LP_DONE
+};
+
+typedef struct {
+	int             map;
+	int             lump;
+	int             stage;
+	byte*           data;
+	int             length;
+	SDL_Thread*     thread;
+	SDL_AtomicInt   done;
+	int*            lumps;      // texture and sprite lumps the map uses
+	int             numlumps;
+	uint64_t        starttime;
+} levelprefetch_t;
+
+static levelprefetch_t levelprefetch;
+
+//
+// P_FindMapLump
+// Bounds checked lookup in a map lump's own directory
+//
+
+static byte* P_FindMapLump(byte* data, int length, int lump, int* size) {
+	int numlumps;
+	int infotableofs;
+	int filepos;
+	byte* entry;
+
+	if (length < 12) {
+		return NULL;
+	}
+
+	numlumps = LONG(*(int*)(data + 4));
+	infotableofs = LONG(*(int*)(data + 8));
+
+	if (lump >= numlumps || infotableofs < 0 || infotableofs + (lump + 1) * 16 > length) {
+		return NULL;
+	}
+
+	entry = data + infotableofs + lump * 16;
+	filepos = LONG(*(int*)entry);
+	*size = LONG(*(int*)(entry + 4));
+
+	if (filepos < 0 || *size < 0 || filepos + *size > length) {
+		return NULL;
+	}
+
+	return data + filepos;
+}
+
+//
+// P_AddPrefetchTexture
+//
+
+static void P_AddPrefetchTexture(byte* used, int hash) {
+	used[P_GetTextureHashKey(hash)] = 1;
+}
+
+//
+// Thread_LevelPrefetch
+//
+
+static int SDLCALL Thread_LevelPrefetch(void* data) {
+	levelprefetch_t* lp = (levelprefetch_t*)data;
+	mapsidedef_t* msd;
+	mapsector_t* ms;
+	mapthing_t* mt;
+	byte* texused;
+	byte* sprused;
+	int size;
+	int num;
 	int i;
+	int j;
+	int k;
+
+	texused = (byte*)calloc(numtextures, 1);
+	sprused = (byte*)calloc(NUMSPRITES, 1);
+
+	if ((msd = (mapsidedef_t*)P_FindMapLump(lp->data, lp->length, ML_SIDEDEFS, &size))) {
+		for (i = 0; i < size / (int)sizeof(mapsidedef_t); i++, msd++) {
+			P_AddPrefetchTexture(texused, SHORT(msd->toptexture));
+			P_AddPrefetchTexture(texused, SHORT(msd->bottomtexture));
+			P_AddPrefetchTexture(texused, SHORT(msd->midtexture));
+		}
+	}
+
+	if ((ms = (mapsector_t*)P_FindMapLump(lp->data, lp->length, ML_SECTORS, &size))) {
+		for (i = 0; i < size / (int)sizeof(mapsector_t); i++, ms++) {
+			P_AddPrefetchTexture(texused, SHORT(ms->floorpic));
+			P_AddPrefetchTexture(texused, SHORT(ms->ceilingpic));
+		}
+	}
+
+	if ((mt = (mapthing_t*)P_FindMapLump(lp->data, lp->length, ML_THINGS, &size))) {
+		for (i = 0; i < size / (int)sizeof(mapthing_t); i++, mt++) {
+			for (j = 0; j < NUMMOBJTYPES; j++) {
+				if (SHORT(mt->type) == mobjinfo[j].doomednum) {
+					sprused[states[mobjinfo[j].spawnstate].sprite] = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	// count, then fill in the lump list
+
+	num = 0;
 
 	for (i = 0; i < numtextures; i++) {
-		if (texturehashlist[0][i] == hash) {
-			return texturehashlist[1][i];
+		num += texused[i];
+	}
+
+	for (i = 0; i < NUMSPRITES; i++) {
+		if (sprused[i]) {
+			for (j = 0; j < spriteinfo[i].numframes; j++) {
+				num += spriteinfo[i].spriteframes[j].rotate ? 8 : 1;
+			}
+		}
+	}
+
+	lp->lumps = (int*)malloc(MAX(num, 1) * sizeof(int));
+	lp->numlumps = 0;
+
+	for (i = 0; i < numtextures; i++) {
+		if (texused[i]) {
+			lp->lumps[lp->numlumps++] = t_start + i;
+		}
+	}
+
+	for (i = 0; i < NUMSPRITES; i++) {
+		if (!sprused[i]) {
+			continue;
+		}
+
+		for (j = 0; j < spriteinfo[i].numframes; j++) {
+			spriteframe_t* sprframe = &spriteinfo[i].spriteframes[j];
+
+			for (k = 0; k < (sprframe->rotate ? 8 : 1); k++) {
+				lp->lumps[lp->numlumps++] = s_start + sprframe->lump[k];
+			}
 		}
 	}
 
+	free(texused);
+	free(sprused);
+
+	SDL_AtomicSet(&lp->done, 1);
 	return 0;
 }
 
+//
+// P_FinishLevelPrefetch
+// Wait for the thread and hand its findings to the wad code
+//
+
+static void P_FinishLevelPrefetch(void) {
+	int i;
+
+	if (levelprefetch.stage != LP_SCANNING) {
+		return;
+	}
+
+	SDL_WaitThread(levelprefetch.thread, NULL);
+	levelprefetch.thread = NULL;
+
+	for (i = 0; i < levelprefetch.numlumps; i++) {
+		W_PrefetchLump(levelprefetch.lumps[i]);
+	}
+
+	CON_DPrintf("P_PrefetchLevel: MAP%02d staged, %i lumps prefetched in %i ms\n",
+		levelprefetch.map, levelprefetch.numlumps,
+		(int)((I_GetTimeUS() - levelprefetch.starttime) / 1000));
+
+	free(levelprefetch.lumps);
+	levelprefetch.lumps = NULL;
+	levelprefetch.numlumps = 0;
+	levelprefetch.stage = LP_DONE;
+}
+
+//
+// P_CancelLevelPrefetch
+//
+
+static void P_CancelLevelPrefetch(void) {
+	P_FinishLevelPrefetch();
+
+	if (levelprefetch.data) {
+		W_ReleaseLumpNum(levelprefetch.lump);
+	}
+
+	levelprefetch.data = NULL;
+	levelprefetch.map = -1;
+	levelprefetch.stage = LP_IDLE;
+}
+
+//
+// P_PrefetchLevel
+// Called every tic while the next map is known but not loaded
+//
+
+void P_PrefetchLevel(int map) {
+	char name8[9];
+	int lump;
+	int i;
+
+	if (map != levelprefetch.map) {
+		P_CancelLevelPrefetch();
+
+		levelprefetch.map = map;
+		levelprefetch.stage = LP_DONE;
+		levelprefetch.starttime = I_GetTimeUS();
+
+		sprintf(name8, "MAP%02d", map);
+		name8[8] = 0;
+
+		if ((lump = W_CheckNumForName(name8)) == -1) {
+			return;
+		}
+
+		// standard doom map storage; just get the lumps moving
+		if (lump + 1 < numlumps && !dstrncmp(lumpinfo[lump + 1].name, "THINGS", 8)) {
+			for (i = ML_THINGS; i <= ML_MACROS && lump + i < numlumps; i++) {
+				W_PrefetchLump(lump + i);
+			}
+
+			return;
+		}
+
+		levelprefetch.lump = lump;
+		levelprefetch.stage = LP_READING;
+
+		// give the read a tic's head start
+		W_PrefetchLump(lump);
+		return;
+	}
+
+	switch (levelprefetch.stage) {
+	case LP_READING:
+		levelprefetch.data = (byte*)W_CacheLumpNum(levelprefetch.lump, PU_STATIC);
+		levelprefetch.length = W_LumpLength(levelprefetch.lump);
+
+		P_InitTextureHashTable();
+
+		SDL_AtomicSet(&levelprefetch.done, 0);
+		levelprefetch.thread = SDL_CreateThread(Thread_LevelPrefetch, "LevelPrefetch", &levelprefetch);
+		levelprefetch.stage = levelprefetch.thread ? LP_SCANNING : LP_DONE;
+		break;
+
+	case LP_SCANNING:
+		if (SDL_AtomicGet(&levelprefetch.done)) {
+			P_FinishLevelPrefetch();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
 //
 // P_LoadVertexes
 //
@@ -943,9 +1258,27 @@ void P_SetupPlanes(void) {
 
 void P_SetupLevel(int map, int playermask, skill_t skill) {
 	int i;
+	uint64_t start;
+	boolean staged;
 
 	CON_DPrintf("--------P_SetupLevel--------\n");
 
+	start = I_GetTimeUS();
+
+	// the staged lump is picked up by W_CacheMapLump as it's
+	// already cached; W_FreeMapLump lets go of it
+	staged = (levelprefetch.map == map && levelprefetch.data != NULL);
+
+	if (staged) {
+		P_FinishLevelPrefetch();
+		levelprefetch.data = NULL;
+		levelprefetch.map = -1;
+		levelprefetch.stage = LP_IDLE;
+	}
+	else {
+		P_CancelLevelPrefetch();
+	}
+
 	// [kex] 12/26/11 - don't reset total stats when loading a savegame
 	if (gameaction != ga_loadgame) {
 		totalkills = totalitems = totalsecret = 0;
@@ -986,6 +1319,7 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 	P_LoadNodes(ML_NODES);
 	P_LoadSegs();
 	P_LoadLeafs(ML_LEAFS);
+	R_SetupPVS();
 	P_LoadReject(ML_REJECT);
 	P_LoadLights(ML_LIGHTS);
 	P_GroupLines();
@@ -1025,6 +1359,8 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 	Z_CheckHeap();
 
 	CON_DPrintf("Used memory: %d kb\n", Z_FreeMemory() >> 10);
+	CON_DPrintf("MAP%02d loaded in %i ms%s\n", map, (int)((I_GetTimeUS() - start) / 1000),
+		staged ? " (prefetched)" : "");
 }
 
 //
@@ -1410,6 +1746,10 @@ int P_GetNumSkies(void) {
 //
 
 void P_Init(void) {
+	dmemset(&levelprefetch, 0, sizeof(levelprefetch_t));
+	levelprefetch.map = -1;
+	levelprefetch.stage = LP_IDLE;
+
 	SC_Init();
 	P_InitPicAnims();
 	R_InitSprites(sprnames);
@@ -31,6 +31,9 @@
 // NOT called by W_Ticker. Fixme.
 void P_SetupLevel(int map, int playermask, skill_t skill);
 
+// Get the next map ready while the intermission runs
+void P_PrefetchLevel(int map);
+
 // Called by startup code.
 void P_Init(void);
 
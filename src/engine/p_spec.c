@@ -643,6 +643,8 @@ static int P_ModifySector(line_t* line, int tag, int type) {
 			for (j = 0; j < 5; j++) {
 				sec1->colors[j] = sec2->colors[j];
 			}
+
+			R_InvalidateSectorLight(sec1);
 			break;
 		case mods_flats:
 			sec1->ceilingpic = sec2->ceilingpic;
@@ -699,6 +701,8 @@ int P_ModifySectorColor(line_t* line, int index, int type) {
 			sec->colors[LIGHT_LWRWALL] = index;
 			break;
 		}
+
+		R_InvalidateSectorLight(sec);
 	}
 
 	return rtn;
@@ -447,8 +447,11 @@ int P_Ticker(void) {
 	P_UpdateSpecials();
 	P_RunMacros();
 
-	ST_Ticker();
-	AM_Ticker();
+	// the HUD and automap already ticked the first time around
+	if (!netrollback) {
+		ST_Ticker();
+		AM_Ticker();
+	}
 
 	// for par times
 	leveltime++;
@@ -29,6 +29,7 @@
 
 #include "r_local.h"
 #include "r_clipper.h"
+#include "r_pvs.h"
 #include "i_system.h"
 #include "doomstat.h"
 #include "d_main.h"
@@ -547,6 +548,8 @@ static void AddSegToDrawlist(drawlist_t* dl, seg_t* line, int texid, int sidetyp
 	list = DL_AddVertexList(dl);
 	list->data = (seg_t*)line;
 
+	R_UpdateSegLineColor(line);
+
 	switch (sidetype) {
 	case 0:
 		list->callback = (vtxlist_callback_t)R_GenerateLowerSegPlane;
@@ -686,12 +689,21 @@ static void R_AddLine(seg_t* line) {
 
 void R_Subsector(int num) {
 	subsector_t* sub;
+	int count;
 
 	sub = &subsectors[num];
 	frontsector = sub->sector;
 
+	count = drawlist[DLT_WALL].index + drawlist[DLT_FLAT].index;
+
 	R_AddLeaf(sub);
 	R_AddSprites(sub);
+
+	pvsstats.traversed++;
+
+	if (drawlist[DLT_WALL].index + drawlist[DLT_FLAT].index != count) {
+		pvsstats.drawn++;
+	}
 }
 
 //
@@ -703,6 +715,10 @@ void R_RenderBSPNode(int bspnum) {
 	int     side;
 
 	while (!(bspnum & NF_SUBSECTOR)) {
+		if (!R_CheckPVS(bspnum)) {
+			return;
+		}
+
 		bsp = &nodes[bspnum];
 
 		// Decide which side the view point is on.
@@ -728,6 +744,10 @@ void R_RenderBSPNode(int bspnum) {
 		//CON_Warnf("R_RenderBSPNode: bspnum = -1!\n");
 	}
 
+	if (!R_CheckPVS(bspnum | NF_SUBSECTOR)) {
+		return;
+	}
+
 	R_Subsector(bspnum & ~NF_SUBSECTOR);
 }
 
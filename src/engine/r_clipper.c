@@ -29,6 +29,9 @@
 #include "tables.h"
 #include "m_fixed.h"
 #include "z_zone.h"
+#include "i_system.h"
+#include "con_console.h"
+#include "g_actions.h"
 #include <math.h>
 
 static GLdouble viewMatrix[16];
@@ -53,6 +56,150 @@ static void R_Clipper_AddClipRange(angle_t start, angle_t end);
 static void R_Clipper_RemoveRange(clipnode_t* range);
 static void R_Clipnode_Free(clipnode_t* node);
 
+//
+// Angle buffer clipper
+//
+// The circle of view angles is cut into a fixed number of bins,
+// one bit each. A bin is only marked once an occluding range
+// covers all of it, so the buffer never hides something the
+// range list would show. Tests and updates work on 64 bins at a
+// time. Selected with r_clippermode 1
+//
+
+#define ANGLEBUFFER_BITS    16
+#define ANGLEBUFFER_SHIFT   (32 - ANGLEBUFFER_BITS)
+#define ANGLEBUFFER_WORDS   ((1 << ANGLEBUFFER_BITS) / 64)
+
+static uint64_t anglebuffer[ANGLEBUFFER_WORDS];
+
+enum {
+	CLIPPER_RANGELIST,
+	CLIPPER_ANGLEBUFFER
+};
+
+CVAR(r_clippermode, 0);
+
+// clipperbench records one frame of clipper calls and replays
+// them against both clippers
+typedef struct {
+	angle_t start;
+	angle_t end;
+	boolean add;
+} clipop_t;
+
+enum {
+	CLIPBENCH_OFF,
+	CLIPBENCH_ARMED,
+	CLIPBENCH_RECORDING
+};
+
+static clipop_t* clipops = NULL;
+static int numclipops = 0;
+static int maxclipops = 0;
+static int clipbench = CLIPBENCH_OFF;
+
+//
+// R_AngleBuffer_Mask
+// Returns the bits of word w that fall within bins first to last
+//
+
+d_inline static uint64_t R_AngleBuffer_Mask(int w, int first, int last) {
+	uint64_t mask = ~(uint64_t)0;
+
+	if (w == (first >> 6)) {
+		mask &= ~(uint64_t)0 << (first & 63);
+	}
+
+	if (w == (last >> 6)) {
+		mask &= ~(uint64_t)0 >> (63 - (last & 63));
+	}
+
+	return mask;
+}
+
+//
+// R_AngleBuffer_IsRangeVisible
+//
+
+static boolean R_AngleBuffer_IsRangeVisible(angle_t startAngle, angle_t endAngle) {
+	int first = startAngle >> ANGLEBUFFER_SHIFT;
+	int last = endAngle >> ANGLEBUFFER_SHIFT;
+	int w;
+
+	for (w = first >> 6; w <= (last >> 6); w++) {
+		uint64_t mask = R_AngleBuffer_Mask(w, first, last);
+
+		if ((anglebuffer[w] & mask) != mask) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// R_AngleBuffer_AddClipRange
+//
+
+static void R_AngleBuffer_AddClipRange(angle_t start, angle_t end) {
+	int64_t first;
+	int64_t last;
+	int w;
+
+	// only bins that lie entirely inside the range
+	first = ((int64_t)start + (1 << ANGLEBUFFER_SHIFT) - 1) >> ANGLEBUFFER_SHIFT;
+	last = (((int64_t)end + 1) >> ANGLEBUFFER_SHIFT) - 1;
+
+	if (first > last) {
+		return;
+	}
+
+	for (w = (int)(first >> 6); w <= (int)(last >> 6); w++) {
+		anglebuffer[w] |= R_AngleBuffer_Mask(w, (int)first, (int)last);
+	}
+}
+
+//
+// R_Clipper_Check
+//
+
+static boolean R_Clipper_Check(int mode, angle_t startAngle, angle_t endAngle) {
+	if (mode == CLIPPER_ANGLEBUFFER) {
+		return R_AngleBuffer_IsRangeVisible(startAngle, endAngle);
+	}
+
+	return R_Clipper_IsRangeVisible(startAngle, endAngle);
+}
+
+//
+// R_Clipper_Add
+//
+
+static void R_Clipper_Add(int mode, angle_t start, angle_t end) {
+	if (mode == CLIPPER_ANGLEBUFFER) {
+		R_AngleBuffer_AddClipRange(start, end);
+	}
+	else {
+		R_Clipper_AddClipRange(start, end);
+	}
+}
+
+//
+// R_Clipper_Record
+//
+
+static void R_Clipper_Record(angle_t start, angle_t end, boolean add) {
+	if (numclipops == maxclipops) {
+		maxclipops = maxclipops ? maxclipops * 2 : 4096;
+		clipops = (clipop_t*)realloc(clipops, maxclipops * sizeof(clipop_t));
+	}
+
+	clipops[numclipops].start = start;
+	clipops[numclipops].end = end;
+	clipops[numclipops].add = add;
+	numclipops++;
+}
+
 static clipnode_t* R_Clipnode_GetNew(void) {
 	if (freelist) {
 		clipnode_t* p = freelist;
@@ -76,11 +223,17 @@ static clipnode_t* R_Clipnode_NewRange(angle_t start, angle_t end) {
 //
 
 boolean R_Clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle) {
+	int mode = (int)r_clippermode.value;
+
+	if (clipbench == CLIPBENCH_RECORDING) {
+		R_Clipper_Record(startAngle, endAngle, false);
+	}
+
 	if (startAngle > endAngle)
-		return (R_Clipper_IsRangeVisible(startAngle, ANGLE_MAX) ||
-			R_Clipper_IsRangeVisible(0, endAngle));
+		return (R_Clipper_Check(mode, startAngle, ANGLE_MAX) ||
+			R_Clipper_Check(mode, 0, endAngle));
 
-	return R_Clipper_IsRangeVisible(startAngle, endAngle);
+	return R_Clipper_Check(mode, startAngle, endAngle);
 }
 
 static boolean R_Clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle) {
@@ -129,14 +282,20 @@ static void R_Clipper_RemoveRange(clipnode_t* range) {
 //
 
 void R_Clipper_SafeAddClipRange(angle_t startangle, angle_t endangle) {
+	int mode = (int)r_clippermode.value;
+
+	if (clipbench == CLIPBENCH_RECORDING) {
+		R_Clipper_Record(startangle, endangle, true);
+	}
+
 	if (startangle > endangle) {
 		// The range has to added in two parts.
-		R_Clipper_AddClipRange(startangle, ANGLE_MAX);
-		R_Clipper_AddClipRange(0, endangle);
+		R_Clipper_Add(mode, startangle, ANGLE_MAX);
+		R_Clipper_Add(mode, 0, endangle);
 	}
 	else {
 		// Add the range as usual.
-		R_Clipper_AddClipRange(startangle, endangle);
+		R_Clipper_Add(mode, startangle, endangle);
 	}
 }
 
@@ -227,10 +386,10 @@ static void R_Clipper_AddClipRange(angle_t start, angle_t end) {
 }
 
 //
-// R_Clipper_Clear
+// R_Clipper_ClearAll
 //
 
-void R_Clipper_Clear(void) {
+static void R_Clipper_ClearAll(void) {
 	clipnode_t* node = cliphead;
 	clipnode_t* temp;
 
@@ -241,6 +400,99 @@ void R_Clipper_Clear(void) {
 	}
 
 	cliphead = NULL;
+
+	dmemset(anglebuffer, 0, sizeof(anglebuffer));
+}
+
+//
+// R_Clipper_RunBench
+// Replays the recorded frame through each clipper
+//
+
+#define CLIPBENCH_PASSES    100
+
+static void R_Clipper_RunBench(void) {
+	static const char* names[2] = { "Range list", "Angle buffer" };
+	int mode;
+
+	for (mode = CLIPPER_RANGELIST; mode <= CLIPPER_ANGLEBUFFER; mode++) {
+		uint64_t start;
+		uint64_t time;
+		int visible = 0;
+		int checks = 0;
+		int pass;
+		int i;
+
+		start = I_GetTimeUS();
+
+		for (pass = 0; pass < CLIPBENCH_PASSES; pass++) {
+			R_Clipper_ClearAll();
+			visible = checks = 0;
+
+			for (i = 0; i < numclipops; i++) {
+				clipop_t* op = &clipops[i];
+
+				if (op->add) {
+					if (op->start > op->end) {
+						R_Clipper_Add(mode, op->start, ANGLE_MAX);
+						R_Clipper_Add(mode, 0, op->end);
+					}
+					else {
+						R_Clipper_Add(mode, op->start, op->end);
+					}
+				}
+				else {
+					checks++;
+
+					if (op->start > op->end) {
+						visible += (R_Clipper_Check(mode, op->start, ANGLE_MAX) ||
+							R_Clipper_Check(mode, 0, op->end));
+					}
+					else {
+						visible += R_Clipper_Check(mode, op->start, op->end);
+					}
+				}
+			}
+		}
+
+		time = I_GetTimeUS() - start;
+
+		CON_Printf(WHITE, "%s: %i us per frame, %i of %i ranges visible\n",
+			names[mode], (int)(time / CLIPBENCH_PASSES), visible, checks);
+	}
+}
+
+//
+// R_Clipper_Clear
+//
+
+void R_Clipper_Clear(void) {
+	if (clipbench == CLIPBENCH_RECORDING) {
+		R_Clipper_RunBench();
+		clipbench = CLIPBENCH_OFF;
+	}
+	else if (clipbench == CLIPBENCH_ARMED) {
+		numclipops = 0;
+		clipbench = CLIPBENCH_RECORDING;
+	}
+
+	R_Clipper_ClearAll();
+}
+
+//
+// CMD_ClipperBench
+//
+
+static CMD(ClipperBench) {
+	clipbench = CLIPBENCH_ARMED;
+}
+
+//
+// R_InitClipper
+//
+
+void R_InitClipper(void) {
+	G_AddCommand("clipperbench", CMD_ClipperBench, 0);
 }
 
 //
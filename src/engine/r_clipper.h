@@ -27,6 +27,7 @@
 boolean    R_Clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle);
 void        R_Clipper_SafeAddClipRange(angle_t startangle, angle_t endangle);
 void        R_Clipper_Clear(void);
+void        R_InitClipper(void);
 
 extern float frustum[6][4];
 
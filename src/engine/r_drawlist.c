@@ -23,25 +23,72 @@
 // DESCRIPTION: Vertex draw lists.
 // Stores geometry info produced by R_RenderBSPNode into a list for optimal rendering
 //
+// DL_GenerateDrawList builds the vertices of a whole list ahead of
+// submission. The sorted list is cut into contiguous ranges that
+// worker threads fill in parallel, each into its own slice of the
+// list's vertex arena, so the result doesn't depend on which thread
+// finishes first. DL_ProcessDrawList then only has to copy them.
+//
+// With the world program bound the glow of each entry goes out
+// per vertex instead of through the texture environment, so runs
+// of the same texture are drawn together whatever their light.
+//
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+
+#ifdef __OpenBSD__
+#include <SDL.h>
+#else
+#include <SDL3/SDL.h>
+#endif
+
 #include "doomdef.h"
 #include "doomstat.h"
 #include "d_devstat.h"
 #include "r_local.h"
 #include "gl_texture.h"
 #include "gl_main.h"
+#include "gl_shader.h"
 #include "r_drawlist.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "con_console.h"
+
+#define DL_MAXWORKERS   8
+#define DL_MINJOBSIZE   64      // shorter lists aren't worth waking the workers for
+
+// a run is drawn early once it gets this long, which keeps it well
+// inside drawVertex and the index buffer in dgl.c
+#define DL_MAXRUNVERTICES   (MAXDLDRAWCOUNT / 4)
 
 vtx_t drawVertex[MAXDLDRAWCOUNT];
 
+static float drawGlow[MAXDLDRAWCOUNT];
+static boolean dlworldprogram = false;
+
 static float envcolor[4] = { 0, 0, 0, 0 };
 
 drawlist_t drawlist[NUMDRAWLISTS];
 
+typedef struct {
+	vtxlist_t* list;
+	int                 start;
+	int                 end;
+	vtxlist_generate_t  genfunc;
+} dljob_t;
+
+static dljob_t dljobs[DL_MAXWORKERS + 1];
+static SDL_Thread* dlthreads[DL_MAXWORKERS];
+static SDL_Semaphore* dlwake[DL_MAXWORKERS];
+static SDL_Semaphore* dldone;
+static SDL_AtomicInt dlquit;
+static int numdlworkers = -1;   // not started yet
+
+CVAR(r_renderthreads, 1);
+
 CVAR_EXTERNAL(r_texturecombiner);
+CVAR_EXTERNAL(st_flashoverlay);
 
 //
 // DL_AddVertexList
@@ -95,6 +142,200 @@ static int SortSprites(const void* a, const void* b) {
 	return xb->dist - xa->dist;
 }
 
+//
+// DL_SortDrawList
+//
+
+static void DL_SortDrawList(drawlist_t* dl, int tag) {
+	if (dl->sorted) {
+		return;
+	}
+
+	if (tag != DLT_SPRITE) {
+		qsort(dl->list, dl->index, sizeof(vtxlist_t), SortDrawList);
+	}
+	else if (dl->index >= 2) {
+		qsort(dl->list, dl->index, sizeof(vtxlist_t), SortSprites);
+	}
+
+	dl->sorted = true;
+}
+
+//
+// DL_RunJob
+//
+
+static void DL_RunJob(dljob_t* job) {
+	int i;
+
+	for (i = job->start; i < job->end; i++) {
+		vtxlist_t* vl = &job->list[i];
+
+		vl->numvertices = job->genfunc(vl, vl->vertices);
+	}
+}
+
+//
+// Thread_DrawListWorker
+//
+
+static int SDLCALL Thread_DrawListWorker(void* data) {
+	int worker = (int)(intptr_t)data;
+
+	while (1) {
+		SDL_WaitSemaphore(dlwake[worker]);
+
+		if (SDL_AtomicGet(&dlquit)) {
+			break;
+		}
+
+		DL_RunJob(&dljobs[worker + 1]);
+		SDL_PostSemaphore(dldone);
+	}
+
+	return 0;
+}
+
+//
+// DL_StartWorkers
+//
+
+static void DL_StartWorkers(void) {
+	int i;
+
+	numdlworkers = MAX(0, MIN(SDL_GetCPUCount() - 1, DL_MAXWORKERS));
+	dldone = SDL_CreateSemaphore(0);
+	SDL_AtomicSet(&dlquit, 0);
+
+	for (i = 0; i < numdlworkers; i++) {
+		dlwake[i] = SDL_CreateSemaphore(0);
+		dlthreads[i] = SDL_CreateThread(Thread_DrawListWorker, "DrawList", (void*)(intptr_t)i);
+
+		if (dlthreads[i] == NULL) {
+			SDL_DestroySemaphore(dlwake[i]);
+			numdlworkers = i;
+			break;
+		}
+	}
+
+	CON_DPrintf("DL_StartWorkers: %i worker threads\n", numdlworkers);
+}
+
+//
+// DL_Shutdown
+// Stops the worker threads. Only called from the main thread
+// between frames, so none of them are in the middle of a job
+//
+
+void DL_Shutdown(void) {
+	int i;
+
+	if (numdlworkers < 0) {
+		return;
+	}
+
+	SDL_AtomicSet(&dlquit, 1);
+
+	for (i = 0; i < numdlworkers; i++) {
+		SDL_PostSemaphore(dlwake[i]);
+	}
+
+	for (i = 0; i < numdlworkers; i++) {
+		SDL_WaitThread(dlthreads[i], NULL);
+		SDL_DestroySemaphore(dlwake[i]);
+		dlthreads[i] = NULL;
+		dlwake[i] = NULL;
+	}
+
+	SDL_DestroySemaphore(dldone);
+	dldone = NULL;
+
+	// don't start them again while quitting
+	numdlworkers = 0;
+}
+
+//
+// DL_GenerateDrawList
+// Sorts the list and fills in the vertices of every entry.
+// genfunc returns how many vertices it wrote, at most what
+// countfunc reserved for that entry. It runs on worker threads
+// so it may only read the level and write its own vertices
+//
+
+void DL_GenerateDrawList(int tag, vtxlist_count_t countfunc, vtxlist_generate_t genfunc) {
+	drawlist_t* dl;
+	int count;
+	int total;
+	int workers;
+	int chunk;
+	int i;
+
+	if (tag < 0 || tag >= NUMDRAWLISTS) {
+		return;
+	}
+
+	dl = &drawlist[tag];
+
+	if (dl->max <= 0) {
+		return;
+	}
+
+	DL_SortDrawList(dl, tag);
+
+	total = 0;
+
+	for (count = 0; count < dl->index && dl->list[count].data; count++) {
+		dl->list[count].numvertices = countfunc(&dl->list[count]);
+		total += dl->list[count].numvertices;
+	}
+
+	if (total > dl->maxvertices) {
+		dl->maxvertices = total + (total >> 1);
+		dl->vertices = (vtx_t*)realloc(dl->vertices, dl->maxvertices * sizeof(vtx_t));
+
+		if (dl->vertices == NULL) {
+			I_Error("DL_GenerateDrawList: Failed to allocate %i vertices", dl->maxvertices);
+		}
+	}
+
+	total = 0;
+
+	for (i = 0; i < count; i++) {
+		dl->list[i].vertices = &dl->vertices[total];
+		total += dl->list[i].numvertices;
+	}
+
+	workers = 0;
+
+	if (r_renderthreads.value > 0 && count >= DL_MINJOBSIZE) {
+		if (numdlworkers < 0) {
+			DL_StartWorkers();
+		}
+
+		workers = MIN(numdlworkers, count / DL_MINJOBSIZE);
+	}
+
+	chunk = (count + workers) / (workers + 1);
+
+	for (i = 0; i <= workers; i++) {
+		dljobs[i].list = dl->list;
+		dljobs[i].start = MIN(i * chunk, count);
+		dljobs[i].end = MIN((i + 1) * chunk, count);
+		dljobs[i].genfunc = genfunc;
+	}
+
+	for (i = 0; i < workers; i++) {
+		SDL_PostSemaphore(dlwake[i]);
+	}
+
+	// the main thread takes the first range
+	DL_RunJob(&dljobs[0]);
+
+	for (i = 0; i < workers; i++) {
+		SDL_WaitSemaphore(dldone);
+	}
+}
+
 //
 // DL_ProcessDrawList
 //
@@ -102,6 +343,8 @@ static int SortSprites(const void* a, const void* b) {
 void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 	drawlist_t* dl;
 	int i;
+	int j;
+	int first;
 	int drawcount = 0;
 	vtxlist_t* head;
 	vtxlist_t* tail;
@@ -116,12 +359,7 @@ void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 	if (dl->max > 0) {
 		int palette = 0;
 
-		if (tag != DLT_SPRITE) {
-			qsort(dl->list, dl->index, sizeof(vtxlist_t), SortDrawList);
-		}
-		else if (dl->index >= 2) {
-			qsort(dl->list, dl->index, sizeof(vtxlist_t), SortSprites);
-		}
+		DL_SortDrawList(dl, tag);
 
 		tail = &dl->list[dl->index];
 
@@ -135,9 +373,7 @@ void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 				break;
 			}
 
-			if (drawcount >= MAXDLDRAWCOUNT) {
-				I_Error("DL_ProcessDrawList: Draw overflow by %i, tag=%i", dl->index, tag);
-			}
+			first = drawcount;
 
 			if (procfunc) {
 				if (!procfunc(head, &drawcount)) {
@@ -145,11 +381,19 @@ void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 				}
 			}
 
+			if (dlworldprogram) {
+				float glow = (float)head->params / 255.0f;
+
+				for (j = first; j < drawcount; j++) {
+					drawGlow[j] = glow;
+				}
+			}
+
 			rover = head + 1;
 
 			if (tag != DLT_SPRITE) {
-				if (rover != tail) {
-					if (head->texid == rover->texid && head->params == rover->params) {
+				if (rover != tail && head->texid == rover->texid && drawcount < DL_MAXRUNVERTICES) {
+					if (head->params == rover->params || dlworldprogram) {
 						continue;
 					}
 				}
@@ -189,11 +433,12 @@ void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 					head->flags & DLF_MIRRORT ? GL_MIRRORED_REPEAT : GL_REPEAT);
 			}
 
-			if (r_texturecombiner.value > 0) {
+			// with the world program the glow is already in drawGlow
+			if (!dlworldprogram && r_texturecombiner.value > 0) {
 				envcolor[0] = envcolor[1] = envcolor[2] = ((float)head->params / 255.0f);
 				GL_SetEnvColor(envcolor);
 			}
-			else {
+			else if (!dlworldprogram) {
 				int l = (head->params >> 1);
 
 				GL_UpdateEnvTexture(D_RGBA(l, l, l, 0xff));
@@ -209,6 +454,8 @@ void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*)) {
 			drawcount = 0;
 			head->data = NULL;
 		}
+
+		dl->sorted = false;
 	}
 }
 
@@ -247,6 +494,27 @@ void DL_BeginDrawList(boolean t, boolean a) {
 	}
 }
 
+//
+// DL_SetWorldProgram
+// Draws the lists through the world program instead of the
+// texture combiners set up by R_RenderWorld
+//
+
+void DL_SetWorldProgram(boolean enable) {
+	if (enable == dlworldprogram) {
+		return;
+	}
+
+	if (enable) {
+		GL_BeginWorldProgram(drawGlow, !nolights, st_flashoverlay.value <= 0 ? flashcolor : 0);
+	}
+	else {
+		GL_EndWorldProgram();
+	}
+
+	dlworldprogram = enable;
+}
+
 //
 // DL_Init
 // Intialize draw lists
@@ -261,6 +529,7 @@ void DL_Init(void) {
 
 		dl->index = 0;
 		dl->max = 1;
+		dl->sorted = false;
 		dl->list = Z_Calloc(sizeof(vtxlist_t) * dl->max, PU_LEVEL, 0);
 	}
 }
\ No newline at end of file
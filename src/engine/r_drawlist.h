@@ -53,14 +53,22 @@ typedef struct {
 	dtexture    texid;
 	int         flags;
 	int         params;
+	vtx_t* vertices;       // set by DL_GenerateDrawList
+	int         numvertices;
 } vtxlist_t;
 
 typedef struct {
 	vtxlist_t* list;
 	int         index;
 	int         max;
+	boolean     sorted;
+	vtx_t* vertices;
+	int         maxvertices;
 } drawlist_t;
 
+typedef int(*vtxlist_count_t) (vtxlist_t*);
+typedef int(*vtxlist_generate_t) (vtxlist_t*, vtx_t*);
+
 extern drawlist_t drawlist[NUMDRAWLISTS];
 
 #define MAXDLDRAWCOUNT  0x10000
@@ -73,8 +81,11 @@ boolean DL_ProcessSprites(vtxlist_t* vl, int* drawcount);
 vtxlist_t* DL_AddVertexList(drawlist_t* dl);
 int DL_GetDrawListSize(int tag);
 void DL_BeginDrawList(boolean t, boolean a);
+void DL_GenerateDrawList(int tag, vtxlist_count_t countfunc, vtxlist_generate_t genfunc);
 void DL_ProcessDrawList(int tag, boolean(*procfunc)(vtxlist_t*, int*));
 void DL_RenderDrawList(void);
+void DL_SetWorldProgram(boolean enable);
 void DL_Init(void);
+void DL_Shutdown(void);
 
 #endif
\ No newline at end of file
@@ -32,8 +32,20 @@
 #include "r_local.h"
 #include "d_keywds.h"
 #include "p_local.h"
+#include "z_zone.h"
 
-rcolor    bspColor[5];
+// wall colours for each side type passed to R_SetSegLineColor,
+// along with what they were worked out from
+typedef struct {
+	int         lightgen;
+	int         frontstamp;
+	int         backstamp;
+	rcolor      colors[4][4];
+} segcolor_t;
+
+static segcolor_t* segcolors = NULL;
+static int lightgeneration = 1;
+static int sectorstamp = 0;
 
 CVAR_CMD(i_brightness, 100) {
 	R_RefreshBrightness();
@@ -235,6 +247,8 @@ void R_SetLightFactor(float lightfactor) {
 		light->active_g = light->base_g;
 		light->active_b = light->base_b;
 	}
+
+	R_InvalidateLightCache();
 }
 
 //
@@ -262,7 +276,7 @@ rcolor R_GetSectorLight(byte alpha, word ptr) {
 // R_SplitLineColor
 //
 
-rcolor R_SplitLineColor(seg_t* line, byte side) {
+static rcolor R_SplitLineColor(seg_t* line, byte side, rcolor* colors) {
 	int height = 0;
 	int sideheight1 = 0;
 	int sideheight2 = 0;
@@ -272,8 +286,8 @@ rcolor R_SplitLineColor(seg_t* line, byte side) {
 	rcolor d3dc2 = 0;
 
 	height = (line->frontsector->ceilingheight - line->frontsector->floorheight) / FRACUNIT;
-	d3dc1 = bspColor[LIGHT_UPRWALL];
-	d3dc2 = bspColor[LIGHT_LWRWALL];
+	d3dc1 = colors[LIGHT_UPRWALL];
+	d3dc2 = colors[LIGHT_LWRWALL];
 
 	b1 = (float)((d3dc1 >> 16) & 0xff);
 	g1 = (float)((d3dc1 >> 8) & 0xff);
@@ -304,19 +318,24 @@ rcolor R_SplitLineColor(seg_t* line, byte side) {
 }
 
 //
-// R_SetSegLineColor
+// R_CalcSegLineColor
 //
 
-void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side) {
+static void R_CalcSegLineColor(seg_t* line, byte side, rcolor* c) {
 	int i;
-	rcolor c[4];
+	rcolor colors[5];
 	byte lwr = LIGHT_LWRWALL;
 	byte upr = LIGHT_UPRWALL;
+	sector_t* sec = line->frontsector;
+
+	colors[LIGHT_THING] = R_GetSectorLight(0xff, sec->colors[LIGHT_THING]);
+	colors[LIGHT_UPRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_UPRWALL]);
+	colors[LIGHT_LWRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_LWRWALL]);
 
 	if (line->linedef->flags & ML_BLENDING) {
 		if (line->backsector && side != 0) {
 			if (!(line->linedef->flags & ML_BLENDFULLTOP) && side == 1) {
-				c[2] = R_SplitLineColor(line, 1);
+				c[2] = R_SplitLineColor(line, 1, colors);
 				c[3] = c[2];
 			}
 			else {
@@ -324,11 +343,11 @@ void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side) {
 					lwr = LIGHT_UPRWALL;
 				}
 
-				c[2] = bspColor[lwr];
-				c[3] = bspColor[lwr];
+				c[2] = colors[lwr];
+				c[3] = colors[lwr];
 			}
 			if (!(line->linedef->flags & ML_BLENDFULLBOTTOM) && side == 2) {
-				c[0] = R_SplitLineColor(line, 2);
+				c[0] = R_SplitLineColor(line, 2, colors);
 				c[1] = c[0];
 			}
 			else {
@@ -336,42 +355,111 @@ void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side) {
 					upr = LIGHT_LWRWALL;
 				}
 
-				c[0] = bspColor[upr];
-				c[1] = bspColor[upr];
+				c[0] = colors[upr];
+				c[1] = colors[upr];
 			}
 			if (side == 3) { // midtexture
 				if (line->backsector->ceilingheight < line->frontsector->ceilingheight) {
-					c[0] = R_SplitLineColor(line, 1);
+					c[0] = R_SplitLineColor(line, 1, colors);
 					c[1] = c[0];
 				}
 				else {
-					c[0] = bspColor[LIGHT_UPRWALL];
-					c[1] = bspColor[LIGHT_UPRWALL];
+					c[0] = colors[LIGHT_UPRWALL];
+					c[1] = colors[LIGHT_UPRWALL];
 				}
 				if (line->backsector->floorheight > line->frontsector->floorheight) {
-					c[2] = R_SplitLineColor(line, 2);
+					c[2] = R_SplitLineColor(line, 2, colors);
 					c[3] = c[2];
 				}
 				else {
-					c[2] = bspColor[LIGHT_LWRWALL];
-					c[3] = bspColor[LIGHT_LWRWALL];
+					c[2] = colors[LIGHT_LWRWALL];
+					c[3] = colors[LIGHT_LWRWALL];
 				}
 			}
 		}
 		else {
-			c[0] = bspColor[LIGHT_UPRWALL];
-			c[1] = bspColor[LIGHT_UPRWALL];
-			c[2] = bspColor[LIGHT_LWRWALL];
-			c[3] = bspColor[LIGHT_LWRWALL];
+			c[0] = colors[LIGHT_UPRWALL];
+			c[1] = colors[LIGHT_UPRWALL];
+			c[2] = colors[LIGHT_LWRWALL];
+			c[3] = colors[LIGHT_LWRWALL];
 		}
 	}
 	else {
 		for (i = 0; i < 4; i++) {
-			c[i] = bspColor[LIGHT_THING];
+			c[i] = colors[LIGHT_THING];
+		}
+	}
+}
+
+//
+// R_UpdateSegLineColor
+// Works the seg's colours out again if its sectors or the
+// lights have changed since they were cached. Called during
+// BSP traversal so the vertex generators only read the cache
+//
+
+void R_UpdateSegLineColor(seg_t* line) {
+	segcolor_t* cache = &segcolors[line - segs];
+	int backstamp = line->backsector ? line->backsector->lightstamp : 0;
+	byte side;
+
+	if (cache->lightgen == lightgeneration &&
+		cache->frontstamp == line->frontsector->lightstamp &&
+		cache->backstamp == backstamp) {
+		return;
+	}
+
+	R_CalcSegLineColor(line, 0, cache->colors[0]);
+
+	// only two sided lines blend the upper, lower and middle parts
+	if (line->backsector) {
+		for (side = 1; side < 4; side++) {
+			R_CalcSegLineColor(line, side, cache->colors[side]);
 		}
 	}
 
+	cache->lightgen = lightgeneration;
+	cache->frontstamp = line->frontsector->lightstamp;
+	cache->backstamp = backstamp;
+}
+
+//
+// R_SetSegLineColor
+//
+
+void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side) {
+	rcolor* c = segcolors[line - segs].colors[side];
+	int i;
+
 	for (i = 0; i < 4; i++) {
 		*(rcolor*)&v[i].r = c[i];
 	}
+}
+
+//
+// R_InvalidateSectorLight
+// The sector's heights or colour indexes have changed
+//
+
+void R_InvalidateSectorLight(sector_t* sector) {
+	sector->lightstamp = ++sectorstamp;
+}
+
+//
+// R_InvalidateLightCache
+// A light's colour has changed. Lights are shared between
+// sectors so every cached wall is done again
+//
+
+void R_InvalidateLightCache(void) {
+	lightgeneration++;
+}
+
+//
+// R_InitSegColors
+//
+
+void R_InitSegColors(void) {
+	segcolors = (segcolor_t*)Z_Calloc(numsegs * sizeof(segcolor_t), PU_LEVEL, 0);
+	R_InvalidateLightCache();
 }
\ No newline at end of file
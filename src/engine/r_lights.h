@@ -34,12 +34,14 @@ enum {
 	LIGHT_LWRWALL
 };
 
-extern rcolor    bspColor[5];
-
 rcolor R_GetSectorLight(byte alpha, word ptr);
 void R_SetLightFactor(float lightfactor);
 void R_RefreshBrightness(void);
 void R_LightToVertex(vtx_t* v, int idx, word c);
+void R_UpdateSegLineColor(seg_t* line);
 void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side);
+void R_InvalidateSectorLight(sector_t* sector);
+void R_InvalidateLightCache(void);
+void R_InitSegColors(void);
 
 #endif
@@ -34,6 +34,9 @@
 #include "r_local.h"
 #include "r_sky.h"
 #include "r_clipper.h"
+#include "r_pvs.h"
+#include "r_occlude.h"
+#include "r_sprinst.h"
 #include "gl_texture.h"
 #include "gl_main.h"
 #include "m_fixed.h"
@@ -76,6 +79,10 @@ int             logoAlpha = 0;
 int             vertCount = 0;
 unsigned int    renderTic = 0;
 unsigned int    spriteRenderTic = 0;
+unsigned int    bspTraverseTime = 0;    // stage timings in microseconds
+unsigned int    geometryTime = 0;
+unsigned int    spriteSetupTime = 0;
+unsigned int    worldSubmitTime = 0;
 unsigned int    glBindCalls = 0;
 
 boolean        bRenderSky = false;
@@ -103,7 +110,20 @@ CVAR_CMD(r_anisotropic, 1) {
 	GL_SetTextureFilter();
 }
 
+CVAR_CMD(r_mipmaps, 1) {
+	GL_DumpTextures();
+}
+
 CVAR_EXTERNAL(r_texturecombiner);
+CVAR_EXTERNAL(r_texturecompression);
+CVAR_EXTERNAL(r_texturebudget);
+CVAR_EXTERNAL(r_clippermode);
+CVAR_EXTERNAL(r_renderthreads);
+CVAR_EXTERNAL(r_pvs);
+CVAR_EXTERNAL(r_occlusion);
+CVAR_EXTERNAL(r_spriteinstancing);
+CVAR_EXTERNAL(r_shaders);
+CVAR_EXTERNAL(r_streambuffer);
 CVAR_EXTERNAL(i_interpolateframes);
 CVAR_EXTERNAL(p_usecontext);
 
@@ -268,6 +288,11 @@ void R_Init(void) {
 
 	GL_InitTextures();
 	GL_ResetTextures();
+
+	R_InitClipper();
+	R_InitPVS();
+	R_InitOcclusion();
+	R_InitSpriteInstancing();
 }
 
 //
@@ -317,6 +342,7 @@ void R_SetViewOffset(int offset) {
 
 void R_SetupLevel(void) {
 	R_AllocSubsectorBuffer();
+	R_InitSegColors();
 	R_RefreshBrightness();
 
 	DL_Init();
@@ -324,6 +350,39 @@ void R_SetupLevel(void) {
 	bRenderSky = true;
 }
 
+//
+// R_PrefetchLevel
+// Ask for every lump R_PrecacheLevel is about to bind, so
+// compressed ones can be unpacked in the background while
+// the earlier ones upload
+//
+
+static void R_PrefetchLevel(char* texturepresent, char* spritepresent) {
+	int i;
+	int k;
+	int p;
+
+	for (i = 0; i < numtextures; i++) {
+		if (texturepresent[i]) {
+			W_PrefetchLump(t_start + i);
+		}
+	}
+
+	for (i = 0; i < NUMSPRITES; i++) {
+		if (!spritepresent[i]) {
+			continue;
+		}
+
+		for (k = 0; k < spriteinfo[i].numframes; k++) {
+			spriteframe_t* sprframe = &spriteinfo[i].spriteframes[k];
+
+			for (p = 0; p < (sprframe->rotate ? 8 : 1); p++) {
+				W_PrefetchLump(s_start + sprframe->lump[p]);
+			}
+		}
+	}
+}
+
 //
 // R_PrecacheLevel
 // Loads and binds all world textures before level startup
@@ -339,7 +398,11 @@ void R_PrecacheLevel(void) {
 	mobj_t* mo;
 
 	CON_DPrintf("--------R_PrecacheLevel--------\n");
-	GL_DumpTextures();
+
+	// textures from the last level stay loaded, so the ones this
+	// level shares with it are already there. The rest are left
+	// for the residency budget to evict
+	GL_ResetTextures();
 
 	texturepresent = (char*)Z_Alloca(numtextures);
 	spritepresent = (char*)Z_Alloca(NUMSPRITES);
@@ -359,6 +422,12 @@ void R_PrecacheLevel(void) {
 		}
 	}
 
+	for (mo = mobjhead.next; mo != &mobjhead; mo = mo->next) {
+		spritepresent[mo->sprite] = 1;
+	}
+
+	R_PrefetchLevel(texturepresent, spritepresent);
+
 	num = 0;
 
 	for (i = 0; i < numtextures; i++) {
@@ -388,10 +457,6 @@ void R_PrecacheLevel(void) {
 
 	CON_DPrintf("%i world textures cached\n", num);
 
-	for (mo = mobjhead.next; mo != &mobjhead; mo = mo->next) {
-		spritepresent[mo->sprite] = 1;
-	}
-
 	num = 0;
 
 	//
@@ -687,6 +752,7 @@ static void R_DrawContextWall(line_t* line) {
 //
 
 void R_RenderPlayerView(player_t* player) {
+	uint64_t stagetime = 0;
 
 	if (!r_fillmode.value) {
 		dglPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -737,11 +803,34 @@ void R_RenderPlayerView(player_t* player) {
 		R_InterpolateSectors();
 	}
 
+	//
+	// pick the visible set for where the view is
+	//
+	R_SetupPVSView();
+
 	//
 	// traverse BSP for rendering
 	//
+	if (devparm) {
+		stagetime = I_GetTimeUS();
+	}
+
 	R_RenderBSPNode(numnodes - 1);
 
+	if (devparm) {
+		bspTraverseTime = (unsigned int)(I_GetTimeUS() - stagetime);
+		stagetime = I_GetTimeUS();
+	}
+
+	//
+	// build the vertices for the visible walls and flats
+	//
+	R_GenerateWorld();
+
+	if (devparm) {
+		geometryTime = (unsigned int)(I_GetTimeUS() - stagetime);
+	}
+
 	//
 	// check for new console commands
 	//
@@ -750,8 +839,16 @@ void R_RenderPlayerView(player_t* player) {
 	//
 	// render world
 	//
+	if (devparm) {
+		stagetime = I_GetTimeUS();
+	}
+
 	R_RenderWorld();
 
+	if (devparm) {
+		worldSubmitTime = (unsigned int)(I_GetTimeUS() - stagetime) - spriteSetupTime;
+	}
+
 	if (r_drawmobjbox.value) {
 		R_DrawThingBBox();
 	}
@@ -796,11 +893,21 @@ void R_RegisterCvars(void) {
 	CON_CvarRegister(&r_fog);
 	CON_CvarRegister(&r_filter);
 	CON_CvarRegister(&r_anisotropic);
+	CON_CvarRegister(&r_mipmaps);
 	CON_CvarRegister(&r_wipe);
 	CON_CvarRegister(&r_drawmobjbox);
 	CON_CvarRegister(&r_rendersprites);
 	CON_CvarRegister(&r_skybox);
 	CON_CvarRegister(&r_colorscale);
 	CON_CvarRegister(&r_texturecombiner);
+	CON_CvarRegister(&r_texturecompression);
+	CON_CvarRegister(&r_texturebudget);
+	CON_CvarRegister(&r_clippermode);
+	CON_CvarRegister(&r_renderthreads);
+	CON_CvarRegister(&r_pvs);
+	CON_CvarRegister(&r_occlusion);
+	CON_CvarRegister(&r_spriteinstancing);
+	CON_CvarRegister(&r_shaders);
+	CON_CvarRegister(&r_streambuffer);
 	CON_CvarRegister(&hud_disablesecretmessages);
 }
\ No newline at end of file
@@ -54,6 +54,10 @@ extern int          vertCount;
 
 extern unsigned int renderTic;
 extern unsigned int spriteRenderTic;
+extern unsigned int bspTraverseTime;
+extern unsigned int geometryTime;
+extern unsigned int spriteSetupTime;
+extern unsigned int worldSubmitTime;
 extern unsigned int glBindCalls;
 
 extern boolean     bRenderSky;
@@ -75,6 +79,7 @@ void R_SetViewAngleOffset(angle_t angle);
 void R_SetViewOffset(int offset);
 void R_RegisterCvars(void);
 void R_SetViewMatrix(void);
+void R_GenerateWorld(void);
 void R_RenderWorld(void);
 void R_RenderBSPNode(int bspnum);
 void R_AllocSubsectorBuffer(void);
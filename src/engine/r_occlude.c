@@ -0,0 +1,296 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Sprite occlusion queries
+//
+// Once the walls and flats are drawn, a box around each sprite is
+// drawn with colour and depth writes off, counting the samples
+// that pass the depth test. The count is read back on the next
+// frame, so nothing waits on the GPU, and a sprite whose box had
+// no samples then is left out of the draw list. A sprite coming
+// into view can show up a frame late.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "r_local.h"
+#include "r_occlude.h"
+#include "gl_main.h"
+#include "gl_texture.h"
+#include "dgl.h"
+#include "con_console.h"
+
+#define OCC_MAXQUERIES      4096
+#define OCC_PADDING         8.0f    // room for a frame's worth of movement
+
+typedef struct {
+	GLuint          id;
+	mobj_t*         owner;
+	unsigned int    frame;      // when it was last issued
+} occquery_t;
+
+typedef struct {
+	occquery_t*     query;
+	float           x1;
+	float           y1;
+	float           z1;
+	float           x2;
+	float           y2;
+	float           z2;
+} occbox_t;
+
+static occquery_t* occqueries = NULL;
+static int* occfree = NULL;
+static int numoccfree = 0;
+static occbox_t* occboxes = NULL;
+static int numoccboxes = 0;
+static unsigned int occframe = 1;
+static boolean occactive = false;
+
+occlusionstats_t occlusionstats;
+
+CVAR(r_occlusion, 0);
+
+CVAR_EXTERNAL(r_fillmode);
+
+//
+// R_BeginOcclusion
+//
+
+void R_BeginOcclusion(void) {
+	int i;
+
+	occlusionstats.sprites = 0;
+	occlusionstats.queries = 0;
+	occlusionstats.occluded = 0;
+	occlusionstats.drawn = 0;
+
+	numoccboxes = 0;
+	occframe++;
+
+	// the boxes would only be outlined in wireframe
+	occactive = (r_occlusion.value > 0 && has_GL_ARB_occlusion_query && r_fillmode.value > 0);
+
+	if (!occactive) {
+		return;
+	}
+
+	if (!occqueries) {
+		GLuint* ids;
+
+		ids = (GLuint*)malloc(OCC_MAXQUERIES * sizeof(GLuint));
+		dglGenQueriesARB(OCC_MAXQUERIES, ids);
+
+		occqueries = (occquery_t*)calloc(OCC_MAXQUERIES, sizeof(occquery_t));
+		occfree = (int*)malloc(OCC_MAXQUERIES * sizeof(int));
+		occboxes = (occbox_t*)malloc(OCC_MAXQUERIES * sizeof(occbox_t));
+
+		for (i = 0; i < OCC_MAXQUERIES; i++) {
+			occqueries[i].id = ids[i];
+		}
+
+		free(ids);
+	}
+
+	// queries that weren't issued last frame are up for grabs
+	numoccfree = 0;
+
+	for (i = OCC_MAXQUERIES - 1; i >= 0; i--) {
+		if (occqueries[i].frame + 1 < occframe) {
+			occqueries[i].owner = NULL;
+			occfree[numoccfree++] = i;
+		}
+	}
+}
+
+//
+// R_SpriteOccluded
+// Returns true if the sprite was hidden on the last frame,
+// and sets up a query to check it again on this one
+//
+
+boolean R_SpriteOccluded(visspritelist_t* vis, int spritenum) {
+	mobj_t* thing;
+	occquery_t* query;
+	occbox_t* box;
+	float radius;
+	float top;
+	float z1;
+	float z2;
+	boolean occluded;
+
+	occlusionstats.sprites++;
+
+	thing = vis->spr;
+
+	if (!occactive || (thing->flags & MF_RENDERLASER)) {
+		return false;
+	}
+
+	// the box has to hold the sprite at any angle, plus
+	// however far it moves before the result is used
+	radius = (float)MAX(fabs(spriteoffset[spritenum]), fabs(spritewidth[spritenum] - spriteoffset[spritenum]));
+	radius = MAX(radius, F2D3D(thing->radius)) + OCC_PADDING +
+		F2D3D(D_abs(thing->momx) + D_abs(thing->momy));
+
+	top = vis->z + spritetopoffset[spritenum];
+	z1 = MIN(vis->z, top - spriteheight[spritenum]) - OCC_PADDING - F2D3D(D_abs(thing->momz));
+	z2 = MAX(vis->z + F2D3D(thing->height), top) + OCC_PADDING + F2D3D(D_abs(thing->momz));
+
+	// from inside the box the near plane cuts its faces away
+	// and no samples would be counted
+	if (fabs(fviewx - vis->x) <= radius + 1 && fabs(fviewy - vis->y) <= radius + 1 &&
+		fviewz >= z1 - 1 && fviewz <= z2 + 1) {
+		return false;
+	}
+
+	query = NULL;
+	occluded = false;
+
+	if (thing->occlusion > 0 && occqueries[thing->occlusion - 1].owner == thing) {
+		query = &occqueries[thing->occlusion - 1];
+
+		// never wait for a result that isn't in yet
+		if (query->frame + 1 == occframe) {
+			GLuint result = 0;
+
+			dglGetQueryObjectuivARB(query->id, GL_QUERY_RESULT_AVAILABLE_ARB, &result);
+
+			if (result) {
+				dglGetQueryObjectuivARB(query->id, GL_QUERY_RESULT_ARB, &result);
+				occluded = (result == 0);
+			}
+		}
+	}
+	else if (numoccfree) {
+		query = &occqueries[occfree[--numoccfree]];
+		query->owner = thing;
+		thing->occlusion = (int)(query - occqueries) + 1;
+	}
+
+	if (query && query->frame != occframe) {
+		query->frame = occframe;
+
+		box = &occboxes[numoccboxes++];
+		box->query = query;
+		box->x1 = vis->x - radius;
+		box->y1 = vis->y - radius;
+		box->z1 = z1;
+		box->x2 = vis->x + radius;
+		box->y2 = vis->y + radius;
+		box->z2 = z2;
+	}
+
+	if (occluded) {
+		occlusionstats.occluded++;
+	}
+
+	return occluded;
+}
+
+//
+// R_DrawOcclusionQueries
+// Needs the walls and flats in the depth buffer
+//
+
+void R_DrawOcclusionQueries(void) {
+	int i;
+
+	if (!numoccboxes) {
+		return;
+	}
+
+	GL_SetState(GLSTATE_TEXTURE0, 0);
+	GL_SetState(GLSTATE_CULL, 0);
+	dglDisable(GL_ALPHA_TEST);
+	dglColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	dglDepthMask(GL_FALSE);
+
+	for (i = 0; i < numoccboxes; i++) {
+		occbox_t* box = &occboxes[i];
+
+		dglBeginQueryARB(GL_SAMPLES_PASSED_ARB, box->query->id);
+		dglBegin(GL_QUADS);
+
+		// bottom and top
+		dglVertex3f(box->x1, box->y1, box->z1);
+		dglVertex3f(box->x2, box->y1, box->z1);
+		dglVertex3f(box->x2, box->y2, box->z1);
+		dglVertex3f(box->x1, box->y2, box->z1);
+
+		dglVertex3f(box->x1, box->y1, box->z2);
+		dglVertex3f(box->x2, box->y1, box->z2);
+		dglVertex3f(box->x2, box->y2, box->z2);
+		dglVertex3f(box->x1, box->y2, box->z2);
+
+		// sides
+		dglVertex3f(box->x1, box->y1, box->z1);
+		dglVertex3f(box->x2, box->y1, box->z1);
+		dglVertex3f(box->x2, box->y1, box->z2);
+		dglVertex3f(box->x1, box->y1, box->z2);
+
+		dglVertex3f(box->x1, box->y2, box->z1);
+		dglVertex3f(box->x2, box->y2, box->z1);
+		dglVertex3f(box->x2, box->y2, box->z2);
+		dglVertex3f(box->x1, box->y2, box->z2);
+
+		dglVertex3f(box->x1, box->y1, box->z1);
+		dglVertex3f(box->x1, box->y2, box->z1);
+		dglVertex3f(box->x1, box->y2, box->z2);
+		dglVertex3f(box->x1, box->y1, box->z2);
+
+		dglVertex3f(box->x2, box->y1, box->z1);
+		dglVertex3f(box->x2, box->y2, box->z1);
+		dglVertex3f(box->x2, box->y2, box->z2);
+		dglVertex3f(box->x2, box->y1, box->z2);
+
+		dglEnd();
+		dglEndQueryARB(GL_SAMPLES_PASSED_ARB);
+	}
+
+	occlusionstats.queries = numoccboxes;
+
+	dglColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	dglDepthMask(GL_TRUE);
+	dglEnable(GL_ALPHA_TEST);
+	GL_SetState(GLSTATE_CULL, 1);
+	GL_SetState(GLSTATE_TEXTURE0, 1);
+}
+
+//
+// R_InitOcclusion
+// The queries belong to the old context after a video reset
+//
+
+void R_InitOcclusion(void) {
+	free(occqueries);
+	free(occfree);
+	free(occboxes);
+
+	occqueries = NULL;
+	occfree = NULL;
+	occboxes = NULL;
+	numoccfree = 0;
+	numoccboxes = 0;
+}
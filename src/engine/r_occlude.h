@@ -0,0 +1,41 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_OCCLUDE_H__
+#define __R_OCCLUDE_H__
+
+#include "doomtype.h"
+#include "r_things.h"
+
+typedef struct {
+	int         sprites;        // sprites set up on the last frame
+	int         queries;        // boxes drawn to check them
+	int         occluded;       // left out because their box wasn't seen
+	int         drawn;          // made it into the frustum and got drawn
+} occlusionstats_t;
+
+extern occlusionstats_t occlusionstats;
+
+void        R_InitOcclusion(void);
+void        R_BeginOcclusion(void);
+boolean     R_SpriteOccluded(visspritelist_t* vis, int spritenum);
+void        R_DrawOcclusionQueries(void);
+
+#endif
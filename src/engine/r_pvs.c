@@ -0,0 +1,1152 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Potentially visible sets
+//
+// For every subsector, the set of subsectors that could be seen
+// from anywhere inside it. Each leaf edge that isn't a one sided
+// wall is a portal to whatever is on the other side. Doors and
+// lifts move, so heights are ignored and every two sided line
+// counts as open. Sight is then flowed outwards through chains
+// of portals, clipping each portal to the lines that pass
+// through the first and the previous one. This is done in 2D.
+// Neighbours across an edge are the leafs with an edge of their
+// own on the same line overlapping it; the leafs tile the map, so
+// nothing across an open edge is left out.
+//
+// The result is built when a map is first loaded and kept in a
+// file named after a hash of the map's lumps. R_RenderBSPNode
+// skips nodes and subsectors outside the set of the leaf the
+// view is in. The sets only ever affect drawing; game logic
+// doesn't use them, since -nopvs and a per machine cache would
+// let netgames and demos go out of sync.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "r_local.h"
+#include "r_pvs.h"
+#include "p_local.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include "i_system.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "con_console.h"
+#include "g_actions.h"
+
+#define PVS_VERSION         2
+#define PVS_MAXSTEPS        0x10000     // portal visits per leaf before falling back to a flood fill
+#define PVS_MAXDEPTH        1024
+#define PVS_CELLSIZE        256.0       // map units per side of the cells edges are bucketed in
+#define PVS_LINEDIST        0.05        // how far an edge may stray from a line and still lie on it
+#define PVS_MINOVERLAP      0.01
+#define PVS_EPSILON         0.001
+
+#define PVS_BIT(row, n)     ((row)[(n) >> 3] & (1 << ((n) & 7)))
+#define PVS_SETBIT(row, n)  ((row)[(n) >> 3] |= (1 << ((n) & 7)))
+
+typedef struct {
+	char            id[8];
+	int             version;
+	md5_digest_t    key;
+	int             numsubsectors;
+	int             datasize;
+} pvsheader_t;
+
+typedef struct {
+	int         leaf;           // subsector on the far side
+	double      x1;
+	double      y1;
+	double      x2;
+	double      y2;
+	double      nx;             // normal facing away from the owner
+	double      ny;
+	double      dist;
+	int         run;
+	double      t0;             // widest range explored from the current
+	double      t1;             // source portal
+} pvsportal_t;
+
+pvsstats_t pvsstats;
+
+static byte* pvsdata = NULL;       // run length coded rows
+static int* pvsoffsets = NULL;
+static int pvsdatasize = 0;
+static int pvsrowbytes = 0;
+
+static byte* pvsviewrow = NULL;
+static byte* pvsnodes = NULL;
+static int* pvsnodeparent = NULL;
+static int* pvssubparent = NULL;
+static int pvsviewleaf = -1;
+static boolean pvsactive = false;
+
+// used while building
+static pvsportal_t* portals;
+static int numportals;
+static int maxportals;
+static int* leafportals;        // first portal of each leaf, numsubsectors + 1 entries
+static byte* buildrow;
+static byte* buildpath;          // leafs on the current chain
+static int buildrun;
+static int buildsteps;
+static boolean buildoverflow;
+
+CVAR(r_pvs, 0);
+
+//
+// PVS_PointInLeaf
+// True if the point lies within the leaf polygon
+//
+
+static boolean PVS_PointInLeaf(subsector_t* sub, double x, double y) {
+	double area = 0;
+	int i;
+
+	if (sub->numleafs < 3) {
+		return false;
+	}
+
+	for (i = 0; i < sub->numleafs; i++) {
+		vertex_t* v1 = leafs[sub->leaf + i].vertex;
+		vertex_t* v2 = leafs[sub->leaf + (i + 1) % sub->numleafs].vertex;
+
+		area += F2D3D(v1->x) * F2D3D(v2->y) - F2D3D(v2->x) * F2D3D(v1->y);
+	}
+
+	for (i = 0; i < sub->numleafs; i++) {
+		vertex_t* v1 = leafs[sub->leaf + i].vertex;
+		vertex_t* v2 = leafs[sub->leaf + (i + 1) % sub->numleafs].vertex;
+		double dx = F2D3D(v2->x) - F2D3D(v1->x);
+		double dy = F2D3D(v2->y) - F2D3D(v1->y);
+		double len = sqrt(dx * dx + dy * dy);
+		double side;
+
+		if (len < PVS_EPSILON) {
+			continue;
+		}
+
+		side = (dx * (y - F2D3D(v1->y)) - dy * (x - F2D3D(v1->x))) / len;
+
+		if ((area > 0 && side < -0.01) || (area < 0 && side > 0.01)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//
+// PVS_DecompressRow
+//
+
+static void PVS_DecompressRow(int leaf, byte* out) {
+	byte* in = pvsdata + pvsoffsets[leaf];
+	byte* inend = pvsdata + pvsdatasize;
+	byte* end = out + pvsrowbytes;
+
+	while (out < end && in < inend) {
+		int count;
+
+		if (*in) {
+			*out++ = *in++;
+			continue;
+		}
+
+		count = (in + 1 < inend) ? in[1] : 0;
+		in += 2;
+
+		while (count-- && out < end) {
+			*out++ = 0;
+		}
+	}
+
+	// a damaged row shows everything rather than nothing
+	while (out < end) {
+		*out++ = 0xff;
+	}
+}
+
+//
+// PVS_CompressRow
+//
+
+static int PVS_CompressRow(byte* in, byte* out) {
+	byte* start = out;
+	int i;
+
+	for (i = 0; i < pvsrowbytes; i++) {
+		int rep;
+
+		*out++ = in[i];
+
+		if (in[i]) {
+			continue;
+		}
+
+		for (rep = 1; i + 1 < pvsrowbytes && !in[i + 1] && rep < 255; rep++) {
+			i++;
+		}
+
+		*out++ = rep;
+	}
+
+	return out - start;
+}
+
+//
+// PVS_AddPortal
+//
+
+static void PVS_AddPortal(int leaf, double x1, double y1, double x2, double y2, double nx, double ny) {
+	pvsportal_t* p;
+
+	if (numportals == maxportals) {
+		maxportals = maxportals ? maxportals * 2 : 1024;
+		portals = (pvsportal_t*)realloc(portals, maxportals * sizeof(pvsportal_t));
+
+		if (portals == NULL) {
+			I_Error("PVS_AddPortal: Failed to allocate %i portals", maxportals);
+		}
+	}
+
+	p = &portals[numportals++];
+	p->leaf = leaf;
+	p->x1 = x1;
+	p->y1 = y1;
+	p->x2 = x2;
+	p->y2 = y2;
+	p->nx = nx;
+	p->ny = ny;
+	p->dist = nx * x1 + ny * y1;
+	p->run = 0;
+}
+
+//
+// PVS_FindPortals
+// Matches every open edge of every leaf against the edges of
+// other leafs that lie on the same line and overlap it. Leafs
+// tile the map, so whatever is across an edge has to have an
+// edge of its own along it; an edge can border more than one
+// leaf where the other side was split further, and each gets a
+// portal covering only the shared part
+//
+
+typedef struct {
+	int         leaf;
+	double      x1;
+	double      y1;
+	double      x2;
+	double      y2;
+} pvsedge_t;
+
+typedef struct {
+	int         edge;
+	int         next;
+} pvslink_t;
+
+static void PVS_FindPortals(void) {
+	pvsedge_t* edges;
+	pvslink_t* links;
+	int* cells;
+	int* stamp;
+	int numedges;
+	int numlinks;
+	int maxlinks;
+	int cols;
+	int rows;
+	double minx;
+	double miny;
+	double maxx;
+	double maxy;
+	int i;
+	int j;
+
+	numportals = 0;
+	maxportals = 0;
+	portals = NULL;
+	leafportals = (int*)malloc((numsubsectors + 1) * sizeof(int));
+
+	// gather the edges of every leaf and bucket them by area
+
+	numedges = 0;
+	minx = miny = D_MAXINT;
+	maxx = maxy = D_MININT;
+
+	for (i = 0; i < numsubsectors; i++) {
+		if (subsectors[i].numleafs >= 3) {
+			numedges += subsectors[i].numleafs;
+		}
+	}
+
+	edges = (pvsedge_t*)malloc(MAX(numedges, 1) * sizeof(pvsedge_t));
+	stamp = (int*)malloc(MAX(numedges, 1) * sizeof(int));
+
+	if (edges == NULL || stamp == NULL) {
+		I_Error("PVS_FindPortals: Failed to allocate %i edges", numedges);
+	}
+
+	numedges = 0;
+
+	for (i = 0; i < numsubsectors; i++) {
+		subsector_t* sub = &subsectors[i];
+
+		if (sub->numleafs < 3) {
+			continue;
+		}
+
+		for (j = 0; j < sub->numleafs; j++) {
+			vertex_t* v1 = leafs[sub->leaf + j].vertex;
+			vertex_t* v2 = leafs[sub->leaf + (j + 1) % sub->numleafs].vertex;
+			pvsedge_t* e = &edges[numedges++];
+
+			e->leaf = i;
+			e->x1 = F2D3D(v1->x);
+			e->y1 = F2D3D(v1->y);
+			e->x2 = F2D3D(v2->x);
+			e->y2 = F2D3D(v2->y);
+
+			minx = MIN(minx, MIN(e->x1, e->x2));
+			miny = MIN(miny, MIN(e->y1, e->y2));
+			maxx = MAX(maxx, MAX(e->x1, e->x2));
+			maxy = MAX(maxy, MAX(e->y1, e->y2));
+		}
+	}
+
+	cols = numedges ? (int)((maxx - minx) / PVS_CELLSIZE) + 1 : 1;
+	rows = numedges ? (int)((maxy - miny) / PVS_CELLSIZE) + 1 : 1;
+	cells = (int*)malloc(cols * rows * sizeof(int));
+
+	if (cells == NULL) {
+		I_Error("PVS_FindPortals: Failed to allocate %i cells", cols * rows);
+	}
+
+	for (i = 0; i < cols * rows; i++) {
+		cells[i] = -1;
+	}
+
+	numlinks = 0;
+	maxlinks = 0;
+	links = NULL;
+
+	for (i = 0; i < numedges; i++) {
+		pvsedge_t* e = &edges[i];
+		int cx1 = (int)((MIN(e->x1, e->x2) - PVS_LINEDIST - minx) / PVS_CELLSIZE);
+		int cy1 = (int)((MIN(e->y1, e->y2) - PVS_LINEDIST - miny) / PVS_CELLSIZE);
+		int cx2 = (int)((MAX(e->x1, e->x2) + PVS_LINEDIST - minx) / PVS_CELLSIZE);
+		int cy2 = (int)((MAX(e->y1, e->y2) + PVS_LINEDIST - miny) / PVS_CELLSIZE);
+		int x;
+		int y;
+
+		cx1 = MAX(cx1, 0);
+		cy1 = MAX(cy1, 0);
+		cx2 = MIN(cx2, cols - 1);
+		cy2 = MIN(cy2, rows - 1);
+
+		for (y = cy1; y <= cy2; y++) {
+			for (x = cx1; x <= cx2; x++) {
+				if (numlinks == maxlinks) {
+					maxlinks = maxlinks ? maxlinks * 2 : 4096;
+					links = (pvslink_t*)realloc(links, maxlinks * sizeof(pvslink_t));
+
+					if (links == NULL) {
+						I_Error("PVS_FindPortals: Failed to allocate %i links", maxlinks);
+					}
+				}
+
+				links[numlinks].edge = i;
+				links[numlinks].next = cells[y * cols + x];
+				cells[y * cols + x] = numlinks++;
+			}
+		}
+
+		stamp[i] = -1;
+	}
+
+	// match the open edges against edges of other leafs on the same line
+
+	for (i = 0; i < numsubsectors; i++) {
+		subsector_t* sub = &subsectors[i];
+		double area = 0;
+		int first;
+
+		leafportals[i] = numportals;
+
+		if (sub->numleafs < 3) {
+			continue;
+		}
+
+		for (j = 0; j < sub->numleafs; j++) {
+			vertex_t* v1 = leafs[sub->leaf + j].vertex;
+			vertex_t* v2 = leafs[sub->leaf + (j + 1) % sub->numleafs].vertex;
+
+			area += F2D3D(v1->x) * F2D3D(v2->y) - F2D3D(v2->x) * F2D3D(v1->y);
+		}
+
+		for (j = 0; j < sub->numleafs; j++) {
+			leaf_t* leaf = &leafs[sub->leaf + j];
+			vertex_t* v1 = leaf->vertex;
+			vertex_t* v2 = leafs[sub->leaf + (j + 1) % sub->numleafs].vertex;
+			double x1 = F2D3D(v1->x);
+			double y1 = F2D3D(v1->y);
+			double x2 = F2D3D(v2->x);
+			double y2 = F2D3D(v2->y);
+			double dx = x2 - x1;
+			double dy = y2 - y1;
+			double len = sqrt(dx * dx + dy * dy);
+			double ux;
+			double uy;
+			double nx;
+			double ny;
+			int cx1;
+			int cy1;
+			int cx2;
+			int cy2;
+			int x;
+			int y;
+
+			if (len < PVS_EPSILON) {
+				continue;
+			}
+
+			// one sided walls block everything. Anything else,
+			// including a seg that doesn't match the edge, is open
+			if (leaf->seg && !leaf->seg->backsector &&
+				((leaf->seg->v1 == v1 && leaf->seg->v2 == v2) ||
+				(leaf->seg->v1 == v2 && leaf->seg->v2 == v1))) {
+				continue;
+			}
+
+			ux = dx / len;
+			uy = dy / len;
+
+			// outward normal
+			if (area > 0) {
+				nx = uy;
+				ny = -ux;
+			}
+			else {
+				nx = -uy;
+				ny = ux;
+			}
+
+			first = numportals;
+			cx1 = MAX((int)((MIN(x1, x2) - minx) / PVS_CELLSIZE), 0);
+			cy1 = MAX((int)((MIN(y1, y2) - miny) / PVS_CELLSIZE), 0);
+			cx2 = MIN((int)((MAX(x1, x2) - minx) / PVS_CELLSIZE), cols - 1);
+			cy2 = MIN((int)((MAX(y1, y2) - miny) / PVS_CELLSIZE), rows - 1);
+
+			for (y = cy1; y <= cy2; y++) {
+				for (x = cx1; x <= cx2; x++) {
+					int l;
+
+					for (l = cells[y * cols + x]; l != -1; l = links[l].next) {
+						int k = links[l].edge;
+						pvsedge_t* e = &edges[k];
+						double s0;
+						double s1;
+						int p;
+
+						// edges that span several cells are met more than once
+						if (e->leaf == i || stamp[k] == leaf - leafs) {
+							continue;
+						}
+
+						stamp[k] = leaf - leafs;
+
+						if (fabs((e->x1 - x1) * nx + (e->y1 - y1) * ny) > PVS_LINEDIST ||
+							fabs((e->x2 - x1) * nx + (e->y2 - y1) * ny) > PVS_LINEDIST) {
+							continue;
+						}
+
+						s0 = (e->x1 - x1) * ux + (e->y1 - y1) * uy;
+						s1 = (e->x2 - x1) * ux + (e->y2 - y1) * uy;
+
+						if (s0 > s1) {
+							double t = s0;
+							s0 = s1;
+							s1 = t;
+						}
+
+						s0 = MAX(s0, 0);
+						s1 = MIN(s1, len);
+
+						if (s1 - s0 < PVS_MINOVERLAP) {
+							continue;
+						}
+
+						// a leaf with collinear corners can share the
+						// edge in several pieces
+						for (p = first; p < numportals; p++) {
+							if (portals[p].leaf == e->leaf) {
+								break;
+							}
+						}
+
+						if (p == numportals) {
+							PVS_AddPortal(e->leaf, x1 + ux * s0, y1 + uy * s0, x1 + ux * s1, y1 + uy * s1, nx, ny);
+						}
+						else {
+							double t0 = MIN((portals[p].x1 - x1) * ux + (portals[p].y1 - y1) * uy, s0);
+							double t1 = MAX((portals[p].x2 - x1) * ux + (portals[p].y2 - y1) * uy, s1);
+
+							portals[p].x1 = x1 + ux * t0;
+							portals[p].y1 = y1 + uy * t0;
+							portals[p].x2 = x1 + ux * t1;
+							portals[p].y2 = y1 + uy * t1;
+							portals[p].dist = nx * portals[p].x1 + ny * portals[p].y1;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	leafportals[numsubsectors] = numportals;
+
+	free(links);
+	free(cells);
+	free(stamp);
+	free(edges);
+}
+
+//
+// PVS_ClipRange
+// Keeps the part of t0..t1 along the portal where
+// a * x + b * y + c >= 0
+//
+
+static boolean PVS_ClipRange(pvsportal_t* p, double a, double b, double c, double* t0, double* t1) {
+	double f1 = a * p->x1 + b * p->y1 + c;
+	double f2 = a * p->x2 + b * p->y2 + c;
+	double t;
+
+	if (f1 >= 0 && f2 >= 0) {
+		return *t0 <= *t1;
+	}
+
+	if (f1 < 0 && f2 < 0) {
+		return false;
+	}
+
+	t = f1 / (f1 - f2);
+
+	if (f1 < 0) {
+		*t0 = MAX(*t0, t);
+	}
+	else {
+		*t1 = MIN(*t1, t);
+	}
+
+	return *t0 <= *t1;
+}
+
+//
+// PVS_ClipToSeparators
+// Lines through the source and the pass portals can only reach
+// the part of the target between the two lines that join
+// opposite ends of them. Portals that share a corner are still
+// bounded by the line along the other one
+//
+
+static boolean PVS_ClipToSeparators(double* src, double* pass, pvsportal_t* p, double* t0, double* t1) {
+	int i;
+	int j;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			double ox = src[i * 2];
+			double oy = src[i * 2 + 1];
+			double dx = pass[j * 2] - ox;
+			double dy = pass[j * 2 + 1] - oy;
+			double len = sqrt(dx * dx + dy * dy);
+			double a;
+			double b;
+			double c;
+			double sa;
+			double sb;
+
+			if (len < PVS_EPSILON) {
+				continue;
+			}
+
+			a = -dy / len;
+			b = dx / len;
+			c = -(a * ox + b * oy);
+
+			sa = a * src[(i ^ 1) * 2] + b * src[(i ^ 1) * 2 + 1] + c;
+			sb = a * pass[(j ^ 1) * 2] + b * pass[(j ^ 1) * 2 + 1] + c;
+
+			if ((sa > PVS_EPSILON && sb > PVS_EPSILON) || (sa < -PVS_EPSILON && sb < -PVS_EPSILON) ||
+				(fabs(sa) <= PVS_EPSILON && fabs(sb) <= PVS_EPSILON)) {
+				continue;
+			}
+
+			// keep the side the rest of the pass portal is on,
+			// or the side away from the source if it lies along it
+			if (fabs(sb) > PVS_EPSILON ? sb < 0 : sa > 0) {
+				a = -a;
+				b = -b;
+				c = -c;
+			}
+
+			if (!PVS_ClipRange(p, a, b, c + PVS_EPSILON, t0, t1)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//
+// PVS_Flow
+//
+
+static void PVS_Flow(pvsportal_t* source, double* pass, int leafnum, int depth) {
+	double src[4];
+	int i;
+
+	src[0] = source->x1;
+	src[1] = source->y1;
+	src[2] = source->x2;
+	src[3] = source->y2;
+
+	for (i = leafportals[leafnum]; i < leafportals[leafnum + 1]; i++) {
+		pvsportal_t* p = &portals[i];
+		double next[4];
+		double t0 = 0;
+		double t1 = 1;
+
+		// a line can't pass through a convex leaf twice
+		if (buildpath[p->leaf]) {
+			continue;
+		}
+
+		// or gets back behind the source portal
+		if (!PVS_ClipRange(p, source->nx, source->ny, PVS_EPSILON - source->dist, &t0, &t1)) {
+			continue;
+		}
+
+		if (!PVS_ClipToSeparators(src, pass, p, &t0, &t1)) {
+			continue;
+		}
+
+		// a range inside one already explored from this source
+		// portal can't see anything new. Otherwise explore both
+		// together so each portal is only widened a few times
+		if (p->run == buildrun) {
+			if (t0 >= p->t0 && t1 <= p->t1) {
+				continue;
+			}
+
+			t0 = MIN(t0, p->t0);
+			t1 = MAX(t1, p->t1);
+		}
+
+		p->run = buildrun;
+		p->t0 = t0;
+		p->t1 = t1;
+
+		PVS_SETBIT(buildrow, p->leaf);
+
+		if (++buildsteps > PVS_MAXSTEPS || depth >= PVS_MAXDEPTH) {
+			buildoverflow = true;
+			return;
+		}
+
+		next[0] = p->x1 + (p->x2 - p->x1) * t0;
+		next[1] = p->y1 + (p->y2 - p->y1) * t0;
+		next[2] = p->x1 + (p->x2 - p->x1) * t1;
+		next[3] = p->y1 + (p->y2 - p->y1) * t1;
+
+		buildpath[p->leaf] = true;
+		PVS_Flow(source, next, p->leaf, depth + 1);
+		buildpath[p->leaf] = false;
+
+		if (buildoverflow) {
+			return;
+		}
+	}
+}
+
+//
+// PVS_Flood
+// Everything connected to the leaf at all
+//
+
+static void PVS_Flood(int leaf, int* queue) {
+	int head = 0;
+	int tail = 0;
+	int i;
+
+	dmemset(buildrow, 0, pvsrowbytes);
+	PVS_SETBIT(buildrow, leaf);
+	queue[tail++] = leaf;
+
+	while (head < tail) {
+		leaf = queue[head++];
+
+		for (i = leafportals[leaf]; i < leafportals[leaf + 1]; i++) {
+			if (!PVS_BIT(buildrow, portals[i].leaf)) {
+				PVS_SETBIT(buildrow, portals[i].leaf);
+				queue[tail++] = portals[i].leaf;
+			}
+		}
+	}
+}
+
+//
+// PVS_Build
+//
+
+static void PVS_Build(void) {
+	byte* compressed;
+	byte* data;
+	int* queue;
+	int maxdata;
+	uint64_t start;
+	int i;
+	int j;
+
+	start = I_GetTimeUS();
+
+	PVS_FindPortals();
+
+	buildrow = (byte*)malloc(pvsrowbytes);
+	buildpath = (byte*)calloc(numsubsectors, 1);
+	compressed = (byte*)malloc(pvsrowbytes * 2);
+	queue = (int*)malloc(numsubsectors * sizeof(int));
+	maxdata = pvsrowbytes * 4;
+	data = (byte*)malloc(maxdata);
+
+	pvsdatasize = 0;
+	pvsstats.overflows = 0;
+	pvsstats.visible = 0;
+	buildrun = 0;
+
+	for (i = 0; i < numsubsectors; i++) {
+		int size;
+
+		dmemset(buildrow, 0, pvsrowbytes);
+		PVS_SETBIT(buildrow, i);
+
+		buildpath[i] = true;
+		buildsteps = 0;
+		buildoverflow = false;
+
+		for (j = leafportals[i]; j < leafportals[i + 1] && !buildoverflow; j++) {
+			pvsportal_t* p = &portals[j];
+			double pass[4];
+
+			PVS_SETBIT(buildrow, p->leaf);
+
+			pass[0] = p->x1;
+			pass[1] = p->y1;
+			pass[2] = p->x2;
+			pass[3] = p->y2;
+
+			buildrun++;
+			buildpath[p->leaf] = true;
+			PVS_Flow(p, pass, p->leaf, 0);
+			buildpath[p->leaf] = false;
+		}
+
+		buildpath[i] = false;
+
+		if (buildoverflow) {
+			PVS_Flood(i, queue);
+			pvsstats.overflows++;
+		}
+
+		// leafs too small to have edges are always drawn
+		for (j = 0; j < numsubsectors; j++) {
+			if (subsectors[j].numleafs < 3) {
+				PVS_SETBIT(buildrow, j);
+			}
+		}
+
+		for (j = 0; j < numsubsectors; j++) {
+			if (PVS_BIT(buildrow, j)) {
+				pvsstats.visible++;
+			}
+		}
+
+		size = PVS_CompressRow(buildrow, compressed);
+
+		if (pvsdatasize + size > maxdata) {
+			maxdata = (pvsdatasize + size) * 2;
+			data = (byte*)realloc(data, maxdata);
+
+			if (data == NULL) {
+				I_Error("PVS_Build: Failed to allocate %i bytes", maxdata);
+			}
+		}
+
+		pvsoffsets[i] = pvsdatasize;
+		dmemcpy(data + pvsdatasize, compressed, size);
+		pvsdatasize += size;
+	}
+
+	pvsdata = (byte*)Z_Malloc(MAX(pvsdatasize, 1), PU_LEVEL, 0);
+	dmemcpy(pvsdata, data, pvsdatasize);
+
+	pvsstats.portals = numportals;
+	pvsstats.buildtime = (int)((I_GetTimeUS() - start) / 1000);
+
+	free(data);
+	free(queue);
+	free(compressed);
+	free(buildrow);
+	free(buildpath);
+	free(leafportals);
+	free(portals);
+	portals = NULL;
+}
+
+//
+// PVS_MapKey
+// Hash of everything the sets are worked out from
+//
+
+static void PVS_MapKey(md5_digest_t key) {
+	static const int maplumps[] = {
+		ML_LINEDEFS, ML_VERTEXES, ML_SEGS, ML_SSECTORS, ML_NODES, ML_LEAFS
+	};
+	md5_context_t md5;
+	int i;
+
+	MD5_Init(&md5);
+
+	for (i = 0; i < (int)(sizeof(maplumps) / sizeof(int)); i++) {
+		int length = W_MapLumpLength(maplumps[i]);
+
+		MD5_UpdateInt32(&md5, length);
+
+		if (length) {
+			MD5_Update(&md5, (byte*)W_GetMapLump(maplumps[i]), length);
+		}
+	}
+
+	MD5_Final(key, &md5);
+}
+
+//
+// PVS_FilePath
+//
+
+static char* PVS_FilePath(md5_digest_t key) {
+	char name[32];
+	int i;
+
+	dstrcpy(name, "pvs");
+
+	for (i = 0; i < 8; i++) {
+		sprintf(name + 3 + i * 2, "%02x", key[i]);
+	}
+
+	dstrcat(name, ".dat");
+
+	return I_GetUserFile(name);
+}
+
+//
+// PVS_Load
+//
+
+static boolean PVS_Load(pvsheader_t* header) {
+	pvsheader_t fileheader;
+	char* path;
+	FILE* fp;
+	boolean ok = false;
+	int i;
+
+	if (!(path = PVS_FilePath(header->key))) {
+		return false;
+	}
+
+	if ((fp = fopen(path, "rb"))) {
+		if (fread(&fileheader, sizeof(pvsheader_t), 1, fp) == 1 &&
+			!memcmp(fileheader.id, header->id, 8) &&
+			fileheader.version == header->version &&
+			!memcmp(fileheader.key, header->key, sizeof(md5_digest_t)) &&
+			fileheader.numsubsectors == numsubsectors &&
+			fileheader.datasize > 0 &&
+			(int64_t)fileheader.datasize <= (int64_t)numsubsectors * pvsrowbytes * 2) {
+			pvsdatasize = fileheader.datasize;
+			pvsdata = (byte*)Z_Malloc(pvsdatasize, PU_LEVEL, 0);
+
+			ok = (fread(pvsoffsets, sizeof(int), numsubsectors, fp) == (size_t)numsubsectors &&
+				fread(pvsdata, 1, pvsdatasize, fp) == (size_t)pvsdatasize);
+
+			for (i = 0; ok && i < numsubsectors; i++) {
+				if (pvsoffsets[i] < 0 || pvsoffsets[i] >= pvsdatasize) {
+					ok = false;
+				}
+			}
+
+			if (!ok) {
+				CON_Warnf("PVS_Load: %s is damaged, building it again\n", path);
+				Z_Free(pvsdata);
+				pvsdata = NULL;
+			}
+		}
+
+		fclose(fp);
+	}
+
+	free(path);
+	return ok;
+}
+
+//
+// PVS_Save
+//
+
+static void PVS_Save(pvsheader_t* header) {
+	char* path;
+	FILE* fp;
+
+	if (!(path = PVS_FilePath(header->key))) {
+		return;
+	}
+
+	if ((fp = fopen(path, "wb"))) {
+		header->datasize = pvsdatasize;
+
+		fwrite(header, sizeof(pvsheader_t), 1, fp);
+		fwrite(pvsoffsets, sizeof(int), numsubsectors, fp);
+		fwrite(pvsdata, 1, pvsdatasize, fp);
+		fclose(fp);
+	}
+	else {
+		CON_Warnf("PVS_Save: couldn't create %s\n", path);
+	}
+
+	free(path);
+}
+
+//
+// R_SetupPVS
+// Loads or builds the sets for the map being set up. Needs the
+// map lumps, so it runs before they're freed
+//
+
+void R_SetupPVS(void) {
+	pvsheader_t header;
+	int i;
+
+	pvsdata = NULL;
+	pvsviewleaf = -1;
+	pvsactive = false;
+
+	pvsstats.loaded = false;
+	pvsstats.buildtime = 0;
+
+	//!
+	// @category obscure
+	//
+	// Don't build or use potentially visible sets for maps.
+	//
+
+	if (M_CheckParm("-nopvs") || numnodes <= 0 || numsubsectors <= 1) {
+		return;
+	}
+
+	pvsrowbytes = (numsubsectors + 7) >> 3;
+	pvsoffsets = (int*)Z_Malloc(numsubsectors * sizeof(int), PU_LEVEL, 0);
+	pvsviewrow = (byte*)Z_Malloc(pvsrowbytes, PU_LEVEL, 0);
+	pvsnodes = (byte*)Z_Malloc((numnodes + 7) >> 3, PU_LEVEL, 0);
+	pvsnodeparent = (int*)Z_Malloc(numnodes * sizeof(int), PU_LEVEL, 0);
+	pvssubparent = (int*)Z_Malloc(numsubsectors * sizeof(int), PU_LEVEL, 0);
+
+	for (i = 0; i < numnodes; i++) {
+		pvsnodeparent[i] = -1;
+	}
+
+	for (i = 0; i < numsubsectors; i++) {
+		pvssubparent[i] = -1;
+	}
+
+	for (i = 0; i < numnodes; i++) {
+		int side;
+
+		for (side = 0; side < 2; side++) {
+			int child = nodes[i].children[side];
+
+			if (child & NF_SUBSECTOR) {
+				pvssubparent[child & ~NF_SUBSECTOR] = i;
+			}
+			else {
+				pvsnodeparent[child] = i;
+			}
+		}
+	}
+
+	dmemset(&header, 0, sizeof(pvsheader_t));
+	dmemcpy(header.id, "D64PVS", 6);
+	header.version = PVS_VERSION;
+	header.numsubsectors = numsubsectors;
+	PVS_MapKey(header.key);
+
+	if (PVS_Load(&header)) {
+		pvsstats.loaded = true;
+		pvsstats.portals = 0;
+		pvsstats.overflows = 0;
+		pvsstats.visible = 0;
+
+		for (i = 0; i < numsubsectors; i++) {
+			int j;
+
+			PVS_DecompressRow(i, pvsviewrow);
+
+			for (j = 0; j < numsubsectors; j++) {
+				if (PVS_BIT(pvsviewrow, j)) {
+					pvsstats.visible++;
+				}
+			}
+		}
+	}
+	else {
+		PVS_Build();
+		PVS_Save(&header);
+	}
+
+	CON_DPrintf("PVS: %i subsectors, %i kb, %s in %i ms\n", numsubsectors,
+		pvsdatasize >> 10, pvsstats.loaded ? "loaded" : "built", pvsstats.buildtime);
+}
+
+//
+// R_SetupPVSView
+// Picks the set for the leaf the view is in. Pruning is left
+// off if the view isn't properly inside any leaf
+//
+
+void R_SetupPVSView(void) {
+	subsector_t* sub;
+	int leaf;
+	int i;
+
+	pvsstats.traversed = 0;
+	pvsstats.culled = 0;
+	pvsstats.drawn = 0;
+
+	pvsactive = false;
+
+	if (!pvsdata || r_pvs.value <= 0) {
+		return;
+	}
+
+	sub = R_PointInSubsector(viewx, viewy);
+
+	if (!PVS_PointInLeaf(sub, F2D3D(viewx), F2D3D(viewy))) {
+		return;
+	}
+
+	leaf = sub - subsectors;
+
+	if (leaf != pvsviewleaf) {
+		PVS_DecompressRow(leaf, pvsviewrow);
+
+		// a node is visible if anything under it is
+		dmemset(pvsnodes, 0, (numnodes + 7) >> 3);
+
+		for (i = 0; i < numsubsectors; i++) {
+			int node;
+
+			if (!PVS_BIT(pvsviewrow, i)) {
+				continue;
+			}
+
+			for (node = pvssubparent[i]; node != -1 && !PVS_BIT(pvsnodes, node); node = pvsnodeparent[node]) {
+				PVS_SETBIT(pvsnodes, node);
+			}
+		}
+
+		pvsviewleaf = leaf;
+	}
+
+	pvsactive = true;
+}
+
+//
+// R_CheckPVS
+// Takes a node number, or a subsector number with NF_SUBSECTOR
+//
+
+boolean R_CheckPVS(int bspnum) {
+	boolean visible;
+
+	if (!pvsactive) {
+		return true;
+	}
+
+	if (bspnum & NF_SUBSECTOR) {
+		visible = PVS_BIT(pvsviewrow, bspnum & ~NF_SUBSECTOR) != 0;
+	}
+	else {
+		visible = PVS_BIT(pvsnodes, bspnum) != 0;
+	}
+
+	if (!visible) {
+		pvsstats.culled++;
+	}
+
+	return visible;
+}
+
+//
+// CMD_PVSStats
+//
+
+static CMD(PVSStats) {
+	if (!pvsdata) {
+		CON_Printf(WHITE, "No PVS for this map\n");
+		return;
+	}
+
+	CON_Printf(WHITE, "%i subsectors, %i kb, %s in %i ms\n", numsubsectors,
+		pvsdatasize >> 10, pvsstats.loaded ? "loaded" : "built", pvsstats.buildtime);
+
+	if (!pvsstats.loaded) {
+		CON_Printf(WHITE, "%i portals, %i leafs flooded after running out of steps\n",
+			pvsstats.portals, pvsstats.overflows);
+	}
+
+	CON_Printf(WHITE, "Average set: %i of %i subsectors\n",
+		(int)(pvsstats.visible / (uint64_t)numsubsectors), numsubsectors);
+	CON_Printf(WHITE, "Last frame: %i subsectors traversed, %i drawn, %i nodes/subsectors culled\n",
+		pvsstats.traversed, pvsstats.drawn, pvsstats.culled);
+}
+
+//
+// R_InitPVS
+//
+
+void R_InitPVS(void) {
+	G_AddCommand("pvsstats", CMD_PVSStats, 0);
+}
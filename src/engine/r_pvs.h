@@ -0,0 +1,44 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_PVS_H__
+#define __R_PVS_H__
+
+#include "doomtype.h"
+
+typedef struct {
+	boolean     loaded;         // read from the cache rather than built
+	int         buildtime;      // msecs
+	int         portals;
+	int         overflows;      // leafs that fell back to a flood fill
+	uint64_t    visible;        // sum of all set sizes
+	int         traversed;      // subsectors reached by the last frame's BSP walk
+	int         drawn;          // ... that added walls or flats
+	int         culled;         // nodes and subsectors skipped
+} pvsstats_t;
+
+extern pvsstats_t pvsstats;
+
+void        R_InitPVS(void);
+void        R_SetupPVS(void);
+void        R_SetupPVSView(void);
+boolean     R_CheckPVS(int bspnum);
+
+#endif
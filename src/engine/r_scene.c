@@ -28,9 +28,13 @@
 #include "doomstat.h"
 #include "gl_main.h"
 #include "gl_texture.h"
+#include "gl_shader.h"
+#include "gl_batch.h"
 #include "r_local.h"
 #include "r_sky.h"
 #include "r_drawlist.h"
+#include "r_occlude.h"
+#include "r_sprinst.h"
 
 CVAR_EXTERNAL(r_texturecombiner);
 CVAR_EXTERNAL(i_interpolateframes);
@@ -39,23 +43,32 @@ CVAR_EXTERNAL(r_rendersprites);
 CVAR_EXTERNAL(st_flashoverlay);
 
 //
-// ProcessWalls
+// CountWalls
 //
 
-static boolean ProcessWalls(vtxlist_t* vl, int* drawcount) {
-	seg_t* seg = (seg_t*)vl->data;
-	sector_t* sec = seg->frontsector;
+static int CountWalls(vtxlist_t* vl) {
+	return 4;
+}
+
+//
+// GenerateWalls
+//
+
+static int GenerateWalls(vtxlist_t* vl, vtx_t* v) {
+	return vl->callback(vl->data, v) ? 4 : 0;
+}
 
-	bspColor[LIGHT_FLOOR] = R_GetSectorLight(0xff, sec->colors[LIGHT_FLOOR]);
-	bspColor[LIGHT_CEILING] = R_GetSectorLight(0xff, sec->colors[LIGHT_CEILING]);
-	bspColor[LIGHT_THING] = R_GetSectorLight(0xff, sec->colors[LIGHT_THING]);
-	bspColor[LIGHT_UPRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_UPRWALL]);
-	bspColor[LIGHT_LWRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_LWRWALL]);
+//
+// ProcessWalls
+//
 
-	if (!vl->callback(seg, &drawVertex[*drawcount])) {
+static boolean ProcessWalls(vtxlist_t* vl, int* drawcount) {
+	if (!vl->numvertices) {
 		return false;
 	}
 
+	dmemcpy(&drawVertex[*drawcount], vl->vertices, 4 * sizeof(vtx_t));
+
 	dglTriangle(*drawcount + 0, *drawcount + 1, *drawcount + 2);
 	dglTriangle(*drawcount + 3, *drawcount + 2, *drawcount + 1);
 
@@ -65,26 +78,28 @@ static boolean ProcessWalls(vtxlist_t* vl, int* drawcount) {
 }
 
 //
-// ProcessFlats
+// CountFlats
 //
 
-static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
+static int CountFlats(vtxlist_t* vl) {
+	return ((subsector_t*)vl->data)->numleafs;
+}
+
+//
+// GenerateFlats
+//
+
+static int GenerateFlats(vtxlist_t* vl, vtx_t* v) {
 	int j;
 	fixed_t tx;
 	fixed_t ty;
 	leaf_t* leaf;
 	subsector_t* ss;
 	sector_t* sector;
-	int count;
 
 	ss = (subsector_t*)vl->data;
 	leaf = &leafs[ss->leaf];
 	sector = ss->sector;
-	count = *drawcount;
-
-	for (j = 0; j < ss->numleafs - 2; j++) {
-		dglTriangle(count, count + 1 + j, count + 2 + j);
-	}
 
 	// need to keep texture coords small to avoid
 	// floor 'wobble' due to rounding errors on some cards
@@ -94,9 +109,8 @@ static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
 	tx = (leaf->vertex->x >> 6) & ~(FRACUNIT - 1);
 	ty = (leaf->vertex->y >> 6) & ~(FRACUNIT - 1);
 
-	for (j = 0; j < ss->numleafs; j++) {
+	for (j = 0; j < ss->numleafs; j++, v++) {
 		int idx;
-		vtx_t* v = &drawVertex[count];
 
 		if (vl->flags & DLF_CEILING) {
 			leaf = &leafs[(ss->leaf + (ss->numleafs - 1)) - j];
@@ -160,11 +174,28 @@ static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
 		if (vl->flags & DLF_WATER2) {
 			v->tu += F2D3D(scrollfrac >> 6);
 		}
+	}
+
+	return ss->numleafs;
+}
 
-		count++;
+//
+// ProcessFlats
+//
+
+static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
+	int j;
+	int count;
+
+	count = *drawcount;
+
+	for (j = 0; j < vl->numvertices - 2; j++) {
+		dglTriangle(count, count + 1 + j, count + 2 + j);
 	}
 
-	*drawcount = count;
+	dmemcpy(&drawVertex[count], vl->vertices, vl->numvertices * sizeof(vtx_t));
+
+	*drawcount = count + vl->numvertices;
 
 	return true;
 }
@@ -190,6 +221,8 @@ static boolean ProcessSprites(vtxlist_t* vl, int* drawcount) {
 
 	GL_SetState(GLSTATE_CULL, !(mobj->flags & MF_RENDERLASER));
 
+	occlusionstats.drawn++;
+
 	dglTriangle(*drawcount + 0, *drawcount + 1, *drawcount + 2);
 	dglTriangle(*drawcount + 3, *drawcount + 2, *drawcount + 1);
 
@@ -288,19 +321,40 @@ void R_SetViewMatrix(void) {
 	dglTranslatef(-fviewx, -fviewy, -fviewz);
 }
 
+//
+// R_GenerateWorld
+// Builds the wall and flat vertices for everything R_RenderBSPNode
+// found visible. The sprites are still set up in R_RenderWorld
+//
+
+void R_GenerateWorld(void) {
+	DL_GenerateDrawList(DLT_WALL, CountWalls, GenerateWalls);
+	DL_GenerateDrawList(DLT_FLAT, CountFlats, GenerateFlats);
+}
+
 //
 // R_RenderWorld
 //
 
 void R_RenderWorld(void) {
+	boolean shaders;
+
+	// nothing batched should get drawn through the world program
+	GL_FlushBatch();
+
 	SetupFog();
 
 	dglEnable(GL_DEPTH_TEST);
 
-	DL_BeginDrawList(r_fillmode.value >= 1, r_texturecombiner.value >= 1);
+	shaders = GL_UseWorldProgram();
+
+	DL_BeginDrawList(r_fillmode.value >= 1, r_texturecombiner.value >= 1 && !shaders);
 
 	// setup texture environment for effects
-	if (r_texturecombiner.value) {
+	if (shaders) {
+		DL_SetWorldProgram(true);
+	}
+	else if (r_texturecombiner.value) {
 		if (!nolights) {
 			GL_UpdateEnvTexture(WHITE);
 			GL_SetTextureUnit(1, true);
@@ -339,18 +393,36 @@ void R_RenderWorld(void) {
 	GL_SetState(GLSTATE_BLEND, 1);
 	DL_ProcessDrawList(DLT_FLAT, ProcessFlats);
 
+	// occlusion queries and instanced sprites use their own programs
+	DL_SetWorldProgram(false);
+
 	// -------------- Draw things (sprites) ----------------------
 
 	if (devparm) {
 		spriteRenderTic = I_GetTimeMS();
+		spriteSetupTime = 0;
 	}
 
+	R_BeginOcclusion();
+	R_BeginSpriteInstances();
+
 	if (r_rendersprites.value) {
+		uint64_t start = devparm ? I_GetTimeUS() : 0;
+
 		R_SetupSprites();
+
+		if (devparm) {
+			spriteSetupTime = (unsigned int)(I_GetTimeUS() - start);
+		}
 	}
 
+	R_DrawOcclusionQueries();
+	R_DrawSpriteInstances();
+
 	dglDepthMask(GL_FALSE);
+	DL_SetWorldProgram(shaders);
 	DL_ProcessDrawList(DLT_SPRITE, ProcessSprites);
+	DL_SetWorldProgram(false);
 
 	// -------------- Restore states -----------------------------
 
@@ -0,0 +1,385 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: Instanced sprites
+//
+// Solid sprites are packed into one instance per sprite and
+// uploaded together each frame. The vertex shader turns each
+// instance into a quad facing the view, and every sprite sharing
+// a texture and palette goes out in a single draw. Unlike the
+// draw list they aren't sorted by distance, so they write depth
+// and have their edges cut at half alpha instead of blended.
+// Translucent sprites, lasers, wireframe and drivers without
+// shaders or instancing still go through the draw list.
+//
+// Since the edges look different, it's off unless
+// r_spriteinstancing is set.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "r_local.h"
+#include "r_lights.h"
+#include "r_sprinst.h"
+#include "r_occlude.h"
+#include "gl_main.h"
+#include "gl_shader.h"
+#include "gl_texture.h"
+#include "dgl.h"
+#include "i_system.h"
+#include "con_console.h"
+
+typedef struct {
+	float       origin[4];      // x, y, top, glow
+	float       extent[4];      // left edge, width, height, flip
+	byte        color[4];
+	int         key;            // palette << 16 | sprite lump, unused by the shader
+} sprinst_t;
+
+enum {
+	SA_CORNER = GLSHADER_FIRSTATTRIB,
+	SA_ORIGIN,
+	SA_EXTENT,
+	SA_COLOR
+};
+
+static const char* sprattribs[] = {
+	"corner",
+	"origin",
+	"extent",
+	"color",
+	NULL
+};
+
+static const char* sprvertsrc =
+	"#version 120\n"
+	"attribute vec2 corner;\n"
+	"attribute vec4 origin;\n"
+	"attribute vec4 extent;\n"
+	"attribute vec4 color;\n"
+	"uniform vec2 viewangle;\n"
+	"varying vec2 texcoord;\n"
+	"varying vec4 light;\n"
+	"varying float glow;\n"
+	"void main() {\n"
+	"    float dx = extent.x + corner.x * extent.y;\n"
+	"    vec4 pos = vec4(origin.x + viewangle.x * dx, origin.y - viewangle.y * dx,\n"
+	"        origin.z - (1.0 - corner.y) * extent.z, 1.0);\n"
+	"    vec4 eye = gl_ModelViewMatrix * pos;\n"
+	"    texcoord = vec2(mix(extent.w, 1.0 - extent.w, corner.x), 1.0 - corner.y);\n"
+	"    light = color;\n"
+	"    glow = origin.w;\n"
+	"    gl_FogFragCoord = abs(eye.z);\n"
+	"    gl_Position = gl_ProjectionMatrix * eye;\n"
+	"}\n";
+
+static const char* sprfragsrc =
+	"#version 120\n"
+	GLSHADER_FOG
+	"uniform sampler2D image;\n"
+	"uniform vec3 flash;\n"
+	"uniform float lights;\n"
+	"varying vec2 texcoord;\n"
+	"varying vec4 light;\n"
+	"varying float glow;\n"
+	"void main() {\n"
+	"    vec4 texel = texture2D(image, texcoord);\n"
+	"    float alpha = texel.a * light.a;\n"
+	"    if (alpha < 0.5) {\n"
+	"        discard;\n"
+	"    }\n"
+	"    vec3 rgb = min(texel.rgb + glow, 1.0);\n"
+	"    rgb = mix(rgb, rgb * light.rgb, lights);\n"
+	"    rgb = min(rgb + flash, 1.0);\n"
+	"    gl_FragColor = vec4(ApplyFog(rgb), alpha);\n"
+	"}\n";
+
+// corners of the quad as a strip, in the order R_GenerateSpritePlane uses
+static const float sprcorners[8] = {
+	0, 0,
+	0, 1,
+	1, 0,
+	1, 1
+};
+
+static sprinst_t* instances = NULL;
+static int numinstances = 0;
+static int maxinstances = 0;
+
+static rhandle sprprogram = 0;
+static boolean sprfailed = false;
+static rbuffer sprcornerbuffer = 0;
+static rbuffer sprinstbuffer = 0;
+static boolean sprinstactive = false;
+
+static GLint u_viewangle;
+static GLint u_image;
+static GLint u_flash;
+static GLint u_lights;
+static GLint u_fogmode;
+
+CVAR(r_spriteinstancing, 0);
+
+CVAR_EXTERNAL(r_texturecombiner);
+CVAR_EXTERNAL(r_fillmode);
+CVAR_EXTERNAL(st_flashoverlay);
+
+//
+// R_CreateSpriteProgram
+//
+
+static boolean R_CreateSpriteProgram(void) {
+	if (sprprogram) {
+		return true;
+	}
+
+	if (sprfailed) {
+		return false;
+	}
+
+	sprprogram = GL_CreateProgram("sprites", sprvertsrc, sprfragsrc, sprattribs);
+
+	if (!sprprogram) {
+		CON_Warnf("R_CreateSpriteProgram: Using the draw list for sprites\n");
+		sprfailed = true;
+		return false;
+	}
+
+	u_viewangle = dglGetUniformLocationARB(sprprogram, "viewangle");
+	u_image = dglGetUniformLocationARB(sprprogram, "image");
+	u_flash = dglGetUniformLocationARB(sprprogram, "flash");
+	u_lights = dglGetUniformLocationARB(sprprogram, "lights");
+	u_fogmode = dglGetUniformLocationARB(sprprogram, "fogmode");
+
+	dglGenBuffersARB(1, &sprcornerbuffer);
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, sprcornerbuffer);
+	dglBufferDataARB(GL_ARRAY_BUFFER_ARB, sizeof(sprcorners), (GLvoid*)sprcorners, GL_STATIC_DRAW_ARB);
+
+	dglGenBuffersARB(1, &sprinstbuffer);
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+	return true;
+}
+
+//
+// R_BeginSpriteInstances
+//
+
+void R_BeginSpriteInstances(void) {
+	numinstances = 0;
+
+	sprinstactive = (r_spriteinstancing.value > 0 && r_texturecombiner.value > 0 && r_fillmode.value > 0 &&
+		gl_has_shaders && has_GL_ARB_instanced_arrays && has_GL_ARB_draw_instanced &&
+		has_GL_ARB_vertex_buffer_object && R_CreateSpriteProgram());
+}
+
+//
+// R_AddSpriteInstance
+// Returns false if the sprite has to go through the draw list
+//
+
+boolean R_AddSpriteInstance(visspritelist_t* vis, int spritenum, boolean flip) {
+	mobj_t* thing;
+	sprinst_t* inst;
+	int palette;
+
+	thing = vis->spr;
+
+	if (!sprinstactive || thing->alpha != 0xff || (thing->flags & MF_RENDERLASER)) {
+		return false;
+	}
+
+	if (numinstances == maxinstances) {
+		maxinstances = maxinstances ? maxinstances * 2 : 1024;
+		instances = (sprinst_t*)realloc(instances, maxinstances * sizeof(sprinst_t));
+
+		if (instances == NULL) {
+			I_Error("R_AddSpriteInstance: Failed to allocate %i instances", maxinstances);
+		}
+	}
+
+	inst = &instances[numinstances++];
+
+	palette = thing->player ? thing->player->palette : thing->info->palette;
+	inst->key = (palette << 16) | spritenum;
+
+	inst->origin[0] = vis->x;
+	inst->origin[1] = vis->y;
+	inst->origin[2] = vis->z + spritetopoffset[spritenum];
+	inst->origin[3] = (float)thing->subsector->sector->lightlevel / 255.0f;
+
+	if (flip) {
+		inst->extent[0] = spriteoffset[spritenum] - (float)spritewidth[spritenum];
+	}
+	else {
+		inst->extent[0] = -spriteoffset[spritenum];
+	}
+
+	inst->extent[1] = (float)spritewidth[spritenum];
+	inst->extent[2] = (float)spriteheight[spritenum];
+	inst->extent[3] = flip ? 1.0f : 0.0f;
+
+	// same colours as R_GenerateSpritePlane
+	if (thing->flags & MF_NIGHTMARE) {
+		inst->color[0] = 64;
+		inst->color[1] = 255;
+		inst->color[2] = 0;
+	}
+	else if (thing->frame & FF_FULLBRIGHT) {
+		inst->color[0] = inst->color[1] = inst->color[2] = 255;
+	}
+	else {
+		vtx_t v;
+
+		R_LightToVertex(&v, thing->subsector->sector->colors[LIGHT_THING], 1);
+
+		inst->color[0] = v.r;
+		inst->color[1] = v.g;
+		inst->color[2] = v.b;
+	}
+
+	inst->color[3] = thing->alpha;
+
+	return true;
+}
+
+//
+// SortInstances
+//
+
+static int SortInstances(const void* a, const void* b) {
+	return ((const sprinst_t*)a)->key - ((const sprinst_t*)b)->key;
+}
+
+//
+// R_SetInstancePointers
+//
+
+static void R_SetInstancePointers(int first) {
+	uintptr_t offset = first * sizeof(sprinst_t);
+
+	dglVertexAttribPointerARB(SA_ORIGIN, 4, GL_FLOAT, GL_FALSE, sizeof(sprinst_t),
+		(void*)(offset + offsetof(sprinst_t, origin)));
+	dglVertexAttribPointerARB(SA_EXTENT, 4, GL_FLOAT, GL_FALSE, sizeof(sprinst_t),
+		(void*)(offset + offsetof(sprinst_t, extent)));
+	dglVertexAttribPointerARB(SA_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(sprinst_t),
+		(void*)(offset + offsetof(sprinst_t, color)));
+}
+
+//
+// R_DrawSpriteInstances
+// Goes before the draw list sprites, with depth writes on
+//
+
+void R_DrawSpriteInstances(void) {
+	float flash[4];
+	int i;
+	int j;
+
+	if (!numinstances) {
+		return;
+	}
+
+	qsort(instances, numinstances, sizeof(sprinst_t), SortInstances);
+
+	// orphan last frame's data so the driver doesn't wait on it
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, sprinstbuffer);
+	dglBufferDataARB(GL_ARRAY_BUFFER_ARB, numinstances * sizeof(sprinst_t), NULL, GL_STREAM_DRAW_ARB);
+	dglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, numinstances * sizeof(sprinst_t), instances);
+
+	dglUseProgramObjectARB(sprprogram);
+
+	if (st_flashoverlay.value <= 0) {
+		dglGetColorf(flashcolor, flash);
+	}
+	else {
+		flash[0] = flash[1] = flash[2] = 0;
+	}
+
+	dglUniform2fARB(u_viewangle, viewsin[0], viewcos[0]);
+	dglUniform1iARB(u_image, 0);
+	dglUniform3fARB(u_flash, flash[0], flash[1], flash[2]);
+	dglUniform1fARB(u_lights, nolights ? 0.0f : 1.0f);
+	dglUniform1iARB(u_fogmode, GL_GetFogMode());
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, sprcornerbuffer);
+	dglVertexAttribPointerARB(SA_CORNER, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, sprinstbuffer);
+
+	dglEnableVertexAttribArrayARB(SA_CORNER);
+	dglEnableVertexAttribArrayARB(SA_ORIGIN);
+	dglEnableVertexAttribArrayARB(SA_EXTENT);
+	dglEnableVertexAttribArrayARB(SA_COLOR);
+
+	dglVertexAttribDivisorARB(SA_ORIGIN, 1);
+	dglVertexAttribDivisorARB(SA_EXTENT, 1);
+	dglVertexAttribDivisorARB(SA_COLOR, 1);
+
+	GL_SetTextureUnit(0, true);
+	GL_SetState(GLSTATE_CULL, 1);
+	dglDepthMask(GL_TRUE);
+
+	for (i = 0; i < numinstances; i = j) {
+		for (j = i + 1; j < numinstances && instances[j].key == instances[i].key; j++);
+
+		GL_BindSpriteTexture(instances[i].key & 0xffff, instances[i].key >> 16);
+		R_SetInstancePointers(i);
+
+		dglDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, 4, j - i);
+	}
+
+	dglVertexAttribDivisorARB(SA_ORIGIN, 0);
+	dglVertexAttribDivisorARB(SA_EXTENT, 0);
+	dglVertexAttribDivisorARB(SA_COLOR, 0);
+
+	dglDisableVertexAttribArrayARB(SA_CORNER);
+	dglDisableVertexAttribArrayARB(SA_ORIGIN);
+	dglDisableVertexAttribArrayARB(SA_EXTENT);
+	dglDisableVertexAttribArrayARB(SA_COLOR);
+
+	dglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	dglUseProgramObjectARB(0);
+
+	occlusionstats.drawn += numinstances;
+
+	if (devparm) {
+		vertCount += numinstances * 4;
+	}
+
+	numinstances = 0;
+}
+
+//
+// R_InitSpriteInstancing
+// The program and buffers belong to the old context after a
+// video reset
+//
+
+void R_InitSpriteInstancing(void) {
+	sprprogram = 0;
+	sprfailed = false;
+	sprcornerbuffer = 0;
+	sprinstbuffer = 0;
+	numinstances = 0;
+}
@@ -37,6 +37,8 @@
 #include "r_drawlist.h"
 #include "p_local.h"
 #include "r_clipper.h"
+#include "r_occlude.h"
+#include "r_sprinst.h"
 #include "m_misc.h"
 #include "con_console.h"
 
@@ -225,21 +227,16 @@ void R_InitSprites(char** namelist) {
 
 //
 // R_AddSprites
+// Only things linked into the subsector are visited, so the cost
+// follows the number of visible things rather than the number of
+// things in the sector times its subsectors
 //
 
 void R_AddSprites(subsector_t* sub) {
 	mobj_t* thing;
 
-	// Handle all things in sector.
-	for (thing = sub->sector->thinglist; thing; thing = thing->snext) {
-		if (thing->subsector != sub) { // don't add sprite if it doesn't belong in this subsector
-			continue;
-		}
-
-		if (thing->flags & MF_NOSECTOR) {
-			continue;
-		}
-
+	// Handle all things in subsector.
+	for (thing = sub->thinglist; thing; thing = thing->ssnext) {
 		if (vissprite - visspritelist >= MAX_SPRITES) {
 			CON_Warnf("R_AddSprites: Sprite overflow");
 			return;
@@ -268,6 +265,7 @@ static void R_AddVisSprite(visspritelist_t* vissprite) {
 	angle_t         ang;
 	int             spritenum;
 	int             rot;
+	boolean         flip = false;
 	mobj_t* thing;
 
 	thing = vissprite->spr;
@@ -300,6 +298,15 @@ static void R_AddVisSprite(visspritelist_t* vissprite) {
 		}
 
 		spritenum = sprframe->lump[rot];
+		flip = sprframe->flip[rot];
+	}
+
+	if (R_SpriteOccluded(vissprite, spritenum)) {
+		return;
+	}
+
+	if (R_AddSpriteInstance(vissprite, spritenum, flip)) {
+		return;
 	}
 
 	AddSpriteDrawlist(&drawlist[DLT_SPRITE], vissprite, spritenum);
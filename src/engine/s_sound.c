@@ -309,7 +309,8 @@ void S_StartSound(mobj_t* origin, int sfx_id) {
     int sep;
     int reverb;
 
-    if(nosound) {
+    // these were already heard the first time the tics were run
+    if(nosound || netrollback) {
         return;
     }
 
@@ -407,12 +408,20 @@ int S_AdjustSoundParams(fixed_t x, fixed_t y, int* vol, int* sep) {
 
 CVAR_EXTERNAL(s_soundfont);
 CVAR_EXTERNAL(s_driver);
+#ifndef __APPLE__
+CVAR_EXTERNAL(s_pcmcache);
+CVAR_EXTERNAL(s_scheduler);
+#endif
 
 void S_RegisterCvars(void) {
     CON_CvarRegister(&s_sfxvol);
     CON_CvarRegister(&s_musvol);
     CON_CvarRegister(&s_gain);
     CON_CvarRegister(&s_soundfont);
+#ifndef __APPLE__
+    CON_CvarRegister(&s_pcmcache);
+    CON_CvarRegister(&s_scheduler);
+#endif
 }
 
 
@@ -51,6 +51,9 @@
 
 scparser_t sc_parser;
 
+// lump the parser is reading from, or -1 for a file
+static int sc_lump = -1;
+
 //
 // SC_Open
 //
@@ -70,6 +73,7 @@ static void SC_Open(const char* name) {
 		}
 	}
 	else {
+		sc_lump = lump;
 		sc_parser.buffer = W_CacheLumpNum(lump, PU_STATIC);
 		sc_parser.buffsize = W_LumpLength(lump);
 	}
@@ -88,7 +92,14 @@ static void SC_Open(const char* name) {
 //
 
 static void SC_Close(void) {
-	Z_Free(sc_parser.buffer);
+	if (sc_lump != -1) {
+		W_ReleaseLumpNum(sc_lump);
+	}
+	else {
+		Z_Free(sc_parser.buffer);
+	}
+
+	sc_lump = -1;
 
 	sc_parser.buffer = NULL;
 	sc_parser.buffsize = 0;
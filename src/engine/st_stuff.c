@@ -50,6 +50,7 @@
 #include "z_zone.h"
 #include "p_setup.h"
 #include "gl_draw.h"
+#include "gl_batch.h"
 #include "g_demo.h"
 
 #if defined(_WIN32) && defined(USE_XINPUT)
@@ -110,7 +111,9 @@ static int              st_msgtic = 0;
 static int              st_msgalpha = 0xff;
 static char* st_msg = NULL;
 static vtx_t            st_vtx[32];
+static word             st_idx[48];
 static int              st_vtxcount = 0;
+static int              st_idxcount = 0;
 static byte             st_flash_r;
 static byte             st_flash_g;
 static byte             st_flash_b;
@@ -478,6 +481,9 @@ void ST_FlashingScreen(byte r, byte g, byte b, byte a) {
 	{
 		rcolor c = D_RGBA(r, g, b, a);
 
+		// the flash goes over anything batched before it
+		GL_FlushBatch();
+
 		GL_SetState(GLSTATE_BLEND, 1);
 		GL_SetOrtho(1);
 
@@ -497,8 +503,12 @@ void ST_FlashingScreen(byte r, byte g, byte b, byte a) {
 static void ST_DrawStatusItem(const float xy[4][2], const float uv[4][2], rcolor color) {
 	int i;
 
-	dglTriangle(st_vtxcount + 0, st_vtxcount + 1, st_vtxcount + 2);
-	dglTriangle(st_vtxcount + 0, st_vtxcount + 2, st_vtxcount + 3);
+	st_idx[st_idxcount++] = st_vtxcount + 0;
+	st_idx[st_idxcount++] = st_vtxcount + 1;
+	st_idx[st_idxcount++] = st_vtxcount + 2;
+	st_idx[st_idxcount++] = st_vtxcount + 0;
+	st_idx[st_idxcount++] = st_vtxcount + 2;
+	st_idx[st_idxcount++] = st_vtxcount + 3;
 
 	dglSetVertexColor(st_vtx + st_vtxcount, color, 4);
 
@@ -585,7 +595,6 @@ static void ST_DrawStatus(void) {
 	float   uv[4][2];
 	const rcolor color = D_RGBA(0x68, 0x68, 0x68, 0x90);
 
-	GL_SetState(GLSTATE_BLEND, 1);
 	lump = GL_BindGfxTexture("STATUS", true);
 
 	width = (float)gfxwidth[lump];
@@ -598,10 +607,8 @@ static void ST_DrawStatus(void) {
 		GL_SetOrthoScale(0.725f);
 	}
 
-	GL_SetOrtho(0);
-
-	dglSetVertex(st_vtx);
 	st_vtxcount = 0;
+	st_idxcount = 0;
 
 	if (st_drawhud.value == 1) {
 		// health
@@ -659,10 +666,7 @@ static void ST_DrawStatus(void) {
 
 	ST_DrawKey(it_redskull, uv, st_key3Vertex);
 
-	dglDrawGeometry(st_vtxcount, st_vtx);
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
+	GL_BatchGeometry(gfxptr[lump], false, st_vtx, st_vtxcount, st_idx, st_idxcount);
 
 	if (st_drawhud.value >= 2) {
 		GL_SetOrthoScale(1.0f);
@@ -677,6 +681,7 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 	float u;
 	int index;
 	int scale;
+	int pic;
 
 	if (slot <= 0) {
 		return;
@@ -688,8 +693,7 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 
 	index = slot - 1;
 
-	GL_BindGfxTexture("CRSHAIRS", true);
-	GL_SetState(GLSTATE_BLEND, 1);
+	pic = GL_BindGfxTexture("CRSHAIRS", true);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
@@ -697,10 +701,8 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 	u = 1.0f / st_crosshairs;
 	scale = scalefactor == 0 ? ST_CROSSHAIRSIZE : (ST_CROSSHAIRSIZE / (1 << scalefactor));
 
-	GL_SetupAndDraw2DQuad((float)x, (float)y, scale, scale,
-		u * index, u + (u * index), 0, 1, color, 0);
-
-	GL_SetState(GLSTATE_BLEND, 0);
+	Draw_BatchQuad(gfxptr[pic], (float)x, (float)y, scale, scale,
+		u * index, u + (u * index), 0, 1, color);
 }
 
 //
@@ -709,16 +711,15 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 
 static void ST_DrawJMessage(int pic) {
 	int lump = st_jmessages[pic];
-
-	GL_BindGfxTexture(lumpinfo[lump].name, true);
-	GL_SetState(GLSTATE_BLEND, 1);
+	int gfxIdx = GL_BindGfxTexture(lumpinfo[lump].name, true);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, DGL_CLAMP);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-	GL_SetupAndDraw2DQuad(
+	Draw_BatchQuad(
+		gfxptr[gfxIdx],
 		20,
 		20,
 		gfxwidth[lump - g_start],
@@ -727,11 +728,8 @@ static void ST_DrawJMessage(int pic) {
 		1,
 		0,
 		1,
-		ST_MSGCOLOR(automapactive ? 0xff : st_msgalpha),
-		false
+		ST_MSGCOLOR(automapactive ? 0xff : st_msgalpha)
 	);
-
-	GL_SetState(GLSTATE_BLEND, 0);
 }
 
 //
@@ -108,6 +108,10 @@ typedef    struct {
 	// if == validcount, already checked
 	int             validcount;
 
+	// changed by R_InvalidateSectorLight whenever the heights
+	// or colour indexes change so cached wall colours get redone
+	int             lightstamp;
+
 	// list of mobjs in sector
 	mobj_t* thinglist;
 
@@ -209,6 +213,9 @@ typedef struct subsector_s {
 	word        firstline;
 	word        numleafs;
 	word        leaf;
+
+	// list of mobjs in subsector
+	mobj_t* thinglist;
 } subsector_t;
 
 //
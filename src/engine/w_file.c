@@ -31,11 +31,21 @@
 #include <ctype.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "doomtype.h"
 #include "i_system.h"
 #include "z_zone.h"
 #include "m_misc.h"
 #include "w_file.h"
+#include "w_zip.h"
 
 // Array of locations to search for IWAD files
 //
@@ -104,13 +114,208 @@ unsigned int W_StdC_Read(wad_file_t* wad, unsigned int offset,
 	return result;
 }
 
+// Ask the OS to start reading a range in the background
+
+static void W_StdC_Prefetch(wad_file_t* wad, unsigned int offset, unsigned int length) {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+	stdc_wad_file_t* stdc_wad;
+
+	stdc_wad = (stdc_wad_file_t*)wad;
+
+	posix_fadvise(fileno(stdc_wad->fstream), offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
 wad_file_class_t stdc_wad_file = {
 	W_StdC_OpenFile,
 	W_StdC_CloseFile,
 	W_StdC_Read,
+	W_StdC_Prefetch,
+};
+
+//
+// Memory mapped files
+//
+// The whole file is mapped copy-on-write, so lumps can be
+// handed out as pointers into the mapping without reading
+// them into the zone first
+//
+
+typedef struct {
+	wad_file_t wad;
+#ifdef _WIN32
+	HANDLE handle;
+	HANDLE handle_map;
+#else
+	int handle;
+#endif
+} mapped_wad_file_t;
+
+extern wad_file_class_t mapped_wad_file;
+
+static wad_file_t* W_Mapped_OpenFile(char* path) {
+	mapped_wad_file_t* result;
+	unsigned int length;
+	byte* mapped;
+
+#ifdef _WIN32
+	HANDLE handle;
+	HANDLE handle_map;
+
+	handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (handle == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	length = GetFileSize(handle, NULL);
+
+	if (length == 0 || length == INVALID_FILE_SIZE) {
+		CloseHandle(handle);
+		return NULL;
+	}
+
+	handle_map = CreateFileMapping(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+	if (handle_map == NULL) {
+		CloseHandle(handle);
+		return NULL;
+	}
+
+	mapped = (byte*)MapViewOfFile(handle_map, FILE_MAP_COPY, 0, 0, length);
+
+	if (mapped == NULL) {
+		CloseHandle(handle_map);
+		CloseHandle(handle);
+		return NULL;
+	}
+#else
+	int handle;
+	struct stat st;
+
+	handle = open(path, O_RDONLY);
+
+	if (handle < 0) {
+		return NULL;
+	}
+
+	if (fstat(handle, &st) < 0 || st.st_size <= 0) {
+		close(handle);
+		return NULL;
+	}
+
+	length = (unsigned int)st.st_size;
+
+	// writes made through the mapping stay private to the process
+	mapped = (byte*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, handle, 0);
+
+	if (mapped == (byte*)MAP_FAILED) {
+		close(handle);
+		return NULL;
+	}
+#endif
+
+	result = (mapped_wad_file_t*)Z_Malloc(sizeof(mapped_wad_file_t), PU_STATIC, 0);
+	result->wad.file_class = &mapped_wad_file;
+	result->wad.mapped = mapped;
+	result->wad.length = length;
+	result->handle = handle;
+#ifdef _WIN32
+	result->handle_map = handle_map;
+#endif
+
+	return &result->wad;
+}
+
+static void W_Mapped_CloseFile(wad_file_t* wad) {
+	mapped_wad_file_t* mapped_wad;
+
+	mapped_wad = (mapped_wad_file_t*)wad;
+
+#ifdef _WIN32
+	UnmapViewOfFile(wad->mapped);
+	CloseHandle(mapped_wad->handle_map);
+	CloseHandle(mapped_wad->handle);
+#else
+	munmap(wad->mapped, wad->length);
+	close(mapped_wad->handle);
+#endif
+
+	Z_Free(mapped_wad);
+}
+
+static unsigned int W_Mapped_Read(wad_file_t* wad, unsigned int offset,
+	void* buffer, unsigned int buffer_len) {
+	if (offset >= wad->length) {
+		return 0;
+	}
+
+	if (buffer_len > wad->length - offset) {
+		buffer_len = wad->length - offset;
+	}
+
+	memcpy(buffer, wad->mapped + offset, buffer_len);
+
+	return buffer_len;
+}
+
+// Fault the pages in ahead of time so touching them later
+// doesn't stall on the disk
+
+static void W_Mapped_Prefetch(wad_file_t* wad, unsigned int offset, unsigned int length) {
+#ifndef _WIN32
+	uintptr_t start;
+	uintptr_t end;
+	uintptr_t pagesize;
+
+	if (offset >= wad->length) {
+		return;
+	}
+
+	length = MIN(length, wad->length - offset);
+	pagesize = (uintptr_t)sysconf(_SC_PAGESIZE);
+	start = (uintptr_t)(wad->mapped + offset) & ~(pagesize - 1);
+	end = (uintptr_t)(wad->mapped + offset + length);
+
+	madvise((void*)start, end - start, MADV_WILLNEED);
+#endif
+}
+
+wad_file_class_t mapped_wad_file = {
+	W_Mapped_OpenFile,
+	W_Mapped_CloseFile,
+	W_Mapped_Read,
+	W_Mapped_Prefetch,
 };
 
+//
+// W_OpenFile
+//
+
 wad_file_t* W_OpenFile(char* path) {
+	wad_file_t* result;
+
+	// archives have to be unpacked; they can't be mapped
+	if (W_IsZipFile(path)) {
+		return zip_wad_file.OpenFile(path);
+	}
+
+	//!
+	// @category obscure
+	//
+	// Read WAD files with regular file I/O instead of mapping
+	// them into memory.
+	//
+
+	if (!M_CheckParm("-nommap")) {
+		result = mapped_wad_file.OpenFile(path);
+
+		if (result != NULL) {
+			return result;
+		}
+	}
+
 	return stdc_wad_file.OpenFile(path);
 }
 
@@ -123,6 +328,12 @@ unsigned int W_Read(wad_file_t* wad, unsigned int offset,
 	return wad->file_class->Read(wad, offset, buffer, buffer_len);
 }
 
+void W_Prefetch(wad_file_t* wad, unsigned int offset, unsigned int length) {
+	if (wad->file_class->Prefetch != NULL) {
+		wad->file_class->Prefetch(wad, offset, length);
+	}
+}
+
 //
 // W_FindWADByName
 // Searches WAD search paths for an WAD with a specific filename.
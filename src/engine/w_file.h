@@ -43,6 +43,12 @@ typedef struct {
 
 	unsigned int(*Read)(wad_file_t* file, unsigned int offset,
 		void* buffer, unsigned int buffer_len);
+
+	// Hint that a range is about to be read, so it can be
+	// prepared in the background. May be NULL.
+
+	void (*Prefetch)(wad_file_t* file, unsigned int offset,
+		unsigned int length);
 } wad_file_class_t;
 
 struct _wad_file_s {
@@ -51,7 +57,8 @@ struct _wad_file_s {
 	wad_file_class_t* file_class;
 
 	// If this is NULL, the file cannot be mapped into memory.  If this
-	// is non-NULL, it is a pointer to the mapped file.
+	// is non-NULL, it is a pointer to the mapped file. The mapping is
+	// private, so writes through it never reach the file on disk.
 
 	byte* mapped;
 
@@ -76,6 +83,10 @@ void W_CloseFile(wad_file_t* wad);
 unsigned int W_Read(wad_file_t* wad, unsigned int offset,
 	void* buffer, unsigned int buffer_len);
 
+// Hint that the given range will be read soon.
+
+void W_Prefetch(wad_file_t* wad, unsigned int offset, unsigned int length);
+
 char* W_FindWADByName(char* filename);
 char* W_TryFindWADByName(char* filename);
 char* W_FindIWAD(void);
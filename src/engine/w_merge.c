@@ -30,8 +30,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "i_system.h"
 #include "w_merge.h"
 #include "w_wad.h"
@@ -51,6 +53,8 @@ typedef enum {
 typedef struct {
 	lumpinfo_t* lumps;
 	int numlumps;
+	int* hash;              // list indexes, -1 for an empty slot
+	unsigned int hashsize;  // power of two, 0 if not indexed
 } searchlist_t;
 
 typedef struct {
@@ -76,14 +80,108 @@ static sprite_frame_t* sprite_frames;
 static int num_sprite_frames;
 static int sprite_frames_alloced;
 
+// sprite frames indexed by name and frame
+static int* sprite_hash;
+static unsigned int sprite_hashsize;
+
+// Pack up to len characters of a name into a key, upper cased
+// so lookups stay case insensitive like strncasecmp
+
+static uint64_t NameKey(const char* name, int len) {
+	uint64_t key = 0;
+	int i;
+
+	for (i = 0; i < len && name[i] != '\0'; ++i) {
+		key |= (uint64_t)(byte)toupper(name[i]) << (i * 8);
+	}
+
+	return key;
+}
+
+static unsigned int KeySlot(uint64_t key, unsigned int size) {
+	key ^= key >> 29;
+	key *= 0xbf58476d1ce4e5b9ULL;
+	key ^= key >> 32;
+
+	return (unsigned int)key & (size - 1);
+}
+
+// Make sure a hash table has room for count entries at half load
+// and clear it
+
+static void ResetHash(int** hash, unsigned int* hashsize, int count) {
+	unsigned int size = 64;
+
+	while (size < (unsigned int)count * 2) {
+		size <<= 1;
+	}
+
+	if (size > *hashsize) {
+		if (*hash != NULL) {
+			Z_Free(*hash);
+		}
+
+		*hash = (int*)Z_Malloc(size * sizeof(int), PU_STATIC, NULL);
+		*hashsize = size;
+	}
+
+	dmemset(*hash, 0xff, *hashsize * sizeof(int));
+}
+
+// Index a list by lump name. Only the first lump with a given
+// name goes in, to match what the linear search used to return
+
+static void IndexList(searchlist_t* list) {
+	unsigned int slot;
+	int i;
+
+	ResetHash(&list->hash, &list->hashsize, list->numlumps);
+
+	for (i = 0; i < list->numlumps; ++i) {
+		uint64_t key = NameKey(list->lumps[i].name, 8);
+
+		for (slot = KeySlot(key, list->hashsize); list->hash[slot] != -1;
+			slot = (slot + 1) & (list->hashsize - 1)) {
+			if (NameKey(list->lumps[list->hash[slot]].name, 8) == key) {
+				break;
+			}
+		}
+
+		if (list->hash[slot] == -1) {
+			list->hash[slot] = i;
+		}
+	}
+}
+
 // Search in a list to find a lump with a particular name
-// Linear search (slow!)
+// Linear search unless the list has been indexed
 //
 // Returns -1 if not found
 
 static int FindInList(searchlist_t* list, const char* name) {
+	uint64_t key;
+	unsigned int slot;
 	int i;
 
+	if (list->hashsize) {
+		if (!list->numlumps) {
+			return -1;
+		}
+
+		key = NameKey(name, 8);
+
+		for (slot = KeySlot(key, list->hashsize); list->hash[slot] != -1;
+			slot = (slot + 1) & (list->hashsize - 1)) {
+			i = list->hash[slot];
+
+			if (NameKey(list->lumps[i].name, 8) == key) {
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
 	for (i = 0; i < list->numlumps; ++i) {
 		if (!strncasecmp(list->lumps[i].name, name, 8)) {
 			return i;
@@ -149,6 +247,12 @@ static void SetupLists(void) {
 	SetupList(&pwad_sprites, &pwad, "S_START", "S_END", "SS_START", "SS_END");
 	SetupList(&pwad_gfx, &pwad, "SYMBOLS", "MOUNTC", NULL, NULL);
 	SetupList(&pwad_sounds, &pwad, "DM_START", "DM_END", NULL, NULL);
+
+	// DoMerge looks up every IWAD lump in these
+
+	IndexList(&pwad_textures);
+	IndexList(&pwad_gfx);
+	IndexList(&pwad_sounds);
 }
 
 // Initialise the replace list
@@ -161,20 +265,31 @@ static void InitSpriteList(void) {
 	}
 
 	num_sprite_frames = 0;
+	ResetHash(&sprite_hash, &sprite_hashsize, sprite_frames_alloced);
 }
 
-// Find a sprite frame
+static uint64_t SpriteFrameKey(const char* name, int frame) {
+	return NameKey(name, 4) | ((uint64_t)(byte)frame << 32);
+}
+
+// Find a sprite frame. Rotations live in angle_lumps, so the
+// hash only needs to key on name and frame
 
 static sprite_frame_t* FindSpriteFrame(char* name, int frame) {
 	sprite_frame_t* result;
+	uint64_t key;
+	unsigned int slot;
 	int i;
 
-	// Search the list and try to find the frame
+	// Search the index and try to find the frame
 
-	for (i = 0; i < num_sprite_frames; ++i) {
-		sprite_frame_t* cur = &sprite_frames[i];
+	key = SpriteFrameKey(name, frame);
 
-		if (!strncasecmp(cur->sprname, name, 4) && cur->frame == frame) {
+	for (slot = KeySlot(key, sprite_hashsize); sprite_hash[slot] != -1;
+		slot = (slot + 1) & (sprite_hashsize - 1)) {
+		sprite_frame_t* cur = &sprite_frames[sprite_hash[slot]];
+
+		if (SpriteFrameKey(cur->sprname, cur->frame) == key) {
 			return cur;
 		}
 	}
@@ -193,6 +308,24 @@ static sprite_frame_t* FindSpriteFrame(char* name, int frame) {
 		Z_Free(sprite_frames);
 		sprite_frames_alloced *= 2;
 		sprite_frames = newframes;
+
+		// index grows with the list; re-add what's already there
+
+		ResetHash(&sprite_hash, &sprite_hashsize, sprite_frames_alloced);
+
+		for (i = 0; i < num_sprite_frames; ++i) {
+			key = SpriteFrameKey(sprite_frames[i].sprname, sprite_frames[i].frame);
+
+			for (slot = KeySlot(key, sprite_hashsize); sprite_hash[slot] != -1;
+				slot = (slot + 1) & (sprite_hashsize - 1));
+
+			sprite_hash[slot] = i;
+		}
+
+		key = SpriteFrameKey(name, frame);
+
+		for (slot = KeySlot(key, sprite_hashsize); sprite_hash[slot] != -1;
+			slot = (slot + 1) & (sprite_hashsize - 1));
 	}
 
 	// Add to end of list
@@ -205,6 +338,7 @@ static sprite_frame_t* FindSpriteFrame(char* name, int frame) {
 		result->angle_lumps[i] = NULL;
 	}
 
+	sprite_hash[slot] = num_sprite_frames;
 	++num_sprite_frames;
 
 	return result;
@@ -593,6 +727,8 @@ static void DoMerge(void) {
 	free(lumpinfo);
 	lumpinfo = newlumps;
 	numlumps = num_newlumps;
+
+	W_InvalidateLumpIndex();
 }
 
 void W_PrintDirectory(void) {
@@ -612,8 +748,10 @@ void W_PrintDirectory(void) {
 
 void W_MergeFile(char* filename) {
 	int old_numlumps;
+	uint64_t start;
 
 	old_numlumps = numlumps;
+	start = I_GetTimeUS();
 
 	// Load PWAD
 
@@ -640,4 +778,11 @@ void W_MergeFile(char* filename) {
 	// Perform the merge
 
 	DoMerge();
+
+	if (devparm) {
+		I_Printf("W_MergeFile: merged %s in %i ms (%i textures, %i sprites, %i gfx, %i sounds)\n",
+			filename, (int)((I_GetTimeUS() - start) / 1000),
+			pwad_textures.numlumps, pwad_sprites.numlumps,
+			pwad_gfx.numlumps, pwad_sounds.numlumps);
+	}
 }
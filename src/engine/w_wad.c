@@ -54,9 +54,11 @@
 #include "m_misc.h"
 
 #include "md5.h"
+#include "g_actions.h"
 
 #include "w_wad.h"
 #include "w_file.h"
+#include "w_zip.h"
 
 //
 // GLOBALS
@@ -137,23 +139,169 @@ unsigned int W_HashLumpName(const char* str) {
 }
 
 //
-// W_HashLumps
+// LUMP NAME INDEX
 //
+// Open addressing table keyed on the lump name packed into
+// 64 bits. Probing only touches the key array, not lumpinfo.
+// Lumps are inserted as files are added; a name that's
+// already in the table is taken over by the newer lump so
+// the last file loaded wins. Merging reorders lumpinfo, so
+// it throws the index away and it's rebuilt on next lookup
+//
+
+typedef struct {
+	uint64_t*       keys;
+	int*            lumps;  // -1 if slot is empty
+	unsigned int    size;   // always a power of two
+	int             count;
+	boolean         dirty;
+} lumpindex_t;
+
+static lumpindex_t lumpindex;
+
+//
+// W_LumpNameKey
+//
+
+static uint64_t W_LumpNameKey(const char* name) {
+	char buf[8];
+	int i;
+	uint64_t key;
+
+	for (i = 0; i < 8 && name[i] != '\0'; i++) {
+		buf[i] = name[i];
+	}
+
+	for (; i < 8; i++) {
+		buf[i] = 0;
+	}
+
+	dmemcpy(&key, buf, 8);
+	return key;
+}
+
+//
+// W_LumpKeySlot
+//
+
+static unsigned int W_LumpKeySlot(uint64_t key) {
+	key ^= key >> 29;
+	key *= 0xbf58476d1ce4e5b9ULL;
+	key ^= key >> 32;
+
+	return (unsigned int)key & (lumpindex.size - 1);
+}
+
+//
+// W_InsertLumpKey
+//
+
+static void W_InsertLumpKey(uint64_t key, int lump) {
+	unsigned int i;
+
+	for (i = W_LumpKeySlot(key); lumpindex.lumps[i] != -1; i = (i + 1) & (lumpindex.size - 1)) {
+		if (lumpindex.keys[i] == key) {
+			if (lump > lumpindex.lumps[i]) {
+				lumpindex.lumps[i] = lump;
+			}
+
+			return;
+		}
+	}
+
+	lumpindex.keys[i] = key;
+	lumpindex.lumps[i] = lump;
+	lumpindex.count++;
+}
+
+//
+// W_ResizeLumpIndex
+//
+// Keep the table at most half full
+//
+
+static void W_ResizeLumpIndex(int count) {
+	uint64_t* oldkeys;
+	int* oldlumps;
+	unsigned int oldsize;
+	unsigned int size;
+	unsigned int i;
+
+	size = 64;
+	while (size < (unsigned int)count * 2) {
+		size <<= 1;
+	}
+
+	if (size <= lumpindex.size) {
+		return;
+	}
+
+	oldkeys = lumpindex.keys;
+	oldlumps = lumpindex.lumps;
+	oldsize = lumpindex.size;
+
+	lumpindex.keys = (uint64_t*)malloc(size * sizeof(uint64_t));
+	lumpindex.lumps = (int*)malloc(size * sizeof(int));
+
+	if (!lumpindex.keys || !lumpindex.lumps) {
+		I_Error("W_ResizeLumpIndex: couldn't allocate %i slots", size);
+	}
+
+	lumpindex.size = size;
+	lumpindex.count = 0;
+	dmemset(lumpindex.lumps, 0xff, size * sizeof(int));
+
+	for (i = 0; i < oldsize; i++) {
+		if (oldlumps[i] != -1) {
+			W_InsertLumpKey(oldkeys[i], oldlumps[i]);
+		}
+	}
 
-static void W_HashLumps(void) {
+	free(oldkeys);
+	free(oldlumps);
+}
+
+//
+// W_IndexLumps
+// Add lumps from first up to numlumps to the index
+//
+
+static void W_IndexLumps(int first) {
 	int i;
-	unsigned int hash;
 
-	for (i = 0; i < numlumps; i++) {
-		lumpinfo[i].index = -1;
-		lumpinfo[i].next = -1;
+	if (lumpindex.dirty) {
+		return;
 	}
 
-	for (i = 0; i < numlumps; i++) {
-		hash = (W_HashLumpName(lumpinfo[i].name) % numlumps);
-		lumpinfo[i].next = lumpinfo[hash].index;
-		lumpinfo[hash].index = i;
+	W_ResizeLumpIndex(lumpindex.count + (numlumps - first));
+
+	for (i = first; i < numlumps; i++) {
+		W_InsertLumpKey(W_LumpNameKey(lumpinfo[i].name), i);
+	}
+}
+
+//
+// W_RebuildLumpIndex
+//
+
+static void W_RebuildLumpIndex(void) {
+	lumpindex.dirty = false;
+	lumpindex.count = 0;
+
+	if (lumpindex.lumps) {
+		dmemset(lumpindex.lumps, 0xff, lumpindex.size * sizeof(int));
 	}
+
+	W_IndexLumps(0);
+}
+
+//
+// W_InvalidateLumpIndex
+// Called whenever lumpinfo is reordered
+//
+
+void W_InvalidateLumpIndex(void) {
+	lumpindex.dirty = true;
 }
 
 //
@@ -188,7 +336,8 @@ wad_file_t* W_AddFile(char* filename) {
 
 	startlump = numlumps;
 
-	if (strcasecmp(filename + dstrlen(filename) - 3, "wad")) {
+	// archives present themselves as a wad
+	if (strcasecmp(filename + dstrlen(filename) - 3, "wad") && !W_IsZipFile(filename)) {
 		// single lump file
 
 		// fraggle: Swap the filepos and size here.  The WAD directory
@@ -248,7 +397,7 @@ wad_file_t* W_AddFile(char* filename) {
 
 	Z_Free(fileinfo);
 
-	W_HashLumps();
+	W_IndexLumps(startlump);
 
 	return wadfile;
 }
@@ -257,6 +406,121 @@ wad_file_t* W_AddFile(char* filename) {
 // LUMP BASED ROUTINES.
 //
 
+//
+// CMD_LumpBench
+// Times W_CheckNumForName over every lump name in the
+// directory plus the same number of misses
+//
+
+#define LUMPBENCH_PASSES    16
+
+static CMD(LumpBench) {
+	char miss[8];
+	uint64_t start;
+	uint64_t hittime;
+	uint64_t misstime;
+	unsigned int i;
+	unsigned int probe;
+	unsigned int maxprobe;
+	int pass;
+	int lump;
+	int found;
+	int wrong;
+	int lookups;
+
+	if (!numlumps) {
+		return;
+	}
+
+	if (lumpindex.dirty) {
+		W_RebuildLumpIndex();
+	}
+
+	found = 0;
+	start = I_GetTimeUS();
+
+	for (pass = 0; pass < LUMPBENCH_PASSES; pass++) {
+		for (lump = 0; lump < numlumps; lump++) {
+			found += W_CheckNumForName(lumpinfo[lump].name) >= 0;
+		}
+	}
+
+	hittime = I_GetTimeUS() - start;
+	start = I_GetTimeUS();
+
+	for (pass = 0; pass < LUMPBENCH_PASSES; pass++) {
+		for (lump = 0; lump < numlumps; lump++) {
+			dmemcpy(miss, lumpinfo[lump].name, 8);
+			miss[7] = '\x7f';
+			found += W_CheckNumForName(miss) >= 0;
+		}
+	}
+
+	misstime = I_GetTimeUS() - start;
+
+	// every name must resolve to the last lump carrying it
+	wrong = 0;
+	for (lump = 0; lump < numlumps; lump++) {
+		int expected = lump;
+		int j;
+
+		for (j = lump + 1; j < numlumps; j++) {
+			if (!dstrncmp(lumpinfo[j].name, lumpinfo[lump].name, 8)) {
+				expected = j;
+			}
+		}
+
+		if (W_CheckNumForName(lumpinfo[lump].name) != expected) {
+			wrong++;
+		}
+	}
+
+	maxprobe = 0;
+	for (i = 0; i < lumpindex.size; i++) {
+		if (lumpindex.lumps[i] == -1) {
+			continue;
+		}
+
+		probe = (i - W_LumpKeySlot(lumpindex.keys[i])) & (lumpindex.size - 1);
+		maxprobe = MAX(maxprobe, probe + 1);
+	}
+
+	lookups = numlumps * LUMPBENCH_PASSES;
+
+	CON_Printf(WHITE, "Lumps: %i, Unique names: %i, Slots: %i (%i%% full), Max probe: %i\n",
+		numlumps, lumpindex.count, lumpindex.size,
+		lumpindex.count * 100 / lumpindex.size, maxprobe);
+	CON_Printf(WHITE, "Hits: %i ns/lookup, Misses: %i ns/lookup (%i lookups each)\n",
+		(int)(hittime * 1000 / lookups), (int)(misstime * 1000 / lookups), lookups);
+	CON_Printf(wrong ? RED : WHITE, "Mismatched lookups: %i\n", wrong);
+}
+
+//
+// CMD_ZipStats
+//
+
+static CMD(ZipStats) {
+	zipstats_t stats;
+
+	if (param[0] && !dstricmp(param[0], "reset")) {
+		W_ResetZipStats();
+		return;
+	}
+
+	W_GetZipStats(&stats);
+
+	CON_Printf(WHITE, "Archives: %i, Entries: %i, Workers: %i\n",
+		stats.files, stats.entries, stats.workers);
+	CON_Printf(WHITE, "Read: %i KB, Inflated: %i KB (%i%%)\n",
+		(int)(stats.bytesread >> 10), (int)(stats.bytesinflated >> 10),
+		(int)(stats.bytesread * 100 / MAX(stats.bytesinflated, 1)));
+	CON_Printf(WHITE, "On demand: %i in %i ms, Prefetched: %i/%i in %i ms\n",
+		stats.ondemand, (int)(stats.inflatetime / 1000),
+		stats.prefetched, stats.queued, (int)(stats.workertime / 1000));
+	CON_Printf(WHITE, "Prefetch hits: %i, Waits: %i (%i ms)\n",
+		stats.hits, stats.waits, (int)(stats.waittime / 1000));
+}
+
 //
 // W_Init
 //
@@ -329,6 +593,8 @@ void W_Init(void) {
 
 	Z_Free(fileinfo);
 
+	W_IndexLumps(0);
+
 	if ((doom64superexpluswad = I_FindDataFile("doom64superex-plus.wad"))) {
 		W_MergeFile(doom64superexpluswad);
 		free(doom64superexpluswad);
@@ -352,7 +618,7 @@ void W_Init(void) {
 	// 20120724 villsa - find drag & drop wad files
 	else {
 		for (i = 1; i < myargc; i++) {
-			if (strstr(myargv[i], ".wad") || strstr(myargv[i], ".WAD")) {
+			if (strstr(myargv[i], ".wad") || strstr(myargv[i], ".WAD") || W_IsZipFile(myargv[i])) {
 				char* filename;
 				if ((filename = W_TryFindWADByName(myargv[i]))) {
 					W_MergeFile(filename);
@@ -360,7 +626,9 @@ void W_Init(void) {
 			}
 		}
 	}
-	W_HashLumps();
+
+	G_AddCommand("lumpbench", CMD_LumpBench, 0);
+	G_AddCommand("zipstats", CMD_ZipStats, 0);
 }
 
 static boolean nonmaplump = false;
@@ -368,6 +636,7 @@ static boolean nonmaplump = false;
 filelump_t* mapLump;
 int numMapLumps;
 byte* mapLumpData = NULL;
+static int mapLumpNum = -1;
 
 //
 // W_CacheMapLump
@@ -388,6 +657,7 @@ void W_CacheMapLump(int map) {
 		return;
 	}
 	else {
+		mapLumpNum = lump;
 		mapLumpData = (byte*)W_CacheLumpNum(lump, PU_STATIC);
 	}
 
@@ -409,10 +679,11 @@ void W_FreeMapLump(void) {
 	nonmaplump = false;
 
 	if (mapLumpData) {
-		Z_Free(mapLumpData);
+		W_ReleaseLumpNum(mapLumpNum);
 	}
 
 	mapLumpData = NULL;
+	mapLumpNum = -1;
 }
 
 //
@@ -469,17 +740,26 @@ void* W_GetMapLump(int lump) {
 //
 
 int W_CheckNumForName(const char* name) {
-	int i = -1;
+	uint64_t key;
+	unsigned int i;
 
-	if (numlumps) {
-		i = lumpinfo[W_HashLumpName(name) % numlumps].index;
+	if (lumpindex.dirty) {
+		W_RebuildLumpIndex();
 	}
 
-	while (i >= 0 && dstrncmp(lumpinfo[i].name, name, 8)) {
-		i = lumpinfo[i].next;
+	if (!lumpindex.count) {
+		return -1;
 	}
 
-	return i;
+	key = W_LumpNameKey(name);
+
+	for (i = W_LumpKeySlot(key); lumpindex.lumps[i] != -1; i = (i + 1) & (lumpindex.size - 1)) {
+		if (lumpindex.keys[i] == key) {
+			return lumpindex.lumps[i];
+		}
+	}
+
+	return -1;
 }
 
 //
@@ -537,9 +817,41 @@ void W_ReadLump(int lump, void* dest) {
 	}
 }
 
+//
+// W_PrefetchLump
+// Let the file get a lump ready ahead of W_ReadLump
+//
+
+void W_PrefetchLump(int lump) {
+	lumpinfo_t* l;
+
+	if (lump < 0 || lump >= numlumps) {
+		return;
+	}
+
+	l = &lumpinfo[lump];
+
+	if (l->size > 0 && !l->cache) {
+		W_Prefetch(l->wadfile, l->position, l->size);
+	}
+}
+
+//
+// W_LumpIsMapped
+//
+
+static boolean W_LumpIsMapped(lumpinfo_t* l) {
+	return (l->wadfile->mapped != NULL &&
+		(unsigned int)l->position + (unsigned int)l->size <= l->wadfile->length);
+}
+
 //
 // W_CacheLumpNum
 //
+// Lumps in a memory mapped file are returned straight from
+// the mapping and never enter the zone; use W_ReleaseLumpNum
+// rather than Z_Free when done with them
+//
 
 void* W_CacheLumpNum(int lump, int tag) {
 	lumpinfo_t* l;
@@ -550,6 +862,10 @@ void* W_CacheLumpNum(int lump, int tag) {
 
 	l = &lumpinfo[lump];
 
+	if (W_LumpIsMapped(l)) {
+		return l->wadfile->mapped + l->position;
+	}
+
 	if (!l->cache) {    // read the lump in
 		Z_Malloc(W_LumpLength(lump), tag, &l->cache);
 		W_ReadLump(lump, l->cache);
@@ -569,6 +885,27 @@ void* W_CacheLumpNum(int lump, int tag) {
 	return l->cache;
 }
 
+//
+// W_ReleaseLumpNum
+// Done with a lump returned by W_CacheLumpNum
+//
+
+void W_ReleaseLumpNum(int lump) {
+	lumpinfo_t* l;
+
+	if (lump < 0 || lump >= numlumps) {
+		I_Error("W_ReleaseLumpNum: lump %i out of range", lump);
+	}
+
+	l = &lumpinfo[lump];
+
+	if (W_LumpIsMapped(l) || !l->cache) {
+		return;
+	}
+
+	Z_Free(l->cache);
+}
+
 //
 // W_CacheLumpName
 //
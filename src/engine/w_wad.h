@@ -41,8 +41,6 @@ typedef struct {
 	wad_file_t* wadfile;
 	int         position;
 	int         size;
-	int         next;
-	int         index;
 	void* cache;
 } lumpinfo_t;
 
@@ -53,14 +51,17 @@ void            W_Init(void);
 wad_file_t* W_AddFile(char* filename);
 unsigned int    W_HashLumpName(const char* str);
 int             W_CheckNumForName(const char* name);
+void            W_InvalidateLumpIndex(void);
 int             W_GetNumForName(const char* name);
 int             W_LumpLength(int lump);
 void            W_ReadLump(int lump, void* dest);
+void            W_PrefetchLump(int lump);
 void* W_GetMapLump(int lump);
 void            W_CacheMapLump(int map);
 void            W_FreeMapLump(void);
 int             W_MapLumpLength(int lump);
 void* W_CacheLumpNum(int lump, int tag);
+void            W_ReleaseLumpNum(int lump);
 void* W_CacheLumpName(const char* name, int tag);
 
 #endif
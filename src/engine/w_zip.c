@@ -0,0 +1,937 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION: PK3/ZIP archives as a WAD file class
+//
+// The archive is presented to the WAD code as a PWAD: offset 0
+// holds a generated header and lump directory, and every entry
+// gets its own range of offsets after that as if it were stored
+// uncompressed. Reads inflate the entry they land in. Entries
+// under textures/, sprites/ and sounds/ are wrapped in the usual
+// section markers so they merge like a PWAD would.
+//
+// W_Prefetch queues entries for worker threads so they are
+// already inflated by the time the lump is read.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef __OpenBSD__
+#include <SDL.h>
+#else
+#include <SDL3/SDL.h>
+#endif
+
+#include <zlib.h>
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "i_system.h"
+#include "z_zone.h"
+#include "m_misc.h"
+#include "con_console.h"
+#include "w_file.h"
+#include "w_zip.h"
+
+#define ZIP_LOCALSIG        0x04034b50
+#define ZIP_CENTRALSIG      0x02014b50
+#define ZIP_ENDSIG          0x06054b50
+#define ZIP_LOCALSIZE       30
+#define ZIP_CENTRALSIZE     46
+#define ZIP_ENDSIZE         22
+#define ZIP_MAXCOMMENT      0xffff
+
+#define ZIP_STORED          0
+#define ZIP_DEFLATED        8
+
+#define ZIP_QUEUESIZE       1024    // must be a power of two
+#define ZIP_MAXWORKERS      4
+
+enum {
+	ZIP_NONE,       // not inflated
+	ZIP_QUEUED,     // waiting for a worker
+	ZIP_BUSY,       // being inflated
+	ZIP_READY       // data is valid
+};
+
+typedef enum {
+	ZIPSECTION_NONE,
+	ZIPSECTION_TEXTURES,
+	ZIPSECTION_SPRITES,
+	ZIPSECTION_SOUNDS,
+	NUMZIPSECTIONS
+} zipsection_t;
+
+typedef struct zip_wad_file_s zip_wad_file_t;
+
+typedef struct {
+	char            name[8];
+	zipsection_t    section;
+	unsigned int    position;       // offset in the virtual wad
+	unsigned int    size;           // inflated size
+	unsigned int    csize;          // size in the archive
+	unsigned int    offset;         // local header in the archive
+	int             method;
+	SDL_AtomicInt   state;
+	byte*           data;           // malloc'd, valid when ZIP_READY
+	boolean         prefetched;
+	zip_wad_file_t* zip;
+} zipentry_t;
+
+struct zip_wad_file_s {
+	wad_file_t      wad;
+	FILE*           fstream;
+	char*           path;
+	byte*           directory;      // generated wad header and lump table
+	unsigned int    dirlength;
+	zipentry_t*     entries;        // in virtual wad order
+	int             numentries;
+	int             serial;         // tells workers their handle is stale
+};
+
+extern wad_file_class_t zip_wad_file;
+
+// Worker pool, shared by all open archives
+
+static zipentry_t* zipqueue[ZIP_QUEUESIZE];
+static int zipqueuehead;
+static int zipqueuetail;
+static SDL_Mutex* ziplock;
+static SDL_Semaphore* zipwake;
+static int numzipworkers;
+static int zipserial;
+
+static zipstats_t zipstats;
+
+static const char* zipmarkers[NUMZIPSECTIONS][2] = {
+	{ NULL, NULL },
+	{ "T_START", "T_END" },
+	{ "S_START", "S_END" },
+	{ "DM_START", "DM_END" }
+};
+
+//
+// Zip_U16
+//
+
+static unsigned int Zip_U16(const byte* p) {
+	return p[0] | (p[1] << 8);
+}
+
+//
+// Zip_U32
+//
+
+static unsigned int Zip_U32(const byte* p) {
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+		((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+//
+// Zip_PutU32
+//
+
+static void Zip_PutU32(byte* p, unsigned int value) {
+	p[0] = value & 0xff;
+	p[1] = (value >> 8) & 0xff;
+	p[2] = (value >> 16) & 0xff;
+	p[3] = (value >> 24) & 0xff;
+}
+
+//
+// Zip_ReadAt
+//
+
+static boolean Zip_ReadAt(FILE* fp, unsigned int offset, void* buffer, unsigned int length) {
+	if (fseek(fp, offset, SEEK_SET)) {
+		return false;
+	}
+
+	return fread(buffer, 1, length, fp) == length;
+}
+
+//
+// Zip_FindEnd
+// Locate the end of central directory record, which may be
+// followed by a comment of up to 64k
+//
+
+static boolean Zip_FindEnd(FILE* fp, unsigned int length, byte* end) {
+	byte* buf;
+	unsigned int size;
+	int i;
+
+	if (length < ZIP_ENDSIZE) {
+		return false;
+	}
+
+	size = MIN(length, ZIP_ENDSIZE + ZIP_MAXCOMMENT);
+	buf = (byte*)malloc(size);
+
+	if (!Zip_ReadAt(fp, length - size, buf, size)) {
+		free(buf);
+		return false;
+	}
+
+	for (i = size - ZIP_ENDSIZE; i >= 0; i--) {
+		if (Zip_U32(buf + i) == ZIP_ENDSIG) {
+			dmemcpy(end, buf + i, ZIP_ENDSIZE);
+			free(buf);
+			return true;
+		}
+	}
+
+	free(buf);
+	return false;
+}
+
+//
+// Zip_LumpName
+// Base name of a path, without extension, as a lump name
+//
+
+static void Zip_LumpName(const char* path, int pathlen, char* name) {
+	int start;
+	int end;
+	int i;
+
+	start = pathlen;
+	while (start > 0 && path[start - 1] != '/' && path[start - 1] != '\\') {
+		start--;
+	}
+
+	end = pathlen;
+	for (i = pathlen - 1; i > start; i--) {
+		if (path[i] == '.') {
+			end = i;
+			break;
+		}
+	}
+
+	dmemset(name, 0, 8);
+
+	for (i = 0; i < 8 && start + i < end; i++) {
+		name[i] = toupper(path[start + i]);
+	}
+}
+
+//
+// Zip_Section
+// Which marker section the top level directory maps to
+//
+
+static zipsection_t Zip_Section(const char* path, int pathlen) {
+	static const char* dirs[NUMZIPSECTIONS] = {
+		NULL, "textures/", "sprites/", "sounds/"
+	};
+	int i;
+	int len;
+
+	for (i = ZIPSECTION_TEXTURES; i < NUMZIPSECTIONS; i++) {
+		len = dstrlen(dirs[i]);
+
+		if (pathlen > len && !dstrnicmp(path, dirs[i], len)) {
+			return (zipsection_t)i;
+		}
+	}
+
+	return ZIPSECTION_NONE;
+}
+
+//
+// Zip_ReadDirectory
+// Parse the central directory into entries, in archive order
+//
+
+static zipentry_t* Zip_ReadDirectory(zip_wad_file_t* zip, int* count) {
+	byte end[ZIP_ENDSIZE];
+	byte* central;
+	byte* p;
+	zipentry_t* entries;
+	unsigned int cdsize;
+	unsigned int cdoffset;
+	int total;
+	int num;
+	int i;
+
+	if (!Zip_FindEnd(zip->fstream, zip->wad.length, end)) {
+		return NULL;
+	}
+
+	total = Zip_U16(end + 10);
+	cdsize = Zip_U32(end + 12);
+	cdoffset = Zip_U32(end + 16);
+
+	if (cdoffset > zip->wad.length || cdsize > zip->wad.length - cdoffset) {
+		return NULL;
+	}
+
+	central = (byte*)malloc(cdsize);
+
+	if (!Zip_ReadAt(zip->fstream, cdoffset, central, cdsize)) {
+		free(central);
+		return NULL;
+	}
+
+	entries = (zipentry_t*)calloc(total + 1, sizeof(zipentry_t));
+	num = 0;
+	p = central;
+
+	for (i = 0; i < total; i++) {
+		unsigned int namelen;
+		unsigned int extralen;
+		unsigned int commentlen;
+		const char* path;
+		zipentry_t* entry;
+
+		if (p + ZIP_CENTRALSIZE > central + cdsize || Zip_U32(p) != ZIP_CENTRALSIG) {
+			break;
+		}
+
+		namelen = Zip_U16(p + 28);
+		extralen = Zip_U16(p + 30);
+		commentlen = Zip_U16(p + 32);
+		path = (const char*)(p + ZIP_CENTRALSIZE);
+
+		if (p + ZIP_CENTRALSIZE + namelen > central + cdsize) {
+			break;
+		}
+
+		// skip directories, encrypted and unsupported entries
+		if (namelen && path[namelen - 1] != '/') {
+			int method = Zip_U16(p + 10);
+
+			if ((Zip_U16(p + 8) & 1) || (method != ZIP_STORED && method != ZIP_DEFLATED)) {
+				CON_Warnf("W_AddFile: %.*s in %s uses an unsupported compression method\n",
+					namelen, path, zip->path);
+			}
+			else {
+				entry = &entries[num++];
+				Zip_LumpName(path, namelen, entry->name);
+				entry->section = Zip_Section(path, namelen);
+				entry->method = method;
+				entry->csize = Zip_U32(p + 20);
+				entry->size = Zip_U32(p + 24);
+				entry->offset = Zip_U32(p + 42);
+				entry->zip = zip;
+			}
+		}
+
+		p += ZIP_CENTRALSIZE + namelen + extralen + commentlen;
+	}
+
+	free(central);
+
+	*count = num;
+	return entries;
+}
+
+//
+// Zip_BuildDirectory
+// Sort entries into the virtual wad, add section markers and
+// generate the wad header and lump table
+//
+
+static boolean Zip_BuildDirectory(zip_wad_file_t* zip, zipentry_t* found, int numfound) {
+	int sectioncount[NUMZIPSECTIONS];
+	zipentry_t* entry;
+	unsigned int position;
+	int numlumps;
+	int s;
+	int i;
+	byte* p;
+
+	dmemset(sectioncount, 0, sizeof(sectioncount));
+
+	for (i = 0; i < numfound; i++) {
+		sectioncount[found[i].section]++;
+	}
+
+	numlumps = sectioncount[ZIPSECTION_NONE];
+
+	for (s = ZIPSECTION_TEXTURES; s < NUMZIPSECTIONS; s++) {
+		if (sectioncount[s]) {
+			numlumps += sectioncount[s] + 2;
+		}
+	}
+
+	zip->entries = (zipentry_t*)calloc(numlumps + 1, sizeof(zipentry_t));
+	zip->numentries = 0;
+
+	for (s = ZIPSECTION_NONE; s < NUMZIPSECTIONS; s++) {
+		if (!sectioncount[s]) {
+			continue;
+		}
+
+		if (zipmarkers[s][0]) {
+			entry = &zip->entries[zip->numentries++];
+			dmemcpy(entry->name, zipmarkers[s][0], dstrlen(zipmarkers[s][0]));
+		}
+
+		for (i = 0; i < numfound; i++) {
+			if (found[i].section == (zipsection_t)s) {
+				zip->entries[zip->numentries++] = found[i];
+			}
+		}
+
+		if (zipmarkers[s][1]) {
+			entry = &zip->entries[zip->numentries++];
+			dmemcpy(entry->name, zipmarkers[s][1], dstrlen(zipmarkers[s][1]));
+		}
+	}
+
+	// header and lump table come first, lump data after
+
+	zip->dirlength = 12 + numlumps * 16;
+	zip->directory = (byte*)malloc(zip->dirlength);
+
+	p = zip->directory;
+	dmemcpy(p, "PWAD", 4);
+	Zip_PutU32(p + 4, numlumps);
+	Zip_PutU32(p + 8, 12);
+	p += 12;
+
+	position = zip->dirlength;
+
+	for (i = 0; i < zip->numentries; i++) {
+		entry = &zip->entries[i];
+
+		if (position + entry->size < position) {
+			return false;
+		}
+
+		entry->position = position;
+		position += entry->size;
+
+		Zip_PutU32(p, entry->position);
+		Zip_PutU32(p + 4, entry->size);
+		dmemcpy(p + 8, entry->name, 8);
+		p += 16;
+	}
+
+	zip->wad.length = position;
+
+	return true;
+}
+
+//
+// W_Zip_OpenFile
+//
+
+static wad_file_t* W_Zip_OpenFile(char* path) {
+	zip_wad_file_t* result;
+	zipentry_t* found;
+	int numfound;
+	FILE* fstream;
+	byte sig[4];
+
+	fstream = fopen(path, "rb");
+
+	if (fstream == NULL) {
+		return NULL;
+	}
+
+	if (!Zip_ReadAt(fstream, 0, sig, 4) || Zip_U32(sig) != ZIP_LOCALSIG) {
+		fclose(fstream);
+		return NULL;
+	}
+
+	result = (zip_wad_file_t*)Z_Calloc(sizeof(zip_wad_file_t), PU_STATIC, 0);
+	result->wad.file_class = &zip_wad_file;
+	result->wad.mapped = NULL;
+	result->wad.length = M_FileLength(fstream);
+	result->fstream = fstream;
+	result->path = M_StringDuplicate(path);
+	result->serial = ++zipserial;
+
+	found = Zip_ReadDirectory(result, &numfound);
+
+	if (found == NULL || !Zip_BuildDirectory(result, found, numfound)) {
+		I_Printf("W_Zip_OpenFile: %s is not a valid archive\n", path);
+		free(found);
+		free(result->entries);
+		free(result->directory);
+		free(result->path);
+		fclose(fstream);
+		Z_Free(result);
+		return NULL;
+	}
+
+	free(found);
+
+	zipstats.files++;
+	zipstats.entries += result->numentries;
+
+	return &result->wad;
+}
+
+//
+// W_Zip_CloseFile
+//
+
+static void W_Zip_CloseFile(wad_file_t* wad) {
+	zip_wad_file_t* zip;
+	zipentry_t* entry;
+	int i;
+
+	zip = (zip_wad_file_t*)wad;
+
+	// pull anything still queued from this archive, then let
+	// the workers finish what they already started
+	SDL_LockMutex(ziplock);
+
+	for (i = zipqueuetail; i != zipqueuehead; i++) {
+		entry = zipqueue[i & (ZIP_QUEUESIZE - 1)];
+
+		if (entry && entry->zip == zip) {
+			zipqueue[i & (ZIP_QUEUESIZE - 1)] = NULL;
+		}
+	}
+
+	SDL_UnlockMutex(ziplock);
+
+	for (i = 0; i < zip->numentries; i++) {
+		while (SDL_AtomicGet(&zip->entries[i].state) == ZIP_BUSY) {
+			SDL_Delay(1);
+		}
+
+		free(zip->entries[i].data);
+	}
+
+	fclose(zip->fstream);
+	free(zip->entries);
+	free(zip->directory);
+	free(zip->path);
+	Z_Free(zip);
+}
+
+//
+// Zip_Inflate
+// Returns a malloc'd copy of the entry's data, or NULL
+//
+
+static byte* Zip_Inflate(zipentry_t* entry, FILE* fp, boolean worker) {
+	byte local[ZIP_LOCALSIZE];
+	byte* in;
+	byte* out;
+	unsigned int offset;
+	uint64_t start;
+	z_stream zs;
+	int ret;
+
+	start = I_GetTimeUS();
+
+	if (!Zip_ReadAt(fp, entry->offset, local, ZIP_LOCALSIZE) ||
+		Zip_U32(local) != ZIP_LOCALSIG) {
+		return NULL;
+	}
+
+	offset = entry->offset + ZIP_LOCALSIZE + Zip_U16(local + 26) + Zip_U16(local + 28);
+	out = (byte*)malloc(MAX(entry->size, 1));
+
+	if (entry->method == ZIP_STORED) {
+		if (entry->csize != entry->size || !Zip_ReadAt(fp, offset, out, entry->size)) {
+			free(out);
+			return NULL;
+		}
+	}
+	else {
+		in = (byte*)malloc(MAX(entry->csize, 1));
+
+		if (!Zip_ReadAt(fp, offset, in, entry->csize)) {
+			free(in);
+			free(out);
+			return NULL;
+		}
+
+		dmemset(&zs, 0, sizeof(z_stream));
+
+		// raw deflate, no zlib header
+		if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+			free(in);
+			free(out);
+			return NULL;
+		}
+
+		zs.next_in = in;
+		zs.avail_in = entry->csize;
+		zs.next_out = out;
+		zs.avail_out = entry->size;
+
+		ret = inflate(&zs, Z_FINISH);
+		inflateEnd(&zs);
+		free(in);
+
+		if (ret != Z_STREAM_END || zs.total_out != entry->size) {
+			free(out);
+			return NULL;
+		}
+	}
+
+	SDL_LockMutex(ziplock);     // does nothing before the workers start
+
+	zipstats.bytesread += entry->csize;
+	zipstats.bytesinflated += entry->size;
+
+	if (worker) {
+		zipstats.workertime += I_GetTimeUS() - start;
+		zipstats.prefetched++;
+	}
+	else {
+		zipstats.inflatetime += I_GetTimeUS() - start;
+		zipstats.ondemand++;
+	}
+
+	SDL_UnlockMutex(ziplock);
+
+	return out;
+}
+
+//
+// Zip_GetData
+// Wait for or inflate the entry's data on the main thread
+//
+
+static byte* Zip_GetData(zip_wad_file_t* zip, zipentry_t* entry) {
+	uint64_t start;
+
+	while (1) {
+		switch (SDL_AtomicGet(&entry->state)) {
+		case ZIP_READY:
+			if (entry->prefetched) {
+				zipstats.hits++;
+				entry->prefetched = false;
+			}
+			return entry->data;
+
+		case ZIP_BUSY:
+			// a worker has it; it won't be long
+			start = I_GetTimeUS();
+
+			while (SDL_AtomicGet(&entry->state) == ZIP_BUSY) {
+				SDL_Delay(0);
+			}
+
+			zipstats.waits++;
+			zipstats.waittime += I_GetTimeUS() - start;
+			break;
+
+		default:
+			// not started yet, or still queued; do it here
+			if (SDL_AtomicCompareAndSwap(&entry->state, ZIP_NONE, ZIP_BUSY) ||
+				SDL_AtomicCompareAndSwap(&entry->state, ZIP_QUEUED, ZIP_BUSY)) {
+				entry->data = Zip_Inflate(entry, zip->fstream, false);
+
+				if (entry->data == NULL) {
+					I_Error("W_Read: couldn't extract %.8s from %s", entry->name, zip->path);
+				}
+
+				entry->prefetched = false;
+				SDL_AtomicSet(&entry->state, ZIP_READY);
+			}
+			break;
+		}
+	}
+}
+
+//
+// Zip_FindEntry
+// Last entry whose range starts at or before offset
+//
+
+static int Zip_FindEntry(zip_wad_file_t* zip, unsigned int offset) {
+	int low;
+	int high;
+	int mid;
+
+	low = 0;
+	high = zip->numentries - 1;
+
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+
+		if (zip->entries[mid].position <= offset) {
+			low = mid;
+		}
+		else {
+			high = mid - 1;
+		}
+	}
+
+	return low;
+}
+
+//
+// W_Zip_Read
+//
+
+static unsigned int W_Zip_Read(wad_file_t* wad, unsigned int offset,
+	void* buffer, unsigned int buffer_len) {
+	zip_wad_file_t* zip;
+	zipentry_t* entry;
+	unsigned int result;
+	unsigned int len;
+	byte* dest;
+	byte* data;
+	int i;
+
+	zip = (zip_wad_file_t*)wad;
+	dest = (byte*)buffer;
+	result = 0;
+
+	if (offset >= wad->length) {
+		return 0;
+	}
+
+	buffer_len = MIN(buffer_len, wad->length - offset);
+
+	// generated directory
+	if (offset < zip->dirlength) {
+		len = MIN(buffer_len, zip->dirlength - offset);
+		dmemcpy(dest, zip->directory + offset, len);
+		dest += len;
+		offset += len;
+		buffer_len -= len;
+		result += len;
+	}
+
+	if (!buffer_len) {
+		return result;
+	}
+
+	// entries are contiguous, so a read can span several of them
+	for (i = Zip_FindEntry(zip, offset); i < zip->numentries && buffer_len; i++) {
+		entry = &zip->entries[i];
+
+		if (offset >= entry->position + entry->size) {
+			continue;
+		}
+
+		data = Zip_GetData(zip, entry);
+		len = MIN(buffer_len, entry->position + entry->size - offset);
+
+		dmemcpy(dest, data + (offset - entry->position), len);
+
+		dest += len;
+		offset += len;
+		buffer_len -= len;
+		result += len;
+
+		// done with it once the end has been read; the zone
+		// holds on to the lump from here
+		if (offset == entry->position + entry->size) {
+			free(entry->data);
+			entry->data = NULL;
+			SDL_AtomicSet(&entry->state, ZIP_NONE);
+		}
+	}
+
+	return result;
+}
+
+//
+// Thread_ZipWorker
+//
+
+static int SDLCALL Thread_ZipWorker(void* data) {
+	int current;
+	zipentry_t* entry;
+	FILE* fp;
+
+	current = 0;
+	fp = NULL;
+
+	while (1) {
+		SDL_WaitSemaphore(zipwake);
+
+		SDL_LockMutex(ziplock);
+
+		if (zipqueuetail == zipqueuehead) {
+			SDL_UnlockMutex(ziplock);
+			continue;
+		}
+
+		entry = zipqueue[zipqueuetail & (ZIP_QUEUESIZE - 1)];
+		zipqueuetail++;
+
+		// the main thread may have taken it in the meantime
+		if (entry == NULL || !SDL_AtomicCompareAndSwap(&entry->state, ZIP_QUEUED, ZIP_BUSY)) {
+			SDL_UnlockMutex(ziplock);
+			continue;
+		}
+
+		SDL_UnlockMutex(ziplock);
+
+		// each worker reads through its own handle
+		if (entry->zip->serial != current) {
+			if (fp) {
+				fclose(fp);
+			}
+
+			current = entry->zip->serial;
+			fp = fopen(entry->zip->path, "rb");
+		}
+
+		entry->data = fp ? Zip_Inflate(entry, fp, true) : NULL;
+
+		// leave failures for the main thread to report
+		SDL_AtomicSet(&entry->state, entry->data ? ZIP_READY : ZIP_NONE);
+	}
+
+	return 0;
+}
+
+//
+// Zip_StartWorkers
+//
+
+static void Zip_StartWorkers(void) {
+	SDL_Thread* thread;
+	int i;
+
+	numzipworkers = MAX(1, MIN(SDL_GetCPUCount() - 1, ZIP_MAXWORKERS));
+
+	for (i = 0; i < numzipworkers; i++) {
+		thread = SDL_CreateThread(Thread_ZipWorker, "ZipInflate", NULL);
+
+		if (thread == NULL) {
+			numzipworkers = i;
+			break;
+		}
+
+		SDL_DetachThread(thread);
+	}
+}
+
+//
+// W_Zip_Prefetch
+//
+
+static void W_Zip_Prefetch(wad_file_t* wad, unsigned int offset, unsigned int length) {
+	zip_wad_file_t* zip;
+	zipentry_t* entry;
+	int i;
+
+	zip = (zip_wad_file_t*)wad;
+
+	if (offset < zip->dirlength || !length) {
+		return;
+	}
+
+	if (ziplock == NULL) {
+		ziplock = SDL_CreateMutex();
+		zipwake = SDL_CreateSemaphore(0);
+		Zip_StartWorkers();
+	}
+
+	if (!numzipworkers) {
+		return;
+	}
+
+	for (i = Zip_FindEntry(zip, offset); i < zip->numentries; i++) {
+		entry = &zip->entries[i];
+
+		if (entry->position >= offset + length) {
+			break;
+		}
+
+		if (!entry->size) {
+			continue;
+		}
+
+		SDL_LockMutex(ziplock);
+
+		if (zipqueuehead - zipqueuetail >= ZIP_QUEUESIZE) {
+			// full; it'll be read on demand instead
+			SDL_UnlockMutex(ziplock);
+			break;
+		}
+
+		if (SDL_AtomicCompareAndSwap(&entry->state, ZIP_NONE, ZIP_QUEUED)) {
+			entry->prefetched = true;
+			zipqueue[zipqueuehead & (ZIP_QUEUESIZE - 1)] = entry;
+			zipqueuehead++;
+			zipstats.queued++;
+			SDL_PostSemaphore(zipwake);
+		}
+
+		SDL_UnlockMutex(ziplock);
+	}
+}
+
+wad_file_class_t zip_wad_file = {
+	W_Zip_OpenFile,
+	W_Zip_CloseFile,
+	W_Zip_Read,
+	W_Zip_Prefetch,
+};
+
+//
+// W_IsZipFile
+// Does the file name look like an archive
+//
+
+boolean W_IsZipFile(const char* path) {
+	int len = dstrlen(path);
+
+	return len > 4 && (!dstricmp(path + len - 4, ".pk3") || !dstricmp(path + len - 4, ".zip"));
+}
+
+//
+// W_GetZipStats
+//
+
+void W_GetZipStats(zipstats_t* stats) {
+	if (ziplock) {
+		SDL_LockMutex(ziplock);
+	}
+
+	*stats = zipstats;
+	stats->workers = numzipworkers;
+
+	if (ziplock) {
+		SDL_UnlockMutex(ziplock);
+	}
+}
+
+//
+// W_ResetZipStats
+//
+
+void W_ResetZipStats(void) {
+	int files = zipstats.files;
+	int entries = zipstats.entries;
+
+	if (ziplock) {
+		SDL_LockMutex(ziplock);
+	}
+
+	dmemset(&zipstats, 0, sizeof(zipstats_t));
+	zipstats.files = files;
+	zipstats.entries = entries;
+
+	if (ziplock) {
+		SDL_UnlockMutex(ziplock);
+	}
+}
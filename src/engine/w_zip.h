@@ -0,0 +1,48 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __W_ZIP__
+#define __W_ZIP__
+
+#include "w_file.h"
+
+typedef struct {
+	int         files;
+	int         entries;
+	int         workers;
+	uint64_t    bytesread;      // compressed bytes read from archives
+	uint64_t    bytesinflated;  // bytes produced by inflating them
+	int         ondemand;       // entries inflated on the main thread
+	int         prefetched;     // entries inflated by workers
+	int         queued;
+	int         hits;           // reads served from a prefetch
+	int         waits;          // reads that had to wait on a worker
+	uint64_t    inflatetime;    // us spent inflating on the main thread
+	uint64_t    workertime;     // us spent inflating on workers
+	uint64_t    waittime;
+} zipstats_t;
+
+extern wad_file_class_t zip_wad_file;
+
+boolean W_IsZipFile(const char* path);
+void W_GetZipStats(zipstats_t* stats);
+void W_ResetZipStats(void);
+
+#endif /*__W_ZIP__*/
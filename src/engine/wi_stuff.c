@@ -144,6 +144,8 @@ int WI_Ticker(void) {
 	int         i;
 	boolean    next = false;
 
+	P_PrefetchLevel(nextmap);
+
 	if (wi_advance <= 3) {
 		// check for button presses to skip delays
 		for (i = 0, player = players; i < MAXPLAYERS; i++, player++) {